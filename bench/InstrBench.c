@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Microbenchmark for the instruction decoder.  Every code item in the DEX
+ * file named on the command line is walked and decoded, the way the
+ * disassembler walks it, with:
+ *
+ *  - the separate width and format tables and dexDecodeInstruction()
+ *  - the packed descriptor and dexDecodeInstructionWithInfo()
+ *  - the packed descriptor and a single switch on the format that calls
+ *    the per-format decoders directly, as dumpInstruction() does
+ */
+#include "libdex/DexClass.h"
+#include "libdex/DexFile.h"
+#include "libdex/InstrUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define kMinNanos   500000000LL
+
+typedef struct CodeSpan {
+    const u2* insns;
+    u4 insnsSize;
+} CodeSpan;
+
+static long long nowNanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Return the width of the instruction at "insns", handling the payload
+ * pseudo-instructions, from the descriptor.
+ */
+static int insnWidth(const InstructionInfo* pInfo, const u2* insns)
+{
+    if (*insns == kPackedSwitchSignature) {
+        return 4 + insns[1] * 2;
+    } else if (*insns == kSparseSwitchSignature) {
+        return 2 + insns[1] * 4;
+    } else if (*insns == kArrayDataSignature) {
+        u2 elemWidth = insns[1];
+        u4 len = insns[2] | (((u4)insns[3]) << 16);
+        return 4 + (elemWidth * len + 1) / 2;
+    }
+    return (pInfo->width < 0) ? -pInfo->width : pInfo->width;
+}
+
+/*
+ * Decode the operands of one instruction with a single switch on its
+ * format, as dumpInstruction() does.  (The AA bits of 10x are copied out
+ * here, which the disassembler doesn't need, so the checksum matches.)
+ */
+static inline void decodeFused(const InstructionInfo* pInfo, const u2* insns,
+    DecodedInstruction* pDec)
+{
+    pDec->opCode = (OpCode) (insns[0] & 0xff);
+
+    switch (pInfo->format) {
+    case kFmt10x:
+    case kFmt11x:
+        dexDecode11x(insns, pDec);
+        break;
+    case kFmt12x:
+        dexDecode12x(insns, pDec);
+        break;
+    case kFmt22x:
+    case kFmt21h:
+    case kFmt21c:
+        dexDecode21c(insns, pDec);
+        break;
+    case kFmt32x:
+        dexDecode32x(insns, pDec);
+        break;
+    case kFmt11n:
+        dexDecode11n(insns, pDec);
+        break;
+    case kFmt10t:
+        dexDecode10t(insns, pDec);
+        break;
+    case kFmt20t:
+        dexDecode20t(insns, pDec);
+        break;
+    case kFmt21t:
+    case kFmt21s:
+        dexDecode21s(insns, pDec);
+        break;
+    case kFmt23x:
+        dexDecode23x(insns, pDec);
+        break;
+    case kFmt22b:
+        dexDecode22b(insns, pDec);
+        break;
+    case kFmt22t:
+    case kFmt22s:
+        dexDecode22s(insns, pDec);
+        break;
+    case kFmt22c:
+    case kFmt22cs:
+        dexDecode22c(insns, pDec);
+        break;
+    case kFmt30t:
+        dexDecode30t(insns, pDec);
+        break;
+    case kFmt31i:
+    case kFmt31c:
+    case kFmt31t:
+        dexDecode31i(insns, pDec);
+        break;
+    case kFmt35c:
+    case kFmt35ms:
+        dexDecode35c(insns, pDec);
+        break;
+    case kFmt3rc:
+    case kFmt3rms:
+    case kFmt3rinline:
+        dexDecode3rc(insns, pDec);
+        break;
+    case kFmt3inline:
+        dexDecode3inline(insns, pDec);
+        break;
+    case kFmt51l:
+        dexDecode51l(insns, pDec);
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Decode every instruction in "spans" with the given method.  Returns a
+ * checksum of the operands so the work can't be optimized away, and sets
+ * *pCount to the number of instructions decoded.
+ */
+static u4 decodeAll(int method, const CodeSpan* spans, int numSpans,
+    const InstructionWidth* widths, const InstructionFormat* fmts,
+    u8* pCount)
+{
+    u4 sum = 0;
+    u8 count = 0;
+    int i;
+
+    for (i = 0; i < numSpans; i++) {
+        const u2* insns = spans[i].insns;
+        const u2* end = insns + spans[i].insnsSize;
+
+        while (insns < end) {
+            DecodedInstruction decInsn;
+            const InstructionInfo* pInfo;
+            int width;
+
+            memset(&decInsn, 0, sizeof(decInsn));
+            switch (method) {
+            case 0:
+                width = dexGetInstrOrTableWidthAbs(widths, insns);
+                dexDecodeInstruction(fmts, insns, &decInsn);
+                break;
+            case 1:
+                pInfo = dexGetInstrInfo(insns[0] & 0xff);
+                width = insnWidth(pInfo, insns);
+                dexDecodeInstructionWithInfo(pInfo, insns, &decInsn);
+                break;
+            default:
+                pInfo = dexGetInstrInfo(insns[0] & 0xff);
+                width = insnWidth(pInfo, insns);
+                decodeFused(pInfo, insns, &decInsn);
+                break;
+            }
+            if (width == 0)
+                break;
+
+            sum += decInsn.opCode + decInsn.vA + decInsn.vB + decInsn.vC +
+                (u4) decInsn.vB_wide;
+            insns += width;
+            count++;
+        }
+    }
+
+    *pCount = count;
+    return sum;
+}
+
+/*
+ * Collect the code items of every method in the file.
+ */
+static CodeSpan* collectCode(const DexFile* pDexFile, int* pNumSpans)
+{
+    CodeSpan* spans = NULL;
+    int numSpans = 0, maxSpans = 0;
+    u4 i;
+
+    for (i = 0; i < pDexFile->pHeader->classDefsSize; i++) {
+        const DexClassDef* pClassDef = dexGetClassDef(pDexFile, i);
+        DexClassDataIterator iter;
+        DexMethod method;
+
+        dexClassDataIteratorInit(&iter, dexGetClassData(pDexFile, pClassDef));
+        while (dexClassDataIteratorNextMethod(&iter, &method)) {
+            const DexCode* pCode = dexGetCode(pDexFile, &method);
+
+            if (pCode == NULL || pCode->insnsSize == 0)
+                continue;
+            if (numSpans == maxSpans) {
+                maxSpans = (maxSpans == 0) ? 256 : maxSpans * 2;
+                spans = realloc(spans, maxSpans * sizeof(CodeSpan));
+                if (spans == NULL)
+                    return NULL;
+            }
+            spans[numSpans].insns = pCode->insns;
+            spans[numSpans].insnsSize = pCode->insnsSize;
+            numSpans++;
+        }
+    }
+
+    *pNumSpans = numSpans;
+    return spans;
+}
+
+int main(int argc, char* const argv[])
+{
+    static const char* kMethodNames[] = { "format table",
+        "descriptor", "descriptor, one switch" };
+    const InstructionWidth* widths = dexCreateInstrWidthTable();
+    const InstructionFormat* fmts = dexCreateInstrFormatTable();
+    DexFile* pDexFile;
+    CodeSpan* spans;
+    int numSpans;
+    FILE* fp;
+    u1* data;
+    long length;
+    u4 expected = 0;
+    int method;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s file.dex\n", argv[0]);
+        return 2;
+    }
+
+    fp = fopen(argv[1], "rb");
+    if (fp == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    data = malloc(length);
+    if (data == NULL || fread(data, 1, length, fp) != (size_t) length) {
+        fprintf(stderr, "%s: unable to read\n", argv[1]);
+        return 1;
+    }
+    fclose(fp);
+
+    pDexFile = dexFileParse(data, length, kDexParseDefault);
+    if (pDexFile == NULL) {
+        fprintf(stderr, "%s: not a valid DEX file\n", argv[1]);
+        return 1;
+    }
+    spans = collectCode(pDexFile, &numSpans);
+    if (spans == NULL) {
+        fprintf(stderr, "%s: no code\n", argv[1]);
+        return 1;
+    }
+
+    printf("%-24s %12s\n", "decoder", "M insns/s");
+
+    for (method = 0; method < 3; method++) {
+        long long start, elapsed;
+        u8 total = 0;
+
+        start = nowNanos();
+        do {
+            u8 count;
+            u4 sum = decodeAll(method, spans, numSpans, widths, fmts, &count);
+
+            if (method == 0 && total == 0) {
+                expected = sum;
+            } else if (sum != expected) {
+                fprintf(stderr, "%s decoded different operands\n",
+                    kMethodNames[method]);
+                return 1;
+            }
+            total += count;
+            elapsed = nowNanos() - start;
+        } while (elapsed < kMinNanos);
+
+        printf("%-24s %12.1f\n", kMethodNames[method],
+            (double) total * 1000.0 / elapsed);
+    }
+
+    free(spans);
+    dexFileFree(pDexFile);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Microbenchmark for the bulk unsigned LEB128 decoders.  Each stream is
+ * decoded with a plain readUnsignedLeb128() loop, with
+ * readUnsignedLeb128Array(), and with readUnsignedLeb128ArraySimd().
+ */
+#include "libdex/Leb128.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define kNumValues  (1 << 16)
+#define kBatch      256
+#define kMinNanos   200000000LL
+
+typedef enum StreamKind {
+    kStreamOneByte,
+    kStreamClassData,
+    kStreamRandom,
+} StreamKind;
+
+static const char* kStreamNames[] = { "1-byte", "class_data", "random" };
+
+static u4 gSeed = 12345;
+
+static u4 nextRandom(void)
+{
+    gSeed = gSeed * 1103515245 + 12345;
+    return gSeed >> 8;
+}
+
+static u1* writeUnsignedLeb128(u1* ptr, u4 value)
+{
+    while (value > 0x7f) {
+        *ptr++ = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    *ptr++ = value;
+    return ptr;
+}
+
+/*
+ * Picks a value for the stream.  The class_data mix follows the method
+ * triples of a typical app: small index deltas, one or two byte access
+ * flags, and three byte code offsets.
+ */
+static u4 pickValue(StreamKind kind, u4 i)
+{
+    switch (kind) {
+    case kStreamOneByte:
+        return nextRandom() & 0x7f;
+    case kStreamClassData:
+        switch (i % 3) {
+        case 0:  return 1 + (nextRandom() % 8);
+        case 1:  return (nextRandom() % 4 == 0) ? 0x10001 : 0x0001;
+        default: return 0x20000 + (nextRandom() % 0x100000);
+        }
+    default:
+        return nextRandom() >> (nextRandom() % 32);
+    }
+}
+
+static long long nowNanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Decodes the whole stream with the given method; returns a checksum of
+ * the values so the work can't be optimized away.
+ */
+static u4 decodeStream(int method, const u1* data, const u1* limit, u4* out)
+{
+    const u1* ptr = data;
+    u4 sum = 0;
+    u4 i, j;
+
+    for (i = 0; i < kNumValues; i += kBatch) {
+        switch (method) {
+        case 0:
+            for (j = 0; j < kBatch; j++)
+                out[j] = readUnsignedLeb128(&ptr);
+            break;
+        case 1:
+            readUnsignedLeb128Array(&ptr, out, kBatch);
+            break;
+        default:
+            readUnsignedLeb128ArraySimd(&ptr, limit, out, kBatch);
+            break;
+        }
+        for (j = 0; j < kBatch; j++)
+            sum += out[j];
+    }
+
+    return sum;
+}
+
+int main(void)
+{
+    static const char* kMethodNames[] = { "scalar loop", "bulk",
+        "bulk, SIMD" };
+    u1* data = malloc(kNumValues * 5 + 16);
+    u4 out[kBatch];
+    int kind, method;
+
+    if (data == NULL)
+        return 1;
+
+    printf("%-12s %-14s %10s\n", "stream", "decoder", "ns/value");
+
+    for (kind = kStreamOneByte; kind <= kStreamRandom; kind++) {
+        u1* end = data;
+        u4 expected = 0;
+        u4 i;
+
+        for (i = 0; i < kNumValues; i++) {
+            u4 value = pickValue(kind, i);
+            expected += value;
+            end = writeUnsignedLeb128(end, value);
+        }
+        memset(end, 0, 16);
+
+        for (method = 0; method < 3; method++) {
+            long long start, elapsed;
+            long long rounds = 0;
+
+            start = nowNanos();
+            do {
+                if (decodeStream(method, data, end, out) != expected) {
+                    fprintf(stderr, "%s: %s decoded wrong values\n",
+                        kStreamNames[kind], kMethodNames[method]);
+                    return 1;
+                }
+                rounds++;
+                elapsed = nowNanos() - start;
+            } while (elapsed < kMinNanos);
+
+            printf("%-12s %-14s %10.3f\n", kStreamNames[kind],
+                kMethodNames[method],
+                (double) elapsed / (rounds * kNumValues));
+        }
+    }
+
+    free(data);
+    return 0;
+}
@@ -36,23 +36,26 @@
 #include "libdex/InstrUtils.h"
 #include "libdex/SysUtil.h"
 #include "libdex/CmdUtils.h"
+#include "libdex/DexLineIndex.h"
+#include "libdex/DexMemberCache.h"
+#include "libdex/DexMetaIndex.h"
+#include "libdex/DexArena.h"
 
-#include "dexdump/OpCodeNames.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <errno.h>
 #include <assert.h>
+#include <poll.h>
+#include <sys/wait.h>
 
 static const char* gProgName = "dexdump";
 
-static InstructionWidth* gInstrWidth;
-static InstructionFormat* gInstrFormat;
-
 typedef enum OutputFormat {
     OUTPUT_PLAIN = 0,               /* default */
     OUTPUT_XML,                     /* fancy */
@@ -70,14 +73,58 @@ struct {
     const char* tempFileName;
     bool exportsOnly;
     bool verbose;
+    int numJobs;
+    const char* lineIndexOut;
+    const char* lineIndexIn;
+    const char* className;
+    char* methodClass;          /* -M, split into its three parts */
+    const char* methodName;
+    const char* methodSignature;    /* NULL matches any */
+    bool useSidecar;
+    bool verifyOnly;
+    bool verifySignature;
 } gOptions;
 
 /* basic info about a field or method */
-typedef struct FieldMethodInfo {
-    const char* classDescriptor;
-    const char* name;
-    const char* signature;
-} FieldMethodInfo;
+typedef DexMemberInfo FieldMethodInfo;
+
+/*
+ * Output is formatted into a growable buffer rather than straight to
+ * stdout.  Each thread has its own current sink, so classes can be dumped
+ * on several threads at once and then stitched together in order.
+ */
+typedef struct OutputSink {
+    char*   buf;
+    size_t  len;
+    size_t  max;
+} OutputSink;
+
+/* where the main thread's output collects before going to stdout */
+static OutputSink gStdoutSink;
+
+/* the calling thread's current sink */
+static __thread OutputSink* gOut;
+
+/* flush to stdout once this much has piled up */
+#define kOutputFlushSize    (64 * 1024)
+
+/*
+ * Scratch space for dumping one class.  It's reset rather than freed
+ * between classes, so once it has grown to fit the dump path stops
+ * calling malloc for every field and method.
+ */
+typedef struct DumpScratch {
+    DexArena    arena;          /* access flag strings, package names */
+    OutputSink  locals;         /* see dumpDebugInfo() */
+} DumpScratch;
+
+/* the calling thread's current scratch space */
+static __thread DumpScratch* gScratch;
+
+#define kScratchChunkSize   4096
+
+/* number of classes handed to each thread per round of parallel dumping */
+#define kClassesPerThread   64
 
 /*
  * Get 2 little-endian bytes. 
@@ -96,108 +143,174 @@ static inline u4 get4LE(unsigned char const* pSrc)
 }   
 
 /*
- * Converts a single-character primitive type into its human-readable
- * equivalent.
+ * Make sure "pOut" has room for "len" more bytes.
  */
-static const char* primitiveTypeLabel(char typeChar)
+static void sinkReserve(OutputSink* pOut, size_t len)
 {
-    switch (typeChar) {
-    case 'B':   return "byte";
-    case 'C':   return "char";
-    case 'D':   return "double";
-    case 'F':   return "float";
-    case 'I':   return "int";
-    case 'J':   return "long";
-    case 'S':   return "short";
-    case 'V':   return "void";
-    case 'Z':   return "boolean";
-    default:
-                return "UNKNOWN";
+    if (pOut->max - pOut->len < len) {
+        size_t newMax = (pOut->max == 0) ? 4096 : pOut->max;
+        while (newMax - pOut->len < len)
+            newMax *= 2;
+        pOut->buf = (char*) realloc(pOut->buf, newMax);
+        if (pOut->buf == NULL) {
+            fprintf(stderr, "%s: out of memory\n", gProgName);
+            exit(1);
+        }
+        pOut->max = newMax;
     }
 }
 
 /*
- * Converts a type descriptor to human-readable "dotted" form.  For
- * example, "Ljava/lang/String;" becomes "java.lang.String", and
- * "[I" becomes "int[]".  Also converts '$' to '.', which means this
- * form can't be converted back to a descriptor.
+ * Append bytes to the current thread's sink.
  */
-static char* descriptorToDot(const char* str)
+static void outWrite(const char* data, size_t len)
 {
-    int targetLen = strlen(str);
-    int offset = 0;
-    int arrayDepth = 0;
-    char* newStr;
+    OutputSink* pOut = gOut;
 
-    /* strip leading [s; will be added to end */
-    while (targetLen > 1 && str[offset] == '[') {
-        offset++;
-        targetLen--;
-    }
-    arrayDepth = offset;
+    sinkReserve(pOut, len);
+    memcpy(pOut->buf + pOut->len, data, len);
+    pOut->len += len;
+}
 
-    if (targetLen == 1) {
-        /* primitive type */
-        str = primitiveTypeLabel(str[offset]);
-        offset = 0;
-        targetLen = strlen(str);
-    } else {
-        /* account for leading 'L' and trailing ';' */
-        if (targetLen >= 2 && str[offset] == 'L' &&
-            str[offset+targetLen-1] == ';')
-        {
-            targetLen -= 2;
-            offset++;
-        }
+/*
+ * printf(), fputs() and putchar() equivalents for the current sink.
+ */
+static void outPrintf(const char* fmt, ...)
+    __attribute__ ((format (printf, 1, 2)));
+static void outPrintf(const char* fmt, ...)
+{
+    OutputSink* pOut = gOut;
+    va_list args;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(pOut->buf + pOut->len, pOut->max - pOut->len, fmt, args);
+    va_end(args);
+
+    if (len >= (int) (pOut->max - pOut->len)) {
+        sinkReserve(pOut, len + 1);
+        va_start(args, fmt);
+        vsnprintf(pOut->buf + pOut->len, pOut->max - pOut->len, fmt, args);
+        va_end(args);
     }
+    pOut->len += len;
+}
 
-    newStr = malloc(targetLen + arrayDepth * 2 +1);
+static void outPuts(const char* str)
+{
+    outWrite(str, strlen(str));
+}
 
-    /* copy class name over */
-    int i;
-    for (i = 0; i < targetLen; i++) {
-        char ch = str[offset + i];
-        newStr[i] = (ch == '/' || ch == '$') ? '.' : ch;
-    }
+static void outPutc(char c)
+{
+    OutputSink* pOut = gOut;
 
-    /* add the appropriate number of brackets for arrays */
-    while (arrayDepth-- > 0) {
-        newStr[i++] = '[';
-        newStr[i++] = ']';
-    }
-    newStr[i] = '\0';
-//    assert(i == targetLen + arrayDepth * 2);
+    sinkReserve(pOut, 1);
+    pOut->buf[pOut->len++] = c;
+}
+
+/* digits for outHex() */
+static const char kHexDigits[] = "0123456789abcdef";
 
-    return newStr;
+/*
+ * Append "val" in lower-case hex, zero-padded to at least "width" digits.
+ * Same output as printf("%0*x"), without the format parsing; the
+ * disassembly calls this a few times per instruction.
+ */
+static void outHex(u4 val, int width)
+{
+    OutputSink* pOut = gOut;
+    char tmp[8];
+    int n = 0;
+
+    do {
+        tmp[n++] = kHexDigits[val & 0x0f];
+        val >>= 4;
+    } while (val != 0);
+    while (n < width)
+        tmp[n++] = '0';
+
+    sinkReserve(pOut, n);
+    while (n > 0)
+        pOut->buf[pOut->len++] = tmp[--n];
 }
 
 /*
- * Converts the class name portion of a type descriptor to human-readable
- * "dotted" form.
- *
- * Returns a newly-allocated string.
+ * Append "val" in decimal, like printf("%d").
  */
-static char* descriptorClassToDot(const char* str)
+static void outDec(s4 val)
 {
-    const char* lastSlash;
-    char* newStr;
-    char* cp;
+    OutputSink* pOut = gOut;
+    char tmp[11];
+    u4 mag = (val < 0) ? -(u4) val : (u4) val;
+    int n = 0;
+
+    do {
+        tmp[n++] = '0' + mag % 10;
+        mag /= 10;
+    } while (mag != 0);
+    if (val < 0)
+        tmp[n++] = '-';
+
+    sinkReserve(pOut, n);
+    while (n > 0)
+        pOut->buf[pOut->len++] = tmp[--n];
+}
 
-    /* reduce to just the class name, trimming trailing ';' */
-    lastSlash = strrchr(str, '/');
-    if (lastSlash == NULL)
-        lastSlash = str + 1;        /* start past 'L' */
-    else
-        lastSlash++;                /* start past '/' */
+/*
+ * Append a register name ("v%d").
+ */
+static void outReg(u4 reg)
+{
+    outPutc('v');
+    outDec((s4) reg);
+}
 
-    newStr = strdup(lastSlash);
-    newStr[strlen(lastSlash)-1] = '\0';
-    for (cp = newStr; *cp != '\0'; cp++) {
-        if (*cp == '$')
-            *cp = '.';
+/*
+ * Send everything collected in the main sink to stdout.
+ *
+ * The sink is written with write(2) directly, since stdio would only copy
+ * it into its own buffer first.  Anything already sitting in the stdio
+ * buffer (e.g. log messages) goes out ahead of it to keep the ordering.
+ */
+static void flushOutput(void)
+{
+    const char* data = gStdoutSink.buf;
+    size_t len = gStdoutSink.len;
+
+    fflush(stdout);
+    while (len > 0) {
+        ssize_t actual = write(STDOUT_FILENO, data, len);
+        if (actual < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        data += actual;
+        len -= actual;
     }
+    gStdoutSink.len = 0;
+}
+
+/*
+ * Get the human-readable "dotted" form of a type, e.g. "java.lang.String"
+ * or "int[]".  See dexGetTypeNames().
+ */
+static const char* typeToDot(const DexFile* pDexFile, u4 typeIdx)
+{
+    const DexTypeNames* pNames = dexGetTypeNames(pDexFile, typeIdx);
 
-    return newStr;
+    return (pNames != NULL) ? pNames->dotted : "??";
+}
+
+/*
+ * Get the class name portion of a type in "dotted" form, e.g. "String".
+ */
+static const char* typeClassToDot(const DexFile* pDexFile, u4 typeIdx)
+{
+    const DexTypeNames* pNames = dexGetTypeNames(pDexFile, typeIdx);
+
+    return (pNames != NULL) ? pNames->classDotted : "??";
 }
 
 /*
@@ -250,6 +363,8 @@ typedef enum AccessFor {
  *
  * In the base language the access_flags fields are type u2; in Dalvik
  * they're u4.
+ *
+ * The result lives in the current scratch arena.
  */
 static char* createAccessFlagStr(u4 flags, AccessFor forWhat)
 {
@@ -330,7 +445,8 @@ static char* createAccessFlagStr(u4 flags, AccessFor forWhat)
      * string above as the base metric.
      */
     count = countOnes(flags);
-    cp = str = (char*) malloc(count * (kLongest+1) +1);
+    cp = str = (char*) dexArenaAlloc(&gScratch->arena,
+                    count * (kLongest+1) +1);
 
     for (i = 0; i < NUM_FLAGS; i++) {
         if (flags & 0x01) {
@@ -357,37 +473,69 @@ void dumpFileHeader(const DexFile* pDexFile)
 {
     const DexHeader* pHeader = pDexFile->pHeader;
 
-    printf("DEX file header:\n");
-    printf("magic               : '%.8s'\n", pHeader->magic);
-    printf("checksum            : %08x\n", pHeader->checksum);
-    printf("signature           : %02x%02x...%02x%02x\n",
+    outPrintf("DEX file header:\n");
+    outPrintf("magic               : '%.8s'\n", pHeader->magic);
+    outPrintf("checksum            : %08x\n", pHeader->checksum);
+    outPrintf("signature           : %02x%02x...%02x%02x\n",
         pHeader->signature[0], pHeader->signature[1],
         pHeader->signature[kSHA1DigestLen-2],
         pHeader->signature[kSHA1DigestLen-1]);
-    printf("file_size           : %d\n", pHeader->fileSize);
-    printf("header_size         : %d\n", pHeader->headerSize);
-    printf("link_size           : %d\n", pHeader->linkSize);
-    printf("link_off            : %d (0x%06x)\n",
+    outPrintf("file_size           : %d\n", pHeader->fileSize);
+    outPrintf("header_size         : %d\n", pHeader->headerSize);
+    outPrintf("link_size           : %d\n", pHeader->linkSize);
+    outPrintf("link_off            : %d (0x%06x)\n",
         pHeader->linkOff, pHeader->linkOff);
-    printf("string_ids_size     : %d\n", pHeader->stringIdsSize);
-    printf("string_ids_off      : %d (0x%06x)\n",
+    outPrintf("string_ids_size     : %d\n", pHeader->stringIdsSize);
+    outPrintf("string_ids_off      : %d (0x%06x)\n",
         pHeader->stringIdsOff, pHeader->stringIdsOff);
-    printf("type_ids_size       : %d\n", pHeader->typeIdsSize);
-    printf("type_ids_off        : %d (0x%06x)\n",
+    outPrintf("type_ids_size       : %d\n", pHeader->typeIdsSize);
+    outPrintf("type_ids_off        : %d (0x%06x)\n",
         pHeader->typeIdsOff, pHeader->typeIdsOff);
-    printf("field_ids_size      : %d\n", pHeader->fieldIdsSize);
-    printf("field_ids_off       : %d (0x%06x)\n",
+    outPrintf("field_ids_size      : %d\n", pHeader->fieldIdsSize);
+    outPrintf("field_ids_off       : %d (0x%06x)\n",
         pHeader->fieldIdsOff, pHeader->fieldIdsOff);
-    printf("method_ids_size     : %d\n", pHeader->methodIdsSize);
-    printf("method_ids_off      : %d (0x%06x)\n",
+    outPrintf("method_ids_size     : %d\n", pHeader->methodIdsSize);
+    outPrintf("method_ids_off      : %d (0x%06x)\n",
         pHeader->methodIdsOff, pHeader->methodIdsOff);
-    printf("class_defs_size     : %d\n", pHeader->classDefsSize);
-    printf("class_defs_off      : %d (0x%06x)\n",
+    outPrintf("class_defs_size     : %d\n", pHeader->classDefsSize);
+    outPrintf("class_defs_off      : %d (0x%06x)\n",
         pHeader->classDefsOff, pHeader->classDefsOff);
-    printf("data_size           : %d\n", pHeader->dataSize);
-    printf("data_off            : %d (0x%06x)\n",
+    outPrintf("data_size           : %d\n", pHeader->dataSize);
+    outPrintf("data_off            : %d (0x%06x)\n",
         pHeader->dataOff, pHeader->dataOff);
-    printf("\n");
+    outPrintf("\n");
+}
+
+/*
+ * Check a class' class_data_item and set up an iterator over it.
+ *
+ * Returns false if the data is malformed.
+ */
+static bool startClassData(const DexFile* pDexFile,
+    const DexClassDef* pClassDef, DexClassDataIterator* pIter)
+{
+    const u1* pEncodedData = dexGetClassData(pDexFile, pClassDef);
+    const u1* pLimit = pDexFile->baseAddr + pDexFile->pHeader->fileSize;
+
+    /* a sidecar index has it decoded (and checked) already */
+    switch (dexGetIndexedClassData(pDexFile,
+                pClassDef - pDexFile->pClassDefs, pIter))
+    {
+    case 1:
+        return true;
+    case -1:
+        return false;
+    default:
+        break;
+    }
+
+    if (pEncodedData != NULL && pEncodedData >= pLimit)
+        return false;
+    if (!dexVerifyClassData(pEncodedData, pLimit))
+        return false;
+
+    dexClassDataIteratorInit(pIter, pEncodedData);
+    return true;
 }
 
 /*
@@ -396,39 +544,36 @@ void dumpFileHeader(const DexFile* pDexFile)
 void dumpClassDef(DexFile* pDexFile, int idx)
 {
     const DexClassDef* pClassDef;
-    const u1* pEncodedData;
-    DexClassData* pClassData;
+    DexClassDataIterator classData;
 
     pClassDef = dexGetClassDef(pDexFile, idx);
-    pEncodedData = dexGetClassData(pDexFile, pClassDef);
-    pClassData = dexReadAndVerifyClassData(&pEncodedData, NULL);
 
-    if (pClassData == NULL) {
+    if (!startClassData(pDexFile, pClassDef, &classData)) {
         fprintf(stderr, "Trouble reading class data\n");
         return;
     }
 
-    printf("Class #%d header:\n", idx);
-    printf("class_idx           : %d\n", pClassDef->classIdx);
-    printf("access_flags        : %d (0x%04x)\n",
+    outPrintf("Class #%d header:\n", idx);
+    outPrintf("class_idx           : %d\n", pClassDef->classIdx);
+    outPrintf("access_flags        : %d (0x%04x)\n",
         pClassDef->accessFlags, pClassDef->accessFlags);
-    printf("superclass_idx      : %d\n", pClassDef->superclassIdx);
-    printf("interfaces_off      : %d (0x%06x)\n",
+    outPrintf("superclass_idx      : %d\n", pClassDef->superclassIdx);
+    outPrintf("interfaces_off      : %d (0x%06x)\n",
         pClassDef->interfacesOff, pClassDef->interfacesOff);
-    printf("source_file_idx     : %d\n", pClassDef->sourceFileIdx);
-    printf("annotations_off     : %d (0x%06x)\n",
+    outPrintf("source_file_idx     : %d\n", pClassDef->sourceFileIdx);
+    outPrintf("annotations_off     : %d (0x%06x)\n",
         pClassDef->annotationsOff, pClassDef->annotationsOff);
-    printf("class_data_off      : %d (0x%06x)\n",
+    outPrintf("class_data_off      : %d (0x%06x)\n",
         pClassDef->classDataOff, pClassDef->classDataOff);
-    printf("static_fields_size  : %d\n", pClassData->header.staticFieldsSize);
-    printf("instance_fields_size: %d\n",
-            pClassData->header.instanceFieldsSize);
-    printf("direct_methods_size : %d\n", pClassData->header.directMethodsSize);
-    printf("virtual_methods_size: %d\n",
-            pClassData->header.virtualMethodsSize);
-    printf("\n");
-
-    free(pClassData);
+    outPrintf("static_fields_size  : %d\n",
+            classData.header.staticFieldsSize);
+    outPrintf("instance_fields_size: %d\n",
+            classData.header.instanceFieldsSize);
+    outPrintf("direct_methods_size : %d\n",
+            classData.header.directMethodsSize);
+    outPrintf("virtual_methods_size: %d\n",
+            classData.header.virtualMethodsSize);
+    outPrintf("\n");
 }
 
 /*
@@ -441,11 +586,10 @@ void dumpInterface(const DexFile* pDexFile, const DexTypeItem* pTypeItem,
         dexStringByTypeIdx(pDexFile, pTypeItem->typeIdx);
 
     if (gOptions.outputFormat == OUTPUT_PLAIN) {
-        printf("    #%d              : '%s'\n", i, interfaceName);
+        outPrintf("    #%d              : '%s'\n", i, interfaceName);
     } else {
-        char* dotted = descriptorToDot(interfaceName);
-        printf("<implements name=\"%s\">\n</implements>\n", dotted);
-        free(dotted);
+        outPrintf("<implements name=\"%s\">\n</implements>\n",
+            typeToDot(pDexFile, pTypeItem->typeIdx));
     }
 }
 
@@ -457,11 +601,11 @@ void dumpCatches(DexFile* pDexFile, const DexCode* pCode)
     u4 triesSize = pCode->triesSize;
 
     if (triesSize == 0) {
-        printf("      catches       : (none)\n");
+        outPrintf("      catches       : (none)\n");
         return;
     } 
 
-    printf("      catches       : %d\n", triesSize);
+    outPrintf("      catches       : %d\n", triesSize);
 
     const DexTry* pTries = dexGetTries(pCode);
     u4 i;
@@ -472,7 +616,11 @@ void dumpCatches(DexFile* pDexFile, const DexCode* pCode)
         u4 end = start + pTry->insnCount;
         DexCatchIterator iterator;
         
-        printf("        0x%04x - 0x%04x\n", start, end);
+        outPuts("        0x");
+        outHex(start, 4);
+        outPuts(" - 0x");
+        outHex(end, 4);
+        outPutc('\n');
 
         dexCatchIteratorInit(&iterator, pCode, pTry->handlerOff);
 
@@ -487,58 +635,64 @@ void dumpCatches(DexFile* pDexFile, const DexCode* pCode)
             descriptor = (handler->typeIdx == kDexNoIndex) ? "<any>" : 
                 dexStringByTypeIdx(pDexFile, handler->typeIdx);
             
-            printf("          %s -> 0x%04x\n", descriptor,
-                    handler->address);
+            outPuts("          ");
+            outPuts(descriptor);
+            outPuts(" -> 0x");
+            outHex(handler->address, 4);
+            outPutc('\n');
         }
     }
 }
 
 static int dumpPositionsCb(void *cnxt, u4 address, u4 lineNum)
 {
-    printf("        0x%04x line=%d\n", address, lineNum);
+    outPuts("        0x");
+    outHex(address, 4);
+    outPuts(" line=");
+    outDec((s4) lineNum);
+    outPutc('\n');
     return 0;
 }
 
 /*
- * Dump the positions list.
+ * Locals come out of the debug info interleaved with the positions, but
+ * are listed after them, so they're collected in "cnxt" (an OutputSink)
+ * until the positions are done.
  */
-void dumpPositions(DexFile* pDexFile, const DexCode* pCode, 
-        const DexMethod *pDexMethod)
-{
-    printf("      positions     : \n");
-    const DexMethodId *pMethodId 
-            = dexGetMethodId(pDexFile, pDexMethod->methodIdx);
-    const char *classDescriptor
-            = dexStringByTypeIdx(pDexFile, pMethodId->classIdx);
-
-    dexDecodeDebugInfo(pDexFile, pCode, classDescriptor, pMethodId->protoIdx,
-            pDexMethod->accessFlags, dumpPositionsCb, NULL, NULL);
-}
-
 static void dumpLocalsCb(void *cnxt, u2 reg, u4 startAddress,
         u4 endAddress, const char *name, const char *descriptor,
         const char *signature)
 {
-    printf("        0x%04x - 0x%04x reg=%d %s %s %s\n",
+    OutputSink* pSaved = gOut;
+
+    gOut = (OutputSink*) cnxt;
+    outPrintf("        0x%04x - 0x%04x reg=%d %s %s %s\n",
             startAddress, endAddress, reg, name, descriptor, 
             signature);
+    gOut = pSaved;
 }
 
 /*
- * Dump the locals list.
+ * Dump the positions and locals lists.  Both are encoded in the debug
+ * info, which we decode in a single pass.
  */
-void dumpLocals(DexFile* pDexFile, const DexCode* pCode,
+void dumpDebugInfo(DexFile* pDexFile, const DexCode* pCode,
         const DexMethod *pDexMethod)
 {
-    printf("      locals        : \n");
-
     const DexMethodId *pMethodId 
             = dexGetMethodId(pDexFile, pDexMethod->methodIdx);
-    const char *classDescriptor 
+    const char *classDescriptor
             = dexStringByTypeIdx(pDexFile, pMethodId->classIdx);
+    OutputSink* pLocals = &gScratch->locals;
 
+    pLocals->len = 0;
+    outPrintf("      positions     : \n");
     dexDecodeDebugInfo(pDexFile, pCode, classDescriptor, pMethodId->protoIdx,
-            pDexMethod->accessFlags, NULL, dumpLocalsCb, NULL);
+            pDexMethod->accessFlags, dumpPositionsCb, dumpLocalsCb, pLocals);
+
+    outPrintf("      locals        : \n");
+    if (pLocals->len != 0)
+        outWrite(pLocals->buf, pLocals->len);
 }
 
 /*
@@ -546,17 +700,12 @@ void dumpLocals(DexFile* pDexFile, const DexCode* pCode,
  */
 bool getMethodInfo(DexFile* pDexFile, u4 methodIdx, FieldMethodInfo* pMethInfo)
 {
-    const DexMethodId* pMethodId;
+    const DexMemberInfo* pInfo = dexGetMethodInfo(pDexFile, methodIdx);
 
-    if (methodIdx >= pDexFile->pHeader->methodIdsSize)
+    if (pInfo == NULL)
         return false;
 
-    pMethodId = dexGetMethodId(pDexFile, methodIdx);
-    pMethInfo->name = dexStringById(pDexFile, pMethodId->nameIdx);
-    pMethInfo->signature = dexCopyDescriptorFromMethodId(pDexFile, pMethodId);
-
-    pMethInfo->classDescriptor = 
-            dexStringByTypeIdx(pDexFile, pMethodId->classIdx);
+    *pMethInfo = *pInfo;
     return true;
 }
 
@@ -565,16 +714,12 @@ bool getMethodInfo(DexFile* pDexFile, u4 methodIdx, FieldMethodInfo* pMethInfo)
  */
 bool getFieldInfo(DexFile* pDexFile, u4 fieldIdx, FieldMethodInfo* pFieldInfo)
 {
-    const DexFieldId* pFieldId;
+    const DexMemberInfo* pInfo = dexGetFieldInfo(pDexFile, fieldIdx);
 
-    if (fieldIdx >= pDexFile->pHeader->fieldIdsSize)
+    if (pInfo == NULL)
         return false;
 
-    pFieldId = dexGetFieldId(pDexFile, fieldIdx);
-    pFieldInfo->name = dexStringById(pDexFile, pFieldId->nameIdx);
-    pFieldInfo->signature = dexStringByTypeIdx(pDexFile, pFieldId->typeIdx);
-    pFieldInfo->classDescriptor =
-        dexStringByTypeIdx(pDexFile, pFieldId->classIdx);
+    *pFieldInfo = *pInfo;
     return true;
 }
 
@@ -587,332 +732,459 @@ const char* getClassDescriptor(DexFile* pDexFile, u4 classIdx)
     return dexStringByTypeIdx(pDexFile, classIdx);
 }
 
+/*
+ * Append a string operand and its index ("\"%s\" // string@%0*x").
+ */
+static void outString(const char* str, u4 idx, int width)
+{
+    outPutc('"');
+    outPuts(str);
+    outPuts("\" // string@");
+    outHex(idx, width);
+}
+
+/*
+ * Append a class operand ("%s // class@%04x").
+ */
+static void outClass(DexFile* pDexFile, u4 classIdx)
+{
+    outPuts(getClassDescriptor(pDexFile, classIdx));
+    outPuts(" // class@");
+    outHex(classIdx, 4);
+}
+
+/*
+ * Append a field operand ("%s.%s:%s // field@%04x").
+ */
+static void outField(DexFile* pDexFile, u4 fieldIdx)
+{
+    FieldMethodInfo fieldInfo;
+
+    if (getFieldInfo(pDexFile, fieldIdx, &fieldInfo)) {
+        outPuts(fieldInfo.classDescriptor);
+        outPutc('.');
+        outPuts(fieldInfo.name);
+        outPutc(':');
+        outPuts(fieldInfo.signature);
+    } else {
+        outPuts("???");
+    }
+    outPuts(" // field@");
+    outHex(fieldIdx, 4);
+}
+
+/*
+ * Append a method operand ("%s.%s:%s // method@%04x").
+ */
+static void outMethod(DexFile* pDexFile, u4 methodIdx)
+{
+    FieldMethodInfo methInfo;
+
+    if (getMethodInfo(pDexFile, methodIdx, &methInfo)) {
+        outPuts(methInfo.classDescriptor);
+        outPutc('.');
+        outPuts(methInfo.name);
+        outPutc(':');
+        outPuts(methInfo.signature);
+    } else {
+        outPuts("???");
+    }
+    outPuts(" // method@");
+    outHex(methodIdx, 4);
+}
+
+/*
+ * Append a branch target and its relative offset ("%04x // %c%04x").
+ */
+static void outBranchTarget(int insnIdx, s4 targ)
+{
+    outHex(insnIdx + targ, 4);
+    outPuts(" // ");
+    outPutc((targ < 0) ? '-' : '+');
+    outHex((targ < 0) ? -(u4) targ : (u4) targ, 4);
+}
+
+/*
+ * Append a list of registers ("v%d, v%d, ...").
+ */
+static void outRegList(const u4* regs, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (i != 0)
+            outPuts(", ");
+        outReg(regs[i]);
+    }
+}
+
+/*
+ * Append a range of "count" registers starting at "first".
+ */
+static void outRegRange(u4 first, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (i != 0)
+            outPuts(", ");
+        outReg(first + i);
+    }
+}
+
+/*
+ * Append whatever an instruction's constant pool index refers to, based
+ * on the opcode's index type.
+ */
+static void outIndex(DexFile* pDexFile, const InstructionInfo* pInfo, u4 idx)
+{
+    switch (pInfo->indexType) {
+    case kIndexStringRef:
+        outString(dexStringById(pDexFile, idx), idx, 4);
+        break;
+    case kIndexTypeRef:
+        outClass(pDexFile, idx);
+        break;
+    case kIndexFieldRef:
+        outField(pDexFile, idx);
+        break;
+    case kIndexMethodRef:
+        outMethod(pDexFile, idx);
+        break;
+    default:
+        outPuts("???");
+        break;
+    }
+}
+
 /*
  * Dump a single instruction.
+ *
+ * The operands are decoded in the same switch that formats them, with the
+ * per-format decoders from InstrUtils.h, so the format is only dispatched
+ * on once per instruction.
  */
 void dumpInstruction(DexFile* pDexFile, const DexCode* pCode, int insnIdx,
-    int insnWidth, const DecodedInstruction* pDecInsn)
+    int insnWidth, const InstructionInfo* pInfo)
 {
     const u2* insns = pCode->insns;
+    const u2* pInsn = &insns[insnIdx];
+    DecodedInstruction decInsn;
     int i;
 
-    printf("%06x:", ((u1*)insns - pDexFile->baseAddr) + insnIdx*2);
+    outHex(((u1*)insns - pDexFile->baseAddr) + insnIdx*2, 6);
+    outPutc(':');
     for (i = 0; i < 8; i++) {
         if (i < insnWidth) {
             if (i == 7) {
-                printf(" ... ");
+                outPuts(" ... ");
             } else {
                 /* print 16-bit value in little-endian order */
                 const u1* bytePtr = (const u1*) &insns[insnIdx+i];
-                printf(" %02x%02x", bytePtr[0], bytePtr[1]);
+                outPutc(' ');
+                outHex(bytePtr[0], 2);
+                outHex(bytePtr[1], 2);
             }
         } else {
-            fputs("     ", stdout);
+            outPuts("     ");
         }
     }
 
-    if (pDecInsn->opCode == OP_NOP) {
+    decInsn.opCode = (OpCode) (pInsn[0] & 0xff);
+    if (decInsn.opCode == OP_NOP) {
         u2 instr = get2LE((const u1*) &insns[insnIdx]);
         if (instr == kPackedSwitchSignature) {
-            printf("|%04x: packed-switch-data (%d units)",
+            outPrintf("|%04x: packed-switch-data (%d units)",
                 insnIdx, insnWidth);
         } else if (instr == kSparseSwitchSignature) {
-            printf("|%04x: sparse-switch-data (%d units)",
+            outPrintf("|%04x: sparse-switch-data (%d units)",
                 insnIdx, insnWidth);
         } else if (instr == kArrayDataSignature) {
-            printf("|%04x: array-data (%d units)",
+            outPrintf("|%04x: array-data (%d units)",
                 insnIdx, insnWidth);
         } else {
-            printf("|%04x: nop // spacer", insnIdx);
+            outPrintf("|%04x: nop // spacer", insnIdx);
         }
     } else {
-        printf("|%04x: %s", insnIdx, getOpcodeName(pDecInsn->opCode));
+        outPutc('|');
+        outHex(insnIdx, 4);
+        outPuts(": ");
+        outPuts(pInfo->name);
     }
 
-    switch (dexGetInstrFormat(gInstrFormat, pDecInsn->opCode)) {
+    switch (pInfo->format) {
     case kFmt10x:        // op
         break;
     case kFmt12x:        // op vA, vB
-        printf(" v%d, v%d", pDecInsn->vA, pDecInsn->vB);
+        dexDecode12x(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", ");
+        outReg(decInsn.vB);
+        break;
+    case kFmt22x:        // op vAA, vBBBB
+        dexDecode21c(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", ");
+        outReg(decInsn.vB);
+        break;
+    case kFmt32x:        // op vAAAA, vBBBB
+        dexDecode32x(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", ");
+        outReg(decInsn.vB);
         break;
     case kFmt11n:        // op vA, #+B
-        printf(" v%d, #int %d // #%x",
-            pDecInsn->vA, (s4)pDecInsn->vB, (u1)pDecInsn->vB);
+        dexDecode11n(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", #int ");
+        outDec((s4)decInsn.vB);
+        outPuts(" // #");
+        outHex((u1)decInsn.vB, 1);
         break;
     case kFmt11x:        // op vAA
-        printf(" v%d", pDecInsn->vA);
+        dexDecode11x(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
         break;
     case kFmt10t:        // op +AA
-    case kFmt20t:        // op +AAAA
-        {
-            s4 targ = (s4) pDecInsn->vA;
-            printf(" %04x // %c%04x",
-                insnIdx + targ,
-                (targ < 0) ? '-' : '+',
-                (targ < 0) ? -targ : targ);
-        }
+        dexDecode10t(pInsn, &decInsn);
+        outPutc(' ');
+        outBranchTarget(insnIdx, (s4) decInsn.vA);
         break;
-    case kFmt22x:        // op vAA, vBBBB
-        printf(" v%d, v%d", pDecInsn->vA, pDecInsn->vB);
+    case kFmt20t:        // op +AAAA
+        dexDecode20t(pInsn, &decInsn);
+        outPutc(' ');
+        outBranchTarget(insnIdx, (s4) decInsn.vA);
         break;
     case kFmt21t:        // op vAA, +BBBB
-        {
-            s4 targ = (s4) pDecInsn->vB;
-            printf(" v%d, %04x // %c%04x", pDecInsn->vA,
-                insnIdx + targ,
-                (targ < 0) ? '-' : '+',
-                (targ < 0) ? -targ : targ);
-        }
+        dexDecode21s(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", ");
+        outBranchTarget(insnIdx, (s4) decInsn.vB);
         break;
     case kFmt21s:        // op vAA, #+BBBB
-        printf(" v%d, #int %d // #%x",
-            pDecInsn->vA, (s4)pDecInsn->vB, (u2)pDecInsn->vB);
+        dexDecode21s(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", #int ");
+        outDec((s4)decInsn.vB);
+        outPuts(" // #");
+        outHex((u2)decInsn.vB, 1);
         break;
     case kFmt21h:        // op vAA, #+BBBB0000[00000000]
+        dexDecode21c(pInsn, &decInsn);
         // The printed format varies a bit based on the actual opcode.
-        if (pDecInsn->opCode == OP_CONST_HIGH16) {
-            s4 value = pDecInsn->vB << 16;
-            printf(" v%d, #int %d // #%x",
-                pDecInsn->vA, value, (u2)pDecInsn->vB);
+        if (decInsn.opCode == OP_CONST_HIGH16) {
+            s4 value = decInsn.vB << 16;
+            outPrintf(" v%d, #int %d // #%x",
+                decInsn.vA, value, (u2)decInsn.vB);
         } else {
-            s8 value = ((s8) pDecInsn->vB) << 48;
-            printf(" v%d, #long %lld // #%x",
-                pDecInsn->vA, value, (u2)pDecInsn->vB);
+            s8 value = ((s8) decInsn.vB) << 48;
+            outPrintf(" v%d, #long %lld // #%x",
+                decInsn.vA, value, (u2)decInsn.vB);
         }
         break;
     case kFmt21c:        // op vAA, thing@BBBB
-        if (pDecInsn->opCode == OP_CONST_STRING) {
-            printf(" v%d, \"%s\" // string@%04x", pDecInsn->vA,
-                dexStringById(pDexFile, pDecInsn->vB), pDecInsn->vB);
-        } else if (pDecInsn->opCode == OP_CHECK_CAST ||
-                   pDecInsn->opCode == OP_NEW_INSTANCE ||
-                   pDecInsn->opCode == OP_CONST_CLASS)
-        {
-            printf(" v%d, %s // class@%04x", pDecInsn->vA,
-                getClassDescriptor(pDexFile, pDecInsn->vB), pDecInsn->vB);
-        } else /* OP_SGET* */ {
-            FieldMethodInfo fieldInfo;
-            if (getFieldInfo(pDexFile, pDecInsn->vB, &fieldInfo)) {
-                printf(" v%d, %s.%s:%s // field@%04x", pDecInsn->vA,
-                    fieldInfo.classDescriptor, fieldInfo.name,
-                    fieldInfo.signature, pDecInsn->vB);
-            } else {
-                printf(" v%d, ??? // field@%04x", pDecInsn->vA, pDecInsn->vB);
-            }
-        }
+        dexDecode21c(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", ");
+        outIndex(pDexFile, pInfo, decInsn.vB);
         break;
     case kFmt23x:        // op vAA, vBB, vCC
-        printf(" v%d, v%d, v%d", pDecInsn->vA, pDecInsn->vB, pDecInsn->vC);
+        dexDecode23x(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", ");
+        outReg(decInsn.vB);
+        outPuts(", ");
+        outReg(decInsn.vC);
         break;
     case kFmt22b:        // op vAA, vBB, #+CC
-        printf(" v%d, v%d, #int %d // #%02x",
-            pDecInsn->vA, pDecInsn->vB, (s4)pDecInsn->vC, (u1)pDecInsn->vC);
+        dexDecode22b(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", ");
+        outReg(decInsn.vB);
+        outPuts(", #int ");
+        outDec((s4)decInsn.vC);
+        outPuts(" // #");
+        outHex((u1)decInsn.vC, 2);
         break;
     case kFmt22t:        // op vA, vB, +CCCC
-        {
-            s4 targ = (s4) pDecInsn->vC;
-            printf(" v%d, v%d, %04x // %c%04x", pDecInsn->vA, pDecInsn->vB,
-                insnIdx + targ,
-                (targ < 0) ? '-' : '+',
-                (targ < 0) ? -targ : targ);
-        }
+        dexDecode22s(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", ");
+        outReg(decInsn.vB);
+        outPuts(", ");
+        outBranchTarget(insnIdx, (s4) decInsn.vC);
         break;
     case kFmt22s:        // op vA, vB, #+CCCC
-        printf(" v%d, v%d, #int %d // #%04x",
-            pDecInsn->vA, pDecInsn->vB, (s4)pDecInsn->vC, (u2)pDecInsn->vC);
+        dexDecode22s(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", ");
+        outReg(decInsn.vB);
+        outPuts(", #int ");
+        outDec((s4)decInsn.vC);
+        outPuts(" // #");
+        outHex((u2)decInsn.vC, 4);
         break;
     case kFmt22c:        // op vA, vB, thing@CCCC
-        if (pDecInsn->opCode >= OP_IGET && pDecInsn->opCode <= OP_IPUT_SHORT) {
-            FieldMethodInfo fieldInfo;
-            if (getFieldInfo(pDexFile, pDecInsn->vC, &fieldInfo)) {
-                printf(" v%d, v%d, %s.%s:%s // field@%04x", pDecInsn->vA,
-                    pDecInsn->vB, fieldInfo.classDescriptor, fieldInfo.name,
-                    fieldInfo.signature, pDecInsn->vC);
-            } else {
-                printf(" v%d, v%d, ??? // field@%04x", pDecInsn->vA,
-                    pDecInsn->vB, pDecInsn->vC);
-            }
-        } else {
-            printf(" v%d, v%d, %s // class@%04x",
-                pDecInsn->vA, pDecInsn->vB,
-                getClassDescriptor(pDexFile, pDecInsn->vC), pDecInsn->vC);
-        }
+        dexDecode22c(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", ");
+        outReg(decInsn.vB);
+        outPuts(", ");
+        outIndex(pDexFile, pInfo, decInsn.vC);
         break;
     case kFmt22cs:       // [opt] op vA, vB, field offset CCCC
-        printf(" v%d, v%d, [obj+%04x]",
-            pDecInsn->vA, pDecInsn->vB, pDecInsn->vC);
+        dexDecode22c(pInsn, &decInsn);
+        outPrintf(" v%d, v%d, [obj+%04x]",
+            decInsn.vA, decInsn.vB, decInsn.vC);
         break;
     case kFmt30t:
-        printf(" #%08x", pDecInsn->vA);
+        dexDecode30t(pInsn, &decInsn);
+        outPuts(" #");
+        outHex(decInsn.vA, 8);
         break;
     case kFmt31i:        // op vAA, #+BBBBBBBB
+        dexDecode31i(pInsn, &decInsn);
         {
             /* this is often, but not always, a float */
             union {
                 float f;
                 u4 i;
             } conv;
-            conv.i = pDecInsn->vB;
-            printf(" v%d, #float %f // #%08x",
-                pDecInsn->vA, conv.f, pDecInsn->vB);
+            conv.i = decInsn.vB;
+            outPrintf(" v%d, #float %f // #%08x",
+                decInsn.vA, conv.f, decInsn.vB);
         }
         break;
     case kFmt31c:        // op vAA, thing@BBBBBBBB
-        printf(" v%d, \"%s\" // string@%08x", pDecInsn->vA,
-            dexStringById(pDexFile, pDecInsn->vB), pDecInsn->vB);
+        dexDecode31i(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", ");
+        outString(dexStringById(pDexFile, decInsn.vB), decInsn.vB, 8);
         break;
     case kFmt31t:       // op vAA, offset +BBBBBBBB
-        printf(" v%d, %08x // +%08x",
-            pDecInsn->vA, insnIdx + pDecInsn->vB, pDecInsn->vB);
-        break;
-    case kFmt32x:        // op vAAAA, vBBBB
-        printf(" v%d, v%d", pDecInsn->vA, pDecInsn->vB);
+        dexDecode31i(pInsn, &decInsn);
+        outPutc(' ');
+        outReg(decInsn.vA);
+        outPuts(", ");
+        outHex(insnIdx + decInsn.vB, 8);
+        outPuts(" // +");
+        outHex(decInsn.vB, 8);
         break;
     case kFmt35c:        // op vB, {vD, vE, vF, vG, vA}, thing@CCCC
+        dexDecode35c(pInsn, &decInsn);
         {
             /* NOTE: decoding of 35c doesn't quite match spec */
-            fputs(" {", stdout);
-            for (i = 0; i < (int) pDecInsn->vA; i++) {
-                if (i == 0)
-                    printf("v%d", pDecInsn->arg[i]);
-                else
-                    printf(", v%d", pDecInsn->arg[i]);
-            }
-            if (pDecInsn->opCode == OP_FILLED_NEW_ARRAY) {
-                printf("}, %s // class@%04x",
-                    getClassDescriptor(pDexFile, pDecInsn->vB), pDecInsn->vB);
-            } else {
-                FieldMethodInfo methInfo;
-                if (getMethodInfo(pDexFile, pDecInsn->vB, &methInfo)) {
-                    printf("}, %s.%s:%s // method@%04x",
-                        methInfo.classDescriptor, methInfo.name,
-                        methInfo.signature, pDecInsn->vB);
-                } else {
-                    printf("}, ??? // method@%04x", pDecInsn->vB);
-                }
-            }
+            outPuts(" {");
+            outRegList(decInsn.arg, decInsn.vA);
+            outPuts("}, ");
+            outIndex(pDexFile, pInfo, decInsn.vB);
         }
         break;
     case kFmt35ms:       // [opt] invoke-virtual+super
+        dexDecode35c(pInsn, &decInsn);
     case kFmt35fs:       // [opt] invoke-interface
         {
-            fputs(" {", stdout);
-            for (i = 0; i < (int) pDecInsn->vA; i++) {
-                if (i == 0)
-                    printf("v%d", pDecInsn->arg[i]);
-                else
-                    printf(", v%d", pDecInsn->arg[i]);
-            }
-            printf("}, [%04x] // vtable #%04x", pDecInsn->vB, pDecInsn->vB);
+            outPuts(" {");
+            outRegList(decInsn.arg, decInsn.vA);
+            outPrintf("}, [%04x] // vtable #%04x", decInsn.vB, decInsn.vB);
         }
         break;
     case kFmt3rc:        // op {vCCCC .. v(CCCC+AA-1)}, meth@BBBB
+        dexDecode3rc(pInsn, &decInsn);
         {
             /*
              * This doesn't match the "dx" output when some of the args are
              * 64-bit values -- dx only shows the first register.
              */
-            fputs(" {", stdout);
-            for (i = 0; i < (int) pDecInsn->vA; i++) {
-                if (i == 0)
-                    printf("v%d", pDecInsn->vC + i);
-                else
-                    printf(", v%d", pDecInsn->vC + i);
-            }
-            if (pDecInsn->opCode == OP_FILLED_NEW_ARRAY_RANGE) {
-                printf("}, %s // class@%04x",
-                    getClassDescriptor(pDexFile, pDecInsn->vB), pDecInsn->vB);
-            } else {
-                FieldMethodInfo methInfo;
-                if (getMethodInfo(pDexFile, pDecInsn->vB, &methInfo)) {
-                    printf("}, %s.%s:%s // method@%04x",
-                        methInfo.classDescriptor, methInfo.name,
-                        methInfo.signature, pDecInsn->vB);
-                } else {
-                    printf("}, ??? // method@%04x", pDecInsn->vB);
-                }
-            }
+            outPuts(" {");
+            outRegRange(decInsn.vC, decInsn.vA);
+            outPuts("}, ");
+            outIndex(pDexFile, pInfo, decInsn.vB);
         }
         break;
     case kFmt3rms:       // [opt] invoke-virtual+super/range
+        dexDecode3rc(pInsn, &decInsn);
     case kFmt3rfs:       // [opt] invoke-interface/range
         {
             /*
              * This doesn't match the "dx" output when some of the args are
              * 64-bit values -- dx only shows the first register.
              */
-            fputs(" {", stdout);
-            for (i = 0; i < (int) pDecInsn->vA; i++) {
-                if (i == 0)
-                    printf("v%d", pDecInsn->vC + i);
-                else
-                    printf(", v%d", pDecInsn->vC + i);
-            }
-            printf("}, [%04x] // vtable #%04x", pDecInsn->vB, pDecInsn->vB);
+            outPuts(" {");
+            outRegRange(decInsn.vC, decInsn.vA);
+            outPrintf("}, [%04x] // vtable #%04x", decInsn.vB, decInsn.vB);
         }
         break;
     case kFmt3rinline:   // [opt] execute-inline/range
+        dexDecode3rc(pInsn, &decInsn);
         {
-            fputs(" {", stdout);
-            for (i = 0; i < (int) pDecInsn->vA; i++) {
-                if (i == 0)
-                    printf("v%d", pDecInsn->vC + i);
-                else
-                    printf(", v%d", pDecInsn->vC + i);
-            }
-            printf("}, [%04x] // inline #%04x", pDecInsn->vB, pDecInsn->vB);
+            outPuts(" {");
+            outRegRange(decInsn.vC, decInsn.vA);
+            outPrintf("}, [%04x] // inline #%04x", decInsn.vB, decInsn.vB);
         }
         break;
     case kFmt3inline:    // [opt] inline invoke
+        dexDecode3inline(pInsn, &decInsn);
         {
 #if 0
             const InlineOperation* inlineOpsTable = dvmGetInlineOpsTable();
             u4 tableLen = dvmGetInlineOpsTableLength();
 #endif
 
-            fputs(" {", stdout);
-            for (i = 0; i < (int) pDecInsn->vA; i++) {
-                if (i == 0)
-                    printf("v%d", pDecInsn->arg[i]);
-                else
-                    printf(", v%d", pDecInsn->arg[i]);
-            }
+            outPuts(" {");
+            outRegList(decInsn.arg, decInsn.vA);
 #if 0
-            if (pDecInsn->vB < tableLen) {
-                printf("}, %s.%s:%s // inline #%04x",
-                    inlineOpsTable[pDecInsn->vB].classDescriptor,
-                    inlineOpsTable[pDecInsn->vB].methodName,
-                    inlineOpsTable[pDecInsn->vB].methodSignature,
-                    pDecInsn->vB);
+            if (decInsn.vB < tableLen) {
+                outPrintf("}, %s.%s:%s // inline #%04x",
+                    inlineOpsTable[decInsn.vB].classDescriptor,
+                    inlineOpsTable[decInsn.vB].methodName,
+                    inlineOpsTable[decInsn.vB].methodSignature,
+                    decInsn.vB);
             } else {
 #endif
-                printf("}, [%04x] // inline #%04x", pDecInsn->vB, pDecInsn->vB);
+                outPrintf("}, [%04x] // inline #%04x",
+                    decInsn.vB, decInsn.vB);
 #if 0
             }
 #endif
         }
         break;
     case kFmt51l:        // op vAA, #+BBBBBBBBBBBBBBBB
+        dexDecode51l(pInsn, &decInsn);
         {
             /* this is often, but not always, a double */
             union {
                 double d;
                 u8 j;
             } conv;
-            conv.j = pDecInsn->vB_wide;
-            printf(" v%d, #double %f // #%016llx",
-                pDecInsn->vA, conv.d, pDecInsn->vB_wide);
+            conv.j = decInsn.vB_wide;
+            outPrintf(" v%d, #double %f // #%016llx",
+                decInsn.vA, conv.d, decInsn.vB_wide);
         }
         break;
     case kFmtUnknown:
         break;
     default:
-        printf(" ???");
+        outPrintf(" ???");
         break;
     }
 
 
-    putchar('\n');
+    outPutc('\n');
 
 }
 
@@ -926,27 +1198,32 @@ void dumpBytecodes(DexFile* pDexFile, const DexMethod* pDexMethod)
     int insnIdx;
     FieldMethodInfo methInfo;
     int startAddr;
-    char* className = NULL;
+    const char* className;
 
     assert(pCode->insnsSize > 0);
     insns = pCode->insns;
 
-    getMethodInfo(pDexFile, pDexMethod->methodIdx, &methInfo);
+    if (getMethodInfo(pDexFile, pDexMethod->methodIdx, &methInfo)) {
+        className = typeToDot(pDexFile,
+            dexGetMethodId(pDexFile, pDexMethod->methodIdx)->classIdx);
+    } else {
+        methInfo.classDescriptor = methInfo.name = methInfo.signature = "??";
+        className = "??";
+    }
     startAddr = ((u1*)pCode - pDexFile->baseAddr);
-    className = descriptorToDot(methInfo.classDescriptor);
 
-    printf("%06x:                                        |[%06x] %s.%s:%s\n",
+    outPrintf("%06x:                                        |[%06x] %s.%s:%s\n",
         startAddr, startAddr,
         className, methInfo.name, methInfo.signature);
 
     insnIdx = 0;
     while (insnIdx < (int) pCode->insnsSize) {
         int insnWidth;
-        OpCode opCode;
-        DecodedInstruction decInsn;
+        const InstructionInfo* pInfo;
         u2 instr;
 
         instr = get2LE((const u1*)insns);
+        pInfo = dexGetInstrInfo(instr & 0xff);
         if (instr == kPackedSwitchSignature) {
             insnWidth = 4 + get2LE((const u1*)(insns+1)) * 2;
         } else if (instr == kSparseSwitchSignature) {
@@ -958,8 +1235,7 @@ void dumpBytecodes(DexFile* pDexFile, const DexMethod* pDexMethod)
             // The plus 1 is to round up for odd size and width 
             insnWidth = 4 + ((size * width) + 1) / 2;
         } else {
-            opCode = instr & 0xff;
-            insnWidth = dexGetInstrWidthAbs(gInstrWidth, opCode);
+            insnWidth = (pInfo->width < 0) ? -pInfo->width : pInfo->width;
             if (insnWidth == 0) {
                 fprintf(stderr,
                     "GLITCH: zero-width instruction at idx=0x%04x\n", insnIdx);
@@ -967,14 +1243,12 @@ void dumpBytecodes(DexFile* pDexFile, const DexMethod* pDexMethod)
             }
         }
 
-        dexDecodeInstruction(gInstrFormat, insns, &decInsn);
-        dumpInstruction(pDexFile, pCode, insnIdx, insnWidth, &decInsn);
+        dumpInstruction(pDexFile, pCode, insnIdx, insnWidth, pInfo);
 
         insns += insnWidth;
         insnIdx += insnWidth;
     }
 
-    free(className);
 }
 
 /*
@@ -984,18 +1258,16 @@ void dumpCode(DexFile* pDexFile, const DexMethod* pDexMethod)
 {
     const DexCode* pCode = dexGetCode(pDexFile, pDexMethod);
 
-    printf("      registers     : %d\n", pCode->registersSize);
-    printf("      ins           : %d\n", pCode->insSize);
-    printf("      outs          : %d\n", pCode->outsSize);
-    printf("      insns size    : %d 16-bit code units\n", pCode->insnsSize);
+    outPrintf("      registers     : %d\n", pCode->registersSize);
+    outPrintf("      ins           : %d\n", pCode->insSize);
+    outPrintf("      outs          : %d\n", pCode->outsSize);
+    outPrintf("      insns size    : %d 16-bit code units\n", pCode->insnsSize);
 
     if (gOptions.disassemble)
         dumpBytecodes(pDexFile, pDexMethod);
 
     dumpCatches(pDexFile, pCode);
-    /* both of these are encoded in debug info */
-    dumpPositions(pDexFile, pCode, pDexMethod);
-    dumpLocals(pDexFile, pCode, pDexMethod);
+    dumpDebugInfo(pDexFile, pCode, pDexMethod);
 }
 
 /*
@@ -1003,11 +1275,11 @@ void dumpCode(DexFile* pDexFile, const DexMethod* pDexMethod)
  */
 void dumpMethod(DexFile* pDexFile, const DexMethod* pDexMethod, int i)
 {
-    const DexMethodId* pMethodId;
+    const DexMemberInfo* pMethInfo;
     const char* backDescriptor;
     const char* name;
-    char* typeDescriptor = NULL;
-    char* accessStr = NULL;
+    const char* typeDescriptor;
+    const char* accessStr;
 
     if (gOptions.exportsOnly &&
         (pDexMethod->accessFlags & (ACC_PUBLIC | ACC_PROTECTED)) == 0)
@@ -1015,130 +1287,91 @@ void dumpMethod(DexFile* pDexFile, const DexMethod* pDexMethod, int i)
         return;
     }
 
-    pMethodId = dexGetMethodId(pDexFile, pDexMethod->methodIdx);
-    name = dexStringById(pDexFile, pMethodId->nameIdx);
-    typeDescriptor = dexCopyDescriptorFromMethodId(pDexFile, pMethodId);
-
-    backDescriptor = dexStringByTypeIdx(pDexFile, pMethodId->classIdx);
+    pMethInfo = dexGetMethodInfo(pDexFile, pDexMethod->methodIdx);
+    if (pMethInfo == NULL) {
+        fprintf(stderr, "ERROR: bad method index %u\n", pDexMethod->methodIdx);
+        return;
+    }
+    name = pMethInfo->name;
+    typeDescriptor = pMethInfo->signature;
+    backDescriptor = pMethInfo->classDescriptor;
 
     accessStr = createAccessFlagStr(pDexMethod->accessFlags,
                     kAccessForMethod);
 
     if (gOptions.outputFormat == OUTPUT_PLAIN) {
-        printf("    #%d              : (in %s)\n", i, backDescriptor);
-        printf("      name          : '%s'\n", name);
-        printf("      type          : '%s'\n", typeDescriptor);
-        printf("      access        : 0x%04x (%s)\n",
+        outPrintf("    #%d              : (in %s)\n", i, backDescriptor);
+        outPrintf("      name          : '%s'\n", name);
+        outPrintf("      type          : '%s'\n", typeDescriptor);
+        outPrintf("      access        : 0x%04x (%s)\n",
             pDexMethod->accessFlags, accessStr);
 
         if (pDexMethod->codeOff == 0) {
-            printf("      code          : (none)\n");
+            outPrintf("      code          : (none)\n");
         } else {
-            printf("      code          -\n");
+            outPrintf("      code          -\n");
             dumpCode(pDexFile, pDexMethod);
         }
 
         if (gOptions.disassemble)
-            putchar('\n');
+            outPutc('\n');
     } else if (gOptions.outputFormat == OUTPUT_XML) {
+        const DexMethodId* pMethodId =
+            dexGetMethodId(pDexFile, pDexMethod->methodIdx);
+        const DexProtoId* pProtoId = dexGetProtoId(pDexFile, pMethodId->protoIdx);
+        const DexTypeList* pParams = dexGetProtoParameters(pDexFile, pProtoId);
         bool constructor = (name[0] == '<');
 
         if (constructor) {
-            char* tmp;
-
-            tmp = descriptorClassToDot(backDescriptor);
-            printf("<constructor name=\"%s\"\n", tmp);
-            free(tmp);
-
-            tmp = descriptorToDot(backDescriptor);
-            printf(" type=\"%s\"\n", tmp);
-            free(tmp);
+            outPrintf("<constructor name=\"%s\"\n",
+                typeClassToDot(pDexFile, pMethodId->classIdx));
+            outPrintf(" type=\"%s\"\n",
+                typeToDot(pDexFile, pMethodId->classIdx));
         } else {
-            printf("<method name=\"%s\"\n", name);
-
-            const char* returnType = strrchr(typeDescriptor, ')');
-            if (returnType == NULL) {
-                fprintf(stderr, "bad method type descriptor '%s'\n",
-                    typeDescriptor);
-                goto bail;
-            }
-
-            char* tmp = descriptorToDot(returnType+1);
-            printf(" return=\"%s\"\n", tmp);
-            free(tmp);
+            outPrintf("<method name=\"%s\"\n", name);
+            outPrintf(" return=\"%s\"\n",
+                typeToDot(pDexFile, pProtoId->returnTypeIdx));
 
-            printf(" abstract=%s\n",
+            outPrintf(" abstract=%s\n",
                 quotedBool((pDexMethod->accessFlags & ACC_ABSTRACT) != 0));
-            printf(" native=%s\n",
+            outPrintf(" native=%s\n",
                 quotedBool((pDexMethod->accessFlags & ACC_NATIVE) != 0));
 
             bool isSync =
                 (pDexMethod->accessFlags & ACC_SYNCHRONIZED) != 0 ||
                 (pDexMethod->accessFlags & ACC_DECLARED_SYNCHRONIZED) != 0;
-            printf(" synchronized=%s\n", quotedBool(isSync));
+            outPrintf(" synchronized=%s\n", quotedBool(isSync));
         }
 
-        printf(" static=%s\n",
+        outPrintf(" static=%s\n",
             quotedBool((pDexMethod->accessFlags & ACC_STATIC) != 0));
-        printf(" final=%s\n",
+        outPrintf(" final=%s\n",
             quotedBool((pDexMethod->accessFlags & ACC_FINAL) != 0));
         // "deprecated=" not knowable w/o parsing annotations
-        printf(" visibility=%s\n",
+        outPrintf(" visibility=%s\n",
             quotedVisibility(pDexMethod->accessFlags));
 
-        printf(">\n");
+        outPrintf(">\n");
 
         /*
          * Parameters.
          */
-        if (typeDescriptor[0] != '(') {
-            fprintf(stderr, "ERROR: bad descriptor '%s'\n", typeDescriptor);
-            goto bail;
-        }
-
-        char tmpBuf[strlen(typeDescriptor)+1];      /* more than big enough */
-        int argNum = 0;
-
-        const char* base = typeDescriptor+1;
-
-        while (*base != ')') {
-            char* cp = tmpBuf;
-
-            while (*base == '[')
-                *cp++ = *base++;
-
-            if (*base == 'L') {
-                /* copy through ';' */
-                do {
-                    *cp = *base++;
-                } while (*cp++ != ';');
-            } else {
-                /* primitive char, copy it */
-                if (strchr("ZBCSIFJD", *base) == NULL) {
-                    fprintf(stderr, "ERROR: bad method signature '%s'\n", base);
-                    goto bail;
-                }
-                *cp++ = *base++;
+        if (pParams != NULL) {
+            u4 argNum;
+
+            for (argNum = 0; argNum < pParams->size; argNum++) {
+                outPrintf(
+                    "<parameter name=\"arg%d\" type=\"%s\">\n</parameter>\n",
+                    argNum, typeToDot(pDexFile,
+                        dexGetTypeItem(pParams, argNum)->typeIdx));
             }
-
-            /* null terminate and display */
-            *cp++ = '\0';
-
-            char* tmp = descriptorToDot(tmpBuf);
-            printf("<parameter name=\"arg%d\" type=\"%s\">\n</parameter>\n",
-                argNum++, tmp);
-            free(tmp);
         }
 
         if (constructor)
-            printf("</constructor>\n");
+            outPrintf("</constructor>\n");
         else
-            printf("</method>\n");
+            outPrintf("</method>\n");
     }
-
-bail:
-    free(typeDescriptor);
-    free(accessStr);
 }
 
 /*
@@ -1150,7 +1383,7 @@ void dumpSField(const DexFile* pDexFile, const DexField* pSField, int i)
     const char* backDescriptor;
     const char* name;
     const char* typeDescriptor;
-    char* accessStr;
+    const char* accessStr;
 
     if (gOptions.exportsOnly &&
         (pSField->accessFlags & (ACC_PUBLIC | ACC_PROTECTED)) == 0)
@@ -1166,36 +1399,29 @@ void dumpSField(const DexFile* pDexFile, const DexField* pSField, int i)
     accessStr = createAccessFlagStr(pSField->accessFlags, kAccessForField);
 
     if (gOptions.outputFormat == OUTPUT_PLAIN) {
-        printf("    #%d              : (in %s)\n", i, backDescriptor);
-        printf("      name          : '%s'\n", name);
-        printf("      type          : '%s'\n", typeDescriptor);
-        printf("      access        : 0x%04x (%s)\n",
+        outPrintf("    #%d              : (in %s)\n", i, backDescriptor);
+        outPrintf("      name          : '%s'\n", name);
+        outPrintf("      type          : '%s'\n", typeDescriptor);
+        outPrintf("      access        : 0x%04x (%s)\n",
             pSField->accessFlags, accessStr);
     } else if (gOptions.outputFormat == OUTPUT_XML) {
-        char* tmp;
-
-        printf("<field name=\"%s\"\n", name);
+        outPrintf("<field name=\"%s\"\n", name);
+        outPrintf(" type=\"%s\"\n", typeToDot(pDexFile, pFieldId->typeIdx));
 
-        tmp = descriptorToDot(typeDescriptor);
-        printf(" type=\"%s\"\n", tmp);
-        free(tmp);
-
-        printf(" transient=%s\n",
+        outPrintf(" transient=%s\n",
             quotedBool((pSField->accessFlags & ACC_TRANSIENT) != 0));
-        printf(" volatile=%s\n",
+        outPrintf(" volatile=%s\n",
             quotedBool((pSField->accessFlags & ACC_VOLATILE) != 0));
         // "value=" not knowable w/o parsing annotations
-        printf(" static=%s\n",
+        outPrintf(" static=%s\n",
             quotedBool((pSField->accessFlags & ACC_STATIC) != 0));
-        printf(" final=%s\n",
+        outPrintf(" final=%s\n",
             quotedBool((pSField->accessFlags & ACC_FINAL) != 0));
         // "deprecated=" not knowable w/o parsing annotations
-        printf(" visibility=%s\n",
+        outPrintf(" visibility=%s\n",
             quotedVisibility(pSField->accessFlags));
-        printf(">\n</field>\n");
+        outPrintf(">\n</field>\n");
     }
-
-    free(accessStr);
 }
 
 /*
@@ -1211,19 +1437,25 @@ void dumpIField(const DexFile* pDexFile, const DexField* pIField, int i)
  *
  * Note "idx" is a DexClassDef index, not a DexTypeId index.
  *
- * If "*pLastPackage" is NULL or does not match the current class' package,
- * the value will be replaced with a newly-allocated string.
+ * "dexIdx" identifies which of an archive's DEX files the class came from
+ * (1 for "classes.dex", 2 for "classes2.dex", ...).  Pass 0 when there's
+ * only one, and the class won't be tagged.
+ *
+ * For the XML output, "*pPackage" is set to the class' package name (in
+ * the scratch arena), which the caller uses to emit the <package> tags
+ * ahead of the class.  It's left alone if the class isn't shown.
  */
-void dumpClass(DexFile* pDexFile, int idx, char** pLastPackage)
+void dumpClass(DexFile* pDexFile, int idx, int dexIdx, const char** pPackage)
 {
     const DexTypeList* pInterfaces;
     const DexClassDef* pClassDef;
-    DexClassData* pClassData = NULL;
-    const u1* pEncodedData;
+    DexClassDataIterator classData;
+    DexField field;
+    DexMethod method;
     const char* fileName;
     const char* classDescriptor;
     const char* superclassDescriptor;
-    char* accessStr = NULL;
+    const char* accessStr;
     int i;
 
     pClassDef = dexGetClassDef(pDexFile, idx);
@@ -1231,15 +1463,12 @@ void dumpClass(DexFile* pDexFile, int idx, char** pLastPackage)
     if (gOptions.exportsOnly && (pClassDef->accessFlags & ACC_PUBLIC) == 0) {
         //printf("<!-- omitting non-public class %s -->\n",
         //    classDescriptor);
-        goto bail;
+        return;
     }
 
-    pEncodedData = dexGetClassData(pDexFile, pClassDef);
-    pClassData = dexReadAndVerifyClassData(&pEncodedData, NULL);
-
-    if (pClassData == NULL) {
-        printf("Trouble reading class data (#%d)\n", idx);
-        goto bail;
+    if (!startClassData(pDexFile, pClassDef, &classData)) {
+        outPrintf("Trouble reading class data (#%d)\n", idx);
+        return;
     }
     
     classDescriptor = dexStringByTypeIdx(pDexFile, pClassDef->classIdx);
@@ -1261,7 +1490,7 @@ void dumpClass(DexFile* pDexFile, int idx, char** pLastPackage)
         char* lastSlash;
         char* cp;
 
-        mangle = strdup(classDescriptor + 1);
+        mangle = dexArenaStrdup(&gScratch->arena, classDescriptor + 1);
         mangle[strlen(mangle)-1] = '\0';
 
         /* reduce to just the package name */
@@ -1277,16 +1506,7 @@ void dumpClass(DexFile* pDexFile, int idx, char** pLastPackage)
                 *cp = '.';
         }
 
-        if (*pLastPackage == NULL || strcmp(mangle, *pLastPackage) != 0) {
-            /* start of a new package */
-            if (*pLastPackage != NULL)
-                printf("</package>\n");
-            printf("<package name=\"%s\"\n>\n", mangle);
-            free(*pLastPackage);
-            *pLastPackage = mangle;
-        } else {
-            free(mangle);
-        }
+        *pPackage = mangle;
     }
 
     accessStr = createAccessFlagStr(pClassDef->accessFlags, kAccessForClass);
@@ -1299,37 +1519,41 @@ void dumpClass(DexFile* pDexFile, int idx, char** pLastPackage)
     }
 
     if (gOptions.outputFormat == OUTPUT_PLAIN) {
-        printf("Class #%d            -\n", idx);
-        printf("  Class descriptor  : '%s'\n", classDescriptor);
-        printf("  Access flags      : 0x%04x (%s)\n",
+        outPrintf("Class #%d            -\n", idx);
+        if (dexIdx != 0) {
+            char dexName[kMultiDexNameBufLen];
+
+            dexGetMultiDexEntryName(dexIdx, dexName, sizeof(dexName));
+            outPrintf("  Dex file          : %d (%s)\n", dexIdx, dexName);
+        }
+        outPrintf("  Class descriptor  : '%s'\n", classDescriptor);
+        outPrintf("  Access flags      : 0x%04x (%s)\n",
             pClassDef->accessFlags, accessStr);
 
         if (superclassDescriptor != NULL)
-            printf("  Superclass        : '%s'\n", superclassDescriptor);
+            outPrintf("  Superclass        : '%s'\n", superclassDescriptor);
 
-        printf("  Interfaces        -\n");
+        outPrintf("  Interfaces        -\n");
     } else {
-        char* tmp;
-
-        tmp = descriptorClassToDot(classDescriptor);
-        printf("<class name=\"%s\"\n", tmp);
-        free(tmp);
+        outPrintf("<class name=\"%s\"\n",
+            typeClassToDot(pDexFile, pClassDef->classIdx));
 
         if (superclassDescriptor != NULL) {
-            tmp = descriptorToDot(superclassDescriptor);
-            printf(" extends=\"%s\"\n", tmp);
-            free(tmp);
+            outPrintf(" extends=\"%s\"\n",
+                typeToDot(pDexFile, pClassDef->superclassIdx));
         }
-        printf(" abstract=%s\n",
+        if (dexIdx != 0)
+            outPrintf(" dex=\"%d\"\n", dexIdx);
+        outPrintf(" abstract=%s\n",
             quotedBool((pClassDef->accessFlags & ACC_ABSTRACT) != 0));
-        printf(" static=%s\n",
+        outPrintf(" static=%s\n",
             quotedBool((pClassDef->accessFlags & ACC_STATIC) != 0));
-        printf(" final=%s\n",
+        outPrintf(" final=%s\n",
             quotedBool((pClassDef->accessFlags & ACC_FINAL) != 0));
         // "deprecated=" not knowable w/o parsing annotations
-        printf(" visibility=%s\n",
+        outPrintf(" visibility=%s\n",
             quotedVisibility(pClassDef->accessFlags));
-        printf(">\n");
+        outPrintf(">\n");
     }
     pInterfaces = dexGetInterfacesList(pDexFile, pClassDef);
     if (pInterfaces != NULL) {
@@ -1338,27 +1562,31 @@ void dumpClass(DexFile* pDexFile, int idx, char** pLastPackage)
     }
 
     if (gOptions.outputFormat == OUTPUT_PLAIN)
-        printf("  Static fields     -\n");
-    for (i = 0; i < (int) pClassData->header.staticFieldsSize; i++) {
-        dumpSField(pDexFile, &pClassData->staticFields[i], i);
+        outPrintf("  Static fields     -\n");
+    for (i = 0; i < (int) classData.header.staticFieldsSize; i++) {
+        dexClassDataIteratorNextField(&classData, &field);
+        dumpSField(pDexFile, &field, i);
     }
 
     if (gOptions.outputFormat == OUTPUT_PLAIN)
-        printf("  Instance fields   -\n");
-    for (i = 0; i < (int) pClassData->header.instanceFieldsSize; i++) {
-        dumpIField(pDexFile, &pClassData->instanceFields[i], i);
+        outPrintf("  Instance fields   -\n");
+    for (i = 0; i < (int) classData.header.instanceFieldsSize; i++) {
+        dexClassDataIteratorNextField(&classData, &field);
+        dumpIField(pDexFile, &field, i);
     }
 
     if (gOptions.outputFormat == OUTPUT_PLAIN)
-        printf("  Direct methods    -\n");
-    for (i = 0; i < (int) pClassData->header.directMethodsSize; i++) {
-        dumpMethod(pDexFile, &pClassData->directMethods[i], i);
+        outPrintf("  Direct methods    -\n");
+    for (i = 0; i < (int) classData.header.directMethodsSize; i++) {
+        dexClassDataIteratorNextMethod(&classData, &method);
+        dumpMethod(pDexFile, &method, i);
     }
 
     if (gOptions.outputFormat == OUTPUT_PLAIN)
-        printf("  Virtual methods   -\n");
-    for (i = 0; i < (int) pClassData->header.virtualMethodsSize; i++) {
-        dumpMethod(pDexFile, &pClassData->virtualMethods[i], i);
+        outPrintf("  Virtual methods   -\n");
+    for (i = 0; i < (int) classData.header.virtualMethodsSize; i++) {
+        dexClassDataIteratorNextMethod(&classData, &method);
+        dumpMethod(pDexFile, &method, i);
     }
 
     // TODO: Annotations.
@@ -1369,18 +1597,14 @@ void dumpClass(DexFile* pDexFile, int idx, char** pLastPackage)
         fileName = "unknown";
 
     if (gOptions.outputFormat == OUTPUT_PLAIN) {
-        printf("  source_file_idx   : %d (%s)\n",
+        outPrintf("  source_file_idx   : %d (%s)\n",
             pClassDef->sourceFileIdx, fileName);
-        printf("\n");
+        outPrintf("\n");
     }
 
     if (gOptions.outputFormat == OUTPUT_XML) {
-        printf("</class>\n");
+        outPrintf("</class>\n");
     }
-
-bail:
-    free(pClassData);
-    free(accessStr);
 }
 
 
@@ -1421,7 +1645,7 @@ void dumpDifferentialCompressedMap(const u1** pData)
     int origLen = 4 + (addrWidth + regWidth) * numEntries;
     int compLen = (data - dataStart) + compressedLen;
 
-    printf("        (differential compression %d -> %d [%d -> %d])\n",
+    outPrintf("        (differential compression %d -> %d [%d -> %d])\n",
         origLen, compLen,
         (addrWidth + regWidth) * numEntries, compressedLen);
 
@@ -1447,7 +1671,7 @@ void dumpMethodMap(DexFile* pDexFile, const DexMethod* pDexMethod, int idx,
 
     pMethodId = dexGetMethodId(pDexFile, pDexMethod->methodIdx);
     name = dexStringById(pDexFile, pMethodId->nameIdx);
-    printf("      #%d: 0x%08x %s\n", idx, offset, name);
+    outPrintf("      #%d: 0x%08x %s\n", idx, offset, name);
 
     u1 format;
     int addrWidth;
@@ -1455,7 +1679,7 @@ void dumpMethodMap(DexFile* pDexFile, const DexMethod* pDexMethod, int idx,
     format = *data++;
     if (format == 1) {              /* kRegMapFormatNone */
         /* no map */
-        printf("        (no map)\n");
+        outPrintf("        (no map)\n");
         addrWidth = 0;
     } else if (format == 2) {       /* kRegMapFormatCompact8 */
         addrWidth = 1;
@@ -1465,7 +1689,7 @@ void dumpMethodMap(DexFile* pDexFile, const DexMethod* pDexMethod, int idx,
         dumpDifferentialCompressedMap(&data);
         goto bail;
     } else {
-        printf("        (unknown format %d!)\n", format);
+        outPrintf("        (unknown format %d!)\n", format);
         /* don't know how to skip data; failure will cascade to end of class */
         goto bail;
     }
@@ -1484,11 +1708,11 @@ void dumpMethodMap(DexFile* pDexFile, const DexMethod* pDexMethod, int idx,
             if (addrWidth > 1)
                 addr |= (*data++) << 8;
 
-            printf("        %4x:", addr);
+            outPrintf("        %4x:", addr);
             for (byte = 0; byte < regWidth; byte++) {
-                printf(" %02x", *data++);
+                outPrintf(" %02x", *data++);
             }
-            printf("\n");
+            outPrintf("\n");
         }
     }
 
@@ -1516,7 +1740,7 @@ void dumpRegisterMaps(DexFile* pDexFile)
     int idx;
 
     if (pClassPool == NULL) {
-        printf("No register maps found\n");
+        outPrintf("No register maps found\n");
         return;
     }
 
@@ -1525,8 +1749,8 @@ void dumpRegisterMaps(DexFile* pDexFile)
     ptr += sizeof(u4);
     classOffsets = (const u4*) ptr;
 
-    printf("RMAP begins at offset 0x%07x\n", baseFileOffset);
-    printf("Maps for %d classes\n", numClasses);
+    outPrintf("RMAP begins at offset 0x%07x\n", baseFileOffset);
+    outPrintf("Maps for %d classes\n", numClasses);
     for (idx = 0; idx < (int) numClasses; idx++) {
         const DexClassDef* pClassDef;
         const char* classDescriptor;
@@ -1534,7 +1758,7 @@ void dumpRegisterMaps(DexFile* pDexFile)
         pClassDef = dexGetClassDef(pDexFile, idx);
         classDescriptor = dexStringByTypeIdx(pDexFile, pClassDef->classIdx);
 
-        printf("%4d: +%d (0x%08x) %s\n", idx, classOffsets[idx],
+        outPrintf("%4d: +%d (0x%08x) %s\n", idx, classOffsets[idx],
             baseFileOffset + classOffsets[idx], classDescriptor);
 
         if (classOffsets[idx] == 0)
@@ -1544,15 +1768,13 @@ void dumpRegisterMaps(DexFile* pDexFile)
          * What follows is a series of RegisterMap entries, one for every
          * direct method, then one for every virtual method.
          */
-        DexClassData* pClassData;
-        const u1* pEncodedData;
+        DexClassDataIterator classData;
+        DexMethod method;
         const u1* data = (u1*) pClassPool + classOffsets[idx];
         u2 methodCount;
         int i;
 
-        pEncodedData = dexGetClassData(pDexFile, pClassDef);
-        pClassData = dexReadAndVerifyClassData(&pEncodedData, NULL);
-        if (pClassData == NULL) {
+        if (!startClassData(pDexFile, pClassDef, &classData)) {
             fprintf(stderr, "Trouble reading class data\n");
             continue;
         }
@@ -1560,116 +1782,968 @@ void dumpRegisterMaps(DexFile* pDexFile)
         methodCount = *data++;
         methodCount |= (*data++) << 8;
         data += 2;      /* two pad bytes follow methodCount */
-        if (methodCount != pClassData->header.directMethodsSize
-                            + pClassData->header.virtualMethodsSize)
+        if (methodCount != classData.header.directMethodsSize
+                            + classData.header.virtualMethodsSize)
         {
-            printf("NOTE: method count discrepancy (%d != %d + %d)\n",
-                methodCount, pClassData->header.directMethodsSize,
-                pClassData->header.virtualMethodsSize);
+            outPrintf("NOTE: method count discrepancy (%d != %d + %d)\n",
+                methodCount, classData.header.directMethodsSize,
+                classData.header.virtualMethodsSize);
             /* this is bad, but keep going anyway */
         }
 
-        printf("    direct methods: %d\n",
-            pClassData->header.directMethodsSize);
-        for (i = 0; i < (int) pClassData->header.directMethodsSize; i++) {
-            dumpMethodMap(pDexFile, &pClassData->directMethods[i], i, &data);
+        outPrintf("    direct methods: %d\n",
+            classData.header.directMethodsSize);
+        for (i = 0; i < (int) classData.header.directMethodsSize; i++) {
+            dexClassDataIteratorNextMethod(&classData, &method);
+            dumpMethodMap(pDexFile, &method, i, &data);
         }
 
-        printf("    virtual methods: %d\n",
-            pClassData->header.virtualMethodsSize);
-        for (i = 0; i < (int) pClassData->header.virtualMethodsSize; i++) {
-            dumpMethodMap(pDexFile, &pClassData->virtualMethods[i], i, &data);
+        outPrintf("    virtual methods: %d\n",
+            classData.header.virtualMethodsSize);
+        for (i = 0; i < (int) classData.header.virtualMethodsSize; i++) {
+            dexClassDataIteratorNextMethod(&classData, &method);
+            dumpMethodMap(pDexFile, &method, i, &data);
         }
+    }
+}
 
-        free(pClassData);
+/*
+ * Emit the <package> tags needed to move from "*pLastPackage" to "package"
+ * in the XML output.  "*pLastPackage" is a private copy, updated here.
+ */
+static void changePackage(char** pLastPackage, const char* package)
+{
+    if (*pLastPackage == NULL || strcmp(package, *pLastPackage) != 0) {
+        /* start of a new package */
+        if (*pLastPackage != NULL)
+            outPrintf("</package>\n");
+        outPrintf("<package name=\"%s\"\n>\n", package);
+        free(*pLastPackage);
+        *pLastPackage = strdup(package);
     }
 }
 
 /*
- * Dump the requested sections of the file.
+ * Output from one class, dumped on a worker thread.
+ */
+typedef struct ClassOutput {
+    OutputSink  out;
+    const char* package;        /* XML package name, if shown */
+    DumpScratch scratch;
+} ClassOutput;
+
+/*
+ * A round of classes being dumped in parallel.
  */
-void processDexFile(const char* fileName, DexFile* pDexFile)
+typedef struct ClassDumpWork {
+    DexFile*        pDexFile;
+    int             dexIdx;
+    int             first;      /* class def index of slots[0] */
+    ClassOutput*    slots;
+} ClassDumpWork;
+
+static void dumpClassWorker(void* arg, int idx)
 {
-    char* package = NULL;
+    ClassDumpWork* pWork = (ClassDumpWork*) arg;
+    ClassOutput* pSlot = &pWork->slots[idx];
+
+    gOut = &pSlot->out;
+    gScratch = &pSlot->scratch;
+    pSlot->out.len = 0;
+    pSlot->package = NULL;
+    dexArenaReset(&pSlot->scratch.arena);
+    dumpClass(pWork->pDexFile, pWork->first + idx, pWork->dexIdx,
+        &pSlot->package);
+}
+
+/*
+ * Dump "numClasses" classes from a DEX file, starting at class def index
+ * "first".
+ *
+ * Classes are formatted in rounds, each class into its own buffer, using
+ * up to "numThreads" threads.  After each round the buffers are appended
+ * to the output in class def order, along with the section headers and
+ * package tags, which depend on what came before.
+ */
+static void dumpClasses(DexFile* pDexFile, int dexIdx, int first,
+    int numClasses, int numThreads, char** pLastPackage)
+{
+    int end = first + numClasses;
+    int roundSize = (numThreads > 1) ? numThreads * kClassesPerThread : 1;
+    OutputSink* pSaveOut = gOut;
+    ClassDumpWork work;
     int i;
 
-    if (gOptions.verbose) {
-        printf("Opened '%s', DEX version '%.3s'\n", fileName,
-            pDexFile->pHeader->magic +4);
-    }
+    if (roundSize > numClasses)
+        roundSize = numClasses;
 
-    if (gOptions.dumpRegisterMaps) {
-        dumpRegisterMaps(pDexFile);
-        return;
-    }
+    work.pDexFile = pDexFile;
+    work.dexIdx = dexIdx;
+    work.slots = (ClassOutput*) calloc(roundSize, sizeof(ClassOutput));
+    for (i = 0; i < roundSize; i++)
+        dexArenaInit(&work.slots[i].scratch.arena, kScratchChunkSize);
 
-    if (gOptions.showFileHeaders)
-        dumpFileHeader(pDexFile);
+    for (work.first = first; work.first < end; work.first += roundSize) {
+        int count = end - work.first;
+        if (count > roundSize)
+            count = roundSize;
 
-    if (gOptions.outputFormat == OUTPUT_XML)
-        printf("<api>\n");
+        sysRunParallel(count, numThreads, dumpClassWorker, &work);
+        gOut = pSaveOut;
 
-    for (i = 0; i < (int) pDexFile->pHeader->classDefsSize; i++) {
-        if (gOptions.showSectionHeaders)
-            dumpClassDef(pDexFile, i);
+        for (i = 0; i < count; i++) {
+            ClassOutput* pSlot = &work.slots[i];
 
-        dumpClass(pDexFile, i, &package);
+            if (gOptions.showSectionHeaders)
+                dumpClassDef(pDexFile, work.first + i);
+            if (pSlot->package != NULL)
+                changePackage(pLastPackage, pSlot->package);
+            outWrite(pSlot->out.buf, pSlot->out.len);
+        }
+
+        if (gStdoutSink.len >= kOutputFlushSize)
+            flushOutput();
+    }
+
+    for (i = 0; i < roundSize; i++) {
+        free(work.slots[i].out.buf);
+        free(work.slots[i].scratch.locals.buf);
+        dexArenaRelease(&work.slots[i].scratch.arena);
+    }
+    free(work.slots);
+}
+
+/*
+ * A method picked out by -M, and where it sits in its class.
+ */
+typedef struct NamedMethod {
+    DexMethod   method;
+    u4          position;       /* in the direct or virtual method list */
+} NamedMethod;
+
+static int compareNamedMethods(const void* a, const void* b)
+{
+    u4 idxA = ((const NamedMethod*) a)->method.methodIdx;
+    u4 idxB = ((const NamedMethod*) b)->method.methodIdx;
+
+    return (idxA < idxB) ? -1 : (idxA > idxB);
+}
+
+/*
+ * Dump the methods picked out by -M, if "pDexFile" defines their class.
+ * Only that class's class data is decoded (or taken from the sidecar
+ * index); the matches are dumped in method_idx order.
+ *
+ * Returns the number of methods dumped, or -1 on failure.
+ */
+static int dumpNamedMethods(DexFile* pDexFile)
+{
+    const DexClassDef* pClassDef;
+    DexClassDataIterator classData;
+    DexMethod method;
+    NamedMethod* matches;
+    DumpScratch scratch;
+    u4 numDirect, numMethods, i;
+    int count = 0;
+
+    pClassDef = dexFindClass(pDexFile, gOptions.methodClass);
+    if (pClassDef == NULL)
+        return 0;
+
+    /* a class with bad class data has no methods to find */
+    if (!startClassData(pDexFile, pClassDef, &classData))
+        return 0;
+
+    numDirect = classData.header.directMethodsSize;
+    numMethods = numDirect + classData.header.virtualMethodsSize;
+    matches = (NamedMethod*) malloc(sizeof(NamedMethod) * (numMethods + 1));
+    if (matches == NULL) {
+        fprintf(stderr, "ERROR: out of memory\n");
+        return -1;
+    }
+
+    for (i = 0; dexClassDataIteratorNextMethod(&classData, &method); i++) {
+        const DexMemberInfo* pMethInfo =
+            dexGetMethodInfo(pDexFile, method.methodIdx);
+
+        if (pMethInfo == NULL ||
+            strcmp(pMethInfo->name, gOptions.methodName) != 0 ||
+            (gOptions.methodSignature != NULL &&
+             strcmp(pMethInfo->signature, gOptions.methodSignature) != 0))
+        {
+            continue;
+        }
+
+        matches[count].method = method;
+        matches[count].position = (i < numDirect) ? i : i - numDirect;
+        count++;
+    }
+    qsort(matches, count, sizeof(NamedMethod), compareNamedMethods);
+
+    memset(&scratch, 0, sizeof(scratch));
+    dexArenaInit(&scratch.arena, kScratchChunkSize);
+    gScratch = &scratch;
+
+    for (i = 0; i < (u4) count; i++) {
+        dexArenaReset(&scratch.arena);
+        dumpMethod(pDexFile, &matches[i].method, matches[i].position);
+    }
+
+    gScratch = NULL;
+    free(scratch.locals.buf);
+    dexArenaRelease(&scratch.arena);
+    free(matches);
+    return count;
+}
+
+/*
+ * Dump the requested sections of the DEX files found in one input file.
+ * An archive may hold several ("classes.dex", "classes2.dex", ...); their
+ * classes are listed together, each tagged with the DEX file it came from.
+ *
+ * With -C, only the named class is dumped, from the first DEX file that
+ * defines it; -M does the same for methods.  Returns 0 on success.
+ */
+int processDexFiles(const char* fileName, DexFile** pDexFiles, int numDex)
+{
+    char* package = NULL;
+    int numThreads = (gOptions.numJobs > 1) ? gOptions.numJobs : 1;
+    bool found = false;
+    int j;
+
+    for (j = 0; j < numDex; j++) {
+        DexFile* pDexFile = pDexFiles[j];
+
+        if (gOptions.verbose) {
+            if (numDex > 1) {
+                char dexName[kMultiDexNameBufLen];
+
+                dexGetMultiDexEntryName(j+1, dexName, sizeof(dexName));
+                outPrintf("Opened '%s' (%s), DEX version '%.3s'\n", fileName,
+                    dexName, pDexFile->pHeader->magic +4);
+            } else {
+                outPrintf("Opened '%s', DEX version '%.3s'\n", fileName,
+                    pDexFile->pHeader->magic +4);
+            }
+        }
+
+        if (gOptions.dumpRegisterMaps)
+            dumpRegisterMaps(pDexFile);
+        else if (gOptions.showFileHeaders)
+            dumpFileHeader(pDexFile);
+    }
+
+    if (gOptions.dumpRegisterMaps)
+        return 0;
+
+    if (gOptions.outputFormat == OUTPUT_XML)
+        outPrintf("<api>\n");
+
+    for (j = 0; j < numDex; j++) {
+        DexFile* pDexFile = pDexFiles[j];
+        int dexIdx = (numDex > 1) ? j+1 : 0;
+
+        if (gOptions.methodClass != NULL) {
+            int count = dumpNamedMethods(pDexFile);
+
+            if (count < 0)
+                return -1;
+            if (count > 0) {
+                found = true;
+                break;
+            }
+        } else if (gOptions.className != NULL) {
+            /* just the one class, from the first DEX file that has it */
+            const DexClassDef* pClassDef =
+                dexFindClass(pDexFile, gOptions.className);
+
+            if (pClassDef != NULL) {
+                dumpClasses(pDexFile, dexIdx,
+                    pClassDef - pDexFile->pClassDefs, 1, 1, &package);
+                found = true;
+                break;
+            }
+        } else {
+            dumpClasses(pDexFile, dexIdx, 0,
+                (int) pDexFile->pHeader->classDefsSize, numThreads, &package);
+        }
     }
 
     /* free the last one allocated */
     if (package != NULL) {
-        printf("</package>\n");
+        outPrintf("</package>\n");
         free(package);
     }
 
     if (gOptions.outputFormat == OUTPUT_XML)
-        printf("</api>\n");
+        outPrintf("</api>\n");
+
+    if (gOptions.className != NULL && !found) {
+        fprintf(stderr, "ERROR: class '%s' not found\n", gOptions.className);
+        return -1;
+    }
+    if (gOptions.methodClass != NULL && !found) {
+        fprintf(stderr, "ERROR: method '%s.%s%s%s' not found\n",
+            gOptions.methodClass, gOptions.methodName,
+            (gOptions.methodSignature != NULL) ? ":" : "",
+            (gOptions.methodSignature != NULL) ? gOptions.methodSignature : "");
+        return -1;
+    }
+    return 0;
+}
+
+
+/* appended to the input file name to get the name of its index */
+#define kSidecarSuffix      ".dexidx"
+
+/*
+ * With -s, use the saved index "<fileName>.dexidx" for the DEX files
+ * in "pDexFiles".  If it's missing, or doesn't match all of them, build
+ * a new one and write it back for next time.  Trouble with the index
+ * only costs us speed, so it isn't treated as an error.
+ *
+ * Returns the index in use, which must be freed after the DEX files, or
+ * NULL if there isn't one.
+ */
+static DexMetaIndex* useSidecarIndex(const char* fileName,
+    DexFile** pDexFiles, int numDex)
+{
+    DexMetaIndex* pIndex;
+    char* indexName;
+    int i;
+
+    indexName = (char*) malloc(strlen(fileName) + sizeof(kSidecarSuffix));
+    if (indexName == NULL)
+        return NULL;
+    strcpy(indexName, fileName);
+    strcat(indexName, kSidecarSuffix);
+
+    pIndex = dexMetaIndexOpen(indexName);
+    for (i = 0; pIndex != NULL && i < numDex; i++) {
+        if (dexMetaIndexFind(pIndex, pDexFiles[i]) == NULL) {
+            dexMetaIndexFree(pIndex);
+            pIndex = NULL;
+        }
+    }
+
+    if (pIndex == NULL) {
+        pIndex = dexMetaIndexCreate(pDexFiles, numDex);
+        if (pIndex == NULL)
+            goto bail;
+        (void) dexMetaIndexWrite(pIndex, indexName);
+    }
+
+    for (i = 0; i < numDex; i++) {
+        dexMemberCacheUseIndex(pDexFiles[i], pIndex,
+            dexMetaIndexFind(pIndex, pDexFiles[i]));
+    }
+
+bail:
+    free(indexName);
+    return pIndex;
 }
 
+/*
+ * Get the name of a map item type, as used in the DEX format spec.
+ */
+static const char* getMapTypeName(u2 type)
+{
+    switch (type) {
+    case kDexTypeHeaderItem:                return "header_item";
+    case kDexTypeStringIdItem:              return "string_id_item";
+    case kDexTypeTypeIdItem:                return "type_id_item";
+    case kDexTypeProtoIdItem:               return "proto_id_item";
+    case kDexTypeFieldIdItem:               return "field_id_item";
+    case kDexTypeMethodIdItem:              return "method_id_item";
+    case kDexTypeClassDefItem:              return "class_def_item";
+    case kDexTypeMapList:                   return "map_list";
+    case kDexTypeTypeList:                  return "type_list";
+    case kDexTypeAnnotationSetRefList:      return "annotation_set_ref_list";
+    case kDexTypeAnnotationSetItem:         return "annotation_set_item";
+    case kDexTypeClassDataItem:             return "class_data_item";
+    case kDexTypeCodeItem:                  return "code_item";
+    case kDexTypeStringDataItem:            return "string_data_item";
+    case kDexTypeDebugInfoItem:             return "debug_info_item";
+    case kDexTypeAnnotationItem:            return "annotation_item";
+    case kDexTypeEncodedArrayItem:          return "encoded_array_item";
+    case kDexTypeAnnotationsDirectoryItem:  return "annotations_directory_item";
+    default:                                return "(unknown)";
+    }
+}
+
+/*
+ * Run the full structural verifier over each DEX file, in place on the
+ * read-only mappings, and show how long each section took.  With -j, each
+ * file's sections are verified in parallel.
+ */
+static int verifyDexFiles(const MemMapping* maps, int numDex)
+{
+    int numThreads = (gOptions.numJobs > 1) ? gOptions.numJobs : 1;
+    DexVerifyTimings timings;
+    int result = 0;
+    int i;
+    u4 j;
+
+    for (i = 0; i < numDex; i++) {
+        char dexName[kMultiDexNameBufLen];
+
+        dexGetMultiDexEntryName(i+1, dexName, sizeof(dexName));
+        if (dexVerifyReadOnly((const u1*) maps[i].addr, maps[i].length,
+                numThreads, &timings) != 0)
+        {
+            if (numDex > 1)
+                fprintf(stderr, "ERROR: DEX verification failed (%s)\n",
+                    dexName);
+            else
+                fprintf(stderr, "ERROR: DEX verification failed\n");
+            result = -1;
+            continue;
+        }
+
+        if (numDex > 1)
+            outPrintf("%s:\n", dexName);
+        outPrintf("  %-27s %8s %10s %10s\n",
+            "section", "items", "intra(us)", "cross(us)");
+        for (j = 0; j < timings.numSections; j++) {
+            const DexSectionTiming* pTiming = &timings.sections[j];
+
+            outPrintf("  %-27s %8u %10.1f %10.1f\n",
+                getMapTypeName(pTiming->type), pTiming->size,
+                pTiming->intraNsec / 1000.0, pTiming->crossNsec / 1000.0);
+        }
+        outPrintf("  %-27s %8s %10.1f\n", "checksum", "",
+            timings.checksumNsec / 1000.0);
+        outPrintf("  %-27s %8s %10.1f\n", "total", "",
+            timings.totalNsec / 1000.0);
+        outPrintf("Verified\n");
+    }
+
+    return result;
+}
 
 /*
  * Process one file.
  */
 int process(const char* fileName)
 {
-    DexFile* pDexFile = NULL;
-    MemMapping map;
-    bool mapped = false;
+    DexFile** pDexFiles = NULL;
+    MemMapping* maps = NULL;
+    DexStreamDigest* digests = NULL;
+    DexMetaIndex* pMetaIndex = NULL;
+    int numDex = 0;
     int result = -1;
+    int flags;
+    int i;
 
     if (gOptions.verbose)
-        printf("Processing '%s'...\n", fileName);
+        outPrintf("Processing '%s'...\n", fileName);
+    flushOutput();
 
-    if (dexOpenAndMap(fileName, gOptions.tempFileName, &map, false) != 0)
-        goto bail;
-    mapped = true;
-
-    int flags = kDexParseVerifyChecksum;
+    flags = kDexParseVerifyChecksum;
     if (gOptions.ignoreBadChecksum)
         flags |= kDexParseContinueOnError;
+    if (gOptions.verifySignature)
+        flags |= kDexParseVerifySignature;
 
-    pDexFile = dexFileParse(map.addr, map.length, flags);
-    if (pDexFile == NULL) {
-        fprintf(stderr, "ERROR: DEX parse failed\n");
+    /*
+     * Unless we're only running the verifier, have the checksums computed
+     * while archive entries are expanded, so parsing doesn't have to read
+     * the data again.
+     */
+    if (gOptions.tempFileName != NULL) {
+        /* going through a temp file only gets us "classes.dex" */
+        maps = (MemMapping*) malloc(sizeof(MemMapping));
+        digests = (DexStreamDigest*) malloc(sizeof(DexStreamDigest));
+        dexStreamDigestInit(digests, flags);
+        if (dexOpenAndMap(fileName, gOptions.tempFileName, maps,
+                gOptions.verifyOnly ? NULL : digests, false) != 0)
+        {
+            free(maps);
+            maps = NULL;
+            goto bail;
+        }
+        numDex = 1;
+    } else {
+        if (dexOpenAndMapAll(fileName, &maps,
+                gOptions.verifyOnly ? NULL : &digests, flags,
+                &numDex, false) != 0)
+        {
+            goto bail;
+        }
+    }
+
+    if (gOptions.verifyOnly) {
+        result = verifyDexFiles(maps, numDex);
         goto bail;
     }
 
+    pDexFiles = (DexFile**) calloc(numDex, sizeof(DexFile*));
+    for (i = 0; i < numDex; i++) {
+        pDexFiles[i] = dexFileParseWithDigest(maps[i].addr, maps[i].length,
+            flags, &digests[i]);
+        if (pDexFiles[i] == NULL) {
+            if (numDex > 1) {
+                char dexName[kMultiDexNameBufLen];
+
+                dexGetMultiDexEntryName(i+1, dexName, sizeof(dexName));
+                fprintf(stderr, "ERROR: DEX parse failed (%s)\n", dexName);
+            } else {
+                fprintf(stderr, "ERROR: DEX parse failed\n");
+            }
+            goto bail;
+        }
+    }
+
     if (gOptions.checksumOnly) {
-        printf("Checksum verified\n");
+        outPrintf("Checksum verified\n");
+    } else if (gOptions.lineIndexOut != NULL) {
+        DexLineIndex* pIndex = dexLineIndexCreate(pDexFiles, numDex);
+        if (pIndex == NULL) {
+            fprintf(stderr, "ERROR: unable to build line index\n");
+            goto bail;
+        }
+        if (dexLineIndexWrite(pIndex, gOptions.lineIndexOut) != 0) {
+            dexLineIndexFree(pIndex);
+            goto bail;
+        }
+        dexLineIndexFree(pIndex);
     } else {
-        processDexFile(fileName, pDexFile);
+        for (i = 0; i < numDex; i++) {
+            if (!dexCreateMemberCache(pDexFiles[i])) {
+                fprintf(stderr, "ERROR: out of memory\n");
+                goto bail;
+            }
+        }
+        if (gOptions.useSidecar)
+            pMetaIndex = useSidecarIndex(fileName, pDexFiles, numDex);
+        if (processDexFiles(fileName, pDexFiles, numDex) != 0)
+            goto bail;
     }
 
     result = 0;
 
 bail:
-    if (mapped)
-        sysReleaseShmem(&map);
-    if (pDexFile != NULL)
+    if (pDexFiles != NULL) {
+        for (i = 0; i < numDex; i++) {
+            if (pDexFiles[i] != NULL)
+                dexFileFree(pDexFiles[i]);
+        }
+        free(pDexFiles);
+    }
+    dexMetaIndexFree(pMetaIndex);
+    if (maps != NULL)
+        dexReleaseMaps(maps, numDex);
+    free(digests);
+    flushOutput();
+    return result;
+}
+
+/*
+ * Output captured from one child in a parallel run.
+ */
+typedef struct CapturedOutput {
+    int     fd;             /* read end of the child's pipe, or -1 */
+    char*   data;
+    size_t  len;
+    size_t  max;
+} CapturedOutput;
+
+/*
+ * One input file in a parallel run.  "out[0]" collects stdout, "out[1]"
+ * collects stderr.
+ */
+typedef struct BatchJob {
+    const char*     fileName;
+    pid_t           pid;
+    bool            done;
+    bool            failed;
+    CapturedOutput  out[2];
+} BatchJob;
+
+/*
+ * Write all of "len" bytes to "fd".
+ */
+static void writeFully(int fd, const char* data, size_t len)
+{
+    while (len > 0) {
+        ssize_t actual = write(fd, data, len);
+        if (actual < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        data += actual;
+        len -= actual;
+    }
+}
+
+/*
+ * Fork a child to process the job's file, with its stdout and stderr
+ * going to pipes.  Returns false if the child couldn't be started.
+ */
+static bool startBatchJob(BatchJob* pJob)
+{
+    int pipes[2][2];
+    int i;
+
+    if (pipe(pipes[0]) != 0)
+        return false;
+    if (pipe(pipes[1]) != 0) {
+        close(pipes[0][0]);
+        close(pipes[0][1]);
+        return false;
+    }
+
+    /* don't let the child inherit anything we've buffered */
+    fflush(stdout);
+    fflush(stderr);
+
+    pJob->pid = fork();
+    if (pJob->pid == 0) {
+        int result;
+
+        dup2(pipes[0][1], STDOUT_FILENO);
+        dup2(pipes[1][1], STDERR_FILENO);
+        for (i = 0; i < 2; i++) {
+            close(pipes[i][0]);
+            close(pipes[i][1]);
+        }
+
+        /* any parallelism is ours; dump the classes one at a time */
+        gOptions.numJobs = 1;
+
+        /*
+         * Children running at the same time can't share the temp file,
+         * since it's created exclusively.  It's removed as soon as it's
+         * mapped, so the name doesn't show in the output.
+         */
+        if (gOptions.tempFileName != NULL) {
+            char* tempFileName =
+                    (char*) malloc(strlen(gOptions.tempFileName) + 16);
+            sprintf(tempFileName, "%s.%d", gOptions.tempFileName,
+                    (int) getpid());
+            gOptions.tempFileName = tempFileName;
+        }
+
+        result = process(pJob->fileName);
+        fflush(stdout);
+        fflush(stderr);
+        _exit(result != 0);
+    }
+
+    for (i = 0; i < 2; i++) {
+        close(pipes[i][1]);
+        if (pJob->pid < 0) {
+            close(pipes[i][0]);
+            pJob->out[i].fd = -1;
+        } else {
+            pJob->out[i].fd = pipes[i][0];
+        }
+    }
+
+    return pJob->pid > 0;
+}
+
+/*
+ * Make sure there's room for at least "len" more bytes of output.
+ */
+static void reserveCaptured(CapturedOutput* pOut, size_t len)
+{
+    if (pOut->max - pOut->len < len) {
+        if (pOut->max == 0)
+            pOut->max = 65536;
+        while (pOut->max - pOut->len < len)
+            pOut->max *= 2;
+        pOut->data = (char*) realloc(pOut->data, pOut->max);
+    }
+}
+
+/*
+ * Read what's available from one of a job's pipes.  Returns false once
+ * the pipe has been drained and closed.
+ */
+static bool readBatchOutput(CapturedOutput* pOut)
+{
+    ssize_t actual;
+
+    reserveCaptured(pOut, 4096);
+
+    actual = read(pOut->fd, pOut->data + pOut->len, pOut->max - pOut->len);
+    if (actual < 0 && (errno == EINTR || errno == EAGAIN))
+        return true;
+    if (actual <= 0) {
+        close(pOut->fd);
+        pOut->fd = -1;
+        return false;
+    }
+
+    pOut->len += actual;
+    return true;
+}
+
+/*
+ * Copy whatever a job has produced so far to our own stdout and stderr.
+ */
+static void flushBatchOutput(BatchJob* pJob)
+{
+    writeFully(STDOUT_FILENO, pJob->out[0].data, pJob->out[0].len);
+    pJob->out[0].len = 0;
+    writeFully(STDERR_FILENO, pJob->out[1].data, pJob->out[1].len);
+    pJob->out[1].len = 0;
+}
+
+/*
+ * Reap a job's child once both of its pipes have closed.
+ */
+static void finishBatchJob(BatchJob* pJob)
+{
+    int status;
+
+    while (waitpid(pJob->pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            status = 1 << 8;
+            break;
+        }
+    }
+
+    if (WIFSIGNALED(status)) {
+        CapturedOutput* pErr = &pJob->out[1];
+        char msg[256];
+        int len = snprintf(msg, sizeof(msg),
+            "%s: '%s' killed by signal %d\n", gProgName, pJob->fileName,
+            WTERMSIG(status));
+
+        /* report it in sequence with the rest of the job's errors */
+        reserveCaptured(pErr, len);
+        memcpy(pErr->data + pErr->len, msg, len);
+        pErr->len += len;
+        pJob->failed = true;
+    } else {
+        pJob->failed = (WEXITSTATUS(status) != 0);
+    }
+    pJob->done = true;
+}
+
+/*
+ * Process several files at once, each in its own child process, with up
+ * to "numJobs" running at a time.
+ *
+ * Each child's output is captured and copied out in argument order: the
+ * oldest unfinished file streams straight through, later ones are held
+ * until it's their turn.  The result is identical to a serial run.
+ *
+ * Returns nonzero if any file failed.
+ */
+static int processInParallel(char* const fileNames[], int numFiles,
+    int numJobs)
+{
+    BatchJob* jobs;
+    struct pollfd* pollFds;
+    BatchJob** pollJobs;
+    int* pollWhich;
+    int head = 0, next = 0, running = 0;
+    int result = 0;
+    int i, j;
+
+    jobs = (BatchJob*) calloc(numFiles, sizeof(BatchJob));
+    pollFds = (struct pollfd*) malloc(sizeof(struct pollfd) * numJobs * 2);
+    pollJobs = (BatchJob**) malloc(sizeof(BatchJob*) * numJobs * 2);
+    pollWhich = (int*) malloc(sizeof(int) * numJobs * 2);
+
+    while (head < numFiles) {
+        int numPoll = 0;
+
+        /* keep the pool full */
+        while (running < numJobs && next < numFiles) {
+            BatchJob* pJob = &jobs[next++];
+
+            pJob->fileName = fileNames[next-1];
+            if (startBatchJob(pJob)) {
+                running++;
+            } else {
+                fprintf(stderr, "%s: unable to start job for '%s': %s\n",
+                    gProgName, pJob->fileName, strerror(errno));
+                pJob->done = pJob->failed = true;
+            }
+        }
+
+        for (i = head; i < next; i++) {
+            for (j = 0; j < 2; j++) {
+                if (jobs[i].out[j].fd < 0)
+                    continue;
+                pollFds[numPoll].fd = jobs[i].out[j].fd;
+                pollFds[numPoll].events = POLLIN;
+                pollJobs[numPoll] = &jobs[i];
+                pollWhich[numPoll] = j;
+                numPoll++;
+            }
+        }
+
+        if (numPoll > 0) {
+            if (poll(pollFds, numPoll, -1) < 0) {
+                if (errno == EINTR)
+                    continue;
+                fprintf(stderr, "%s: poll failed: %s\n", gProgName,
+                    strerror(errno));
+                exit(1);
+            }
+
+            for (i = 0; i < numPoll; i++) {
+                BatchJob* pJob = pollJobs[i];
+
+                if (pollFds[i].revents == 0)
+                    continue;
+                if (!readBatchOutput(&pJob->out[pollWhich[i]]) &&
+                    pJob->out[0].fd < 0 && pJob->out[1].fd < 0)
+                {
+                    finishBatchJob(pJob);
+                    running--;
+                }
+            }
+        }
+
+        /* pass along everything we can without getting out of order */
+        while (head < next) {
+            flushBatchOutput(&jobs[head]);
+            if (!jobs[head].done)
+                break;
+
+            if (jobs[head].failed)
+                result = 1;
+            free(jobs[head].out[0].data);
+            free(jobs[head].out[1].data);
+            head++;
+        }
+    }
+
+    free(pollWhich);
+    free(pollJobs);
+    free(pollFds);
+    free(jobs);
+    return result;
+}
+
+/*
+ * Parse a line index lookup, "[dex:]method:address".  "dex" counts from 1
+ * (as in "classes2.dex") and defaults to 1; the result counts from 0.
+ */
+static bool parseLineLookup(const char* arg, u4* pDexIdx, u4* pMethodIdx,
+    u4* pAddress)
+{
+    unsigned long vals[3];
+    const char* cp = arg;
+    char* end;
+    int numVals = 0;
+
+    while (numVals < 3) {
+        vals[numVals++] = strtoul(cp, &end, 0);
+        if (end == cp || *end != ':')
+            break;
+        cp = end + 1;
+    }
+    if (end == cp || *end != '\0' || numVals < 2 ||
+        (numVals == 3 && vals[0] == 0))
+    {
+        return false;
+    }
+
+    *pDexIdx = (numVals == 3) ? vals[0] - 1 : 0;
+    *pMethodIdx = vals[numVals-2];
+    *pAddress = vals[numVals-1];
+    return true;
+}
+
+/*
+ * Check that a line index was built from "fileName".  Returns false, with
+ * a message, if it wasn't or the file can't be read.
+ */
+static bool checkLineIndex(const DexLineIndex* pIndex, const char* fileName)
+{
+    MemMapping* maps = NULL;
+    u4* checksums = NULL;
+    int numDex = 0;
+    bool result = false;
+    int i;
+
+    if (dexOpenAndMapAll(fileName, &maps, NULL, 0, &numDex, false) != 0)
+        return false;
+
+    checksums = (u4*) malloc(numDex * sizeof(u4));
+    for (i = 0; i < numDex; i++) {
+        DexFile* pDexFile = dexFileParse(maps[i].addr, maps[i].length,
+            kDexParseDefault);
+        if (pDexFile == NULL) {
+            fprintf(stderr, "ERROR: DEX parse failed\n");
+            goto bail;
+        }
+        checksums[i] = pDexFile->pHeader->checksum;
         dexFileFree(pDexFile);
+    }
+
+    if (!dexLineIndexMatches(pIndex, checksums, numDex)) {
+        fprintf(stderr, "%s: line index is out of date for '%s'\n",
+            gProgName, fileName);
+        goto bail;
+    }
+    result = true;
+
+bail:
+    free(checksums);
+    dexReleaseMaps(maps, numDex);
     return result;
 }
 
+/*
+ * Look up source lines in a line index written with "-x".  Each argument
+ * is "[dex:]method:address", where "dex" counts from 1 (as in
+ * "classes2.dex") and defaults to 1, and the address is in code units.
+ * Numbers may be decimal or 0x-prefixed hex.
+ *
+ * If the first argument isn't a lookup, it's the DEX file the index is
+ * for, and the index is checked against it before anything is looked up.
+ */
+int lookupLines(const char* indexFileName, char* const args[], int numArgs)
+{
+    DexLineIndex* pIndex;
+    int result = 0;
+    int i = 0;
+    u4 dexIdx, methodIdx, address;
+
+    pIndex = dexLineIndexOpen(indexFileName);
+    if (pIndex == NULL)
+        return -1;
+
+    if (numArgs > 0 &&
+        !parseLineLookup(args[0], &dexIdx, &methodIdx, &address))
+    {
+        if (!checkLineIndex(pIndex, args[0])) {
+            result = -1;
+            goto bail;
+        }
+        i++;
+    }
+
+    for (; i < numArgs; i++) {
+        if (!parseLineLookup(args[i], &dexIdx, &methodIdx, &address)) {
+            fprintf(stderr, "%s: bad lookup '%s' (want [dex:]method:address)\n",
+                gProgName, args[i]);
+            result = -1;
+            continue;
+        }
+
+        int line = dexLineIndexLookup(pIndex, dexIdx, methodIdx, address);
+
+        if (line < 0)
+            outPrintf("%s line=?\n", args[i]);
+        else
+            outPrintf("%s line=%d\n", args[i], line);
+    }
+
+bail:
+    dexLineIndexFree(pIndex);
+    flushOutput();
+    return result;
+}
 
 /*
  * Show usage.
@@ -1678,17 +2752,71 @@ void usage(void)
 {
     fprintf(stderr, "Copyright (C) 2007 The Android Open Source Project\n\n");
     fprintf(stderr,
-        "%s: [-c] [-d] [-f] [-h] [-i] [-l layout] [-m] [-t tempfile] dexfile...\n",
+        "%s: [-c] [-C class] [-d] [-f] [-h] [-i] [-j jobs] [-l layout] [-m]"
+        " [-M method] [-s] [-S] [-t tempfile] [-V] dexfile...\n",
+        gProgName);
+    fprintf(stderr, "%s: -x idxfile dexfile\n", gProgName);
+    fprintf(stderr, "%s: -a idxfile [dexfile] [dex:]method:address...\n",
         gProgName);
     fprintf(stderr, "\n");
+    fprintf(stderr,
+        " -a : look up source lines in a line number index (checked against\n"
+        "      dexfile, if given)\n");
     fprintf(stderr, " -c : verify checksum and exit\n");
+    fprintf(stderr,
+        " -C : dump only the named class (e.g. 'Ljava/lang/Object;')\n");
     fprintf(stderr, " -d : disassemble code sections\n");
     fprintf(stderr, " -f : display summary information from file header\n");
     fprintf(stderr, " -h : display file header details\n");
     fprintf(stderr, " -i : ignore checksum failures\n");
+    fprintf(stderr,
+        " -j : number of files, or a single file's classes or sections (-V), to do\n"
+        "      in parallel\n");
     fprintf(stderr, " -l : output layout, either 'plain' or 'xml'\n");
     fprintf(stderr, " -m : dump register maps (and nothing else)\n");
-    fprintf(stderr, " -t : temp file name (defaults to /sdcard/dex-temp-*)\n");
+    fprintf(stderr,
+        " -M : dump only the named method (e.g. 'Lpkg/Cls;.run:()V'; the\n"
+        "      signature is optional)\n");
+    fprintf(stderr,
+        " -s : keep decoded metadata in 'dexfile.dexidx' to speed up later runs\n");
+    fprintf(stderr, " -S : verify the SHA-1 signature too\n");
+    fprintf(stderr, " -t : temp file name (classes.dex only; default: expand in memory)\n");
+    fprintf(stderr,
+        " -V : run the full structural verifier, show its timings and exit\n");
+    fprintf(stderr, " -x : write a line number index for the file and exit\n");
+}
+
+/*
+ * Split a -M argument, "Lpkg/Cls;.name[:signature]", into gOptions.
+ */
+static bool parseMethodSpec(const char* spec)
+{
+    char* copy;
+    char* cp;
+
+    free(gOptions.methodClass);
+    gOptions.methodClass = NULL;
+
+    copy = strdup(spec);
+    cp = strstr(copy, ";.");
+    if (copy[0] != 'L' || cp == NULL || cp[2] == '\0' || cp[2] == ':') {
+        fprintf(stderr, "%s: bad method '%s' (want Lpkg/Cls;.name[:sig])\n",
+            gProgName, spec);
+        free(copy);
+        return false;
+    }
+
+    cp[1] = '\0';
+    gOptions.methodClass = copy;
+    gOptions.methodName = cp + 2;
+    cp = strchr(cp + 2, ':');
+    if (cp != NULL) {
+        *cp = '\0';
+        gOptions.methodSignature = cp + 1;
+    } else {
+        gOptions.methodSignature = NULL;
+    }
+    return true;
 }
 
 /*
@@ -1703,16 +2831,23 @@ int main(int argc, char* const argv[])
 
     memset(&gOptions, 0, sizeof(gOptions));
     gOptions.verbose = true;
+    gOut = &gStdoutSink;
 
     while (1) {
-        ic = getopt(argc, argv, "cdfhil:mt:");
+        ic = getopt(argc, argv, "a:cC:dfhij:l:mM:sSt:Vx:");
         if (ic < 0)
             break;
 
         switch (ic) {
+        case 'a':       // look up lines in an index
+            gOptions.lineIndexIn = optarg;
+            break;
         case 'c':       // verify the checksum then exit
             gOptions.checksumOnly = true;
             break;
+        case 'C':       // dump just this class
+            gOptions.className = optarg;
+            break;
         case 'd':       // disassemble Dalvik instructions
             gOptions.disassemble = true;
             break;
@@ -1725,6 +2860,11 @@ int main(int argc, char* const argv[])
         case 'i':       // continue even if checksum is bad
             gOptions.ignoreBadChecksum = true;
             break;
+        case 'j':       // process this many files at once
+            gOptions.numJobs = atoi(optarg);
+            if (gOptions.numJobs < 1)
+                wantUsage = true;
+            break;
         case 'l':       // layout
             if (strcmp(optarg, "plain") == 0) {
                 gOptions.outputFormat = OUTPUT_PLAIN;
@@ -1739,9 +2879,25 @@ int main(int argc, char* const argv[])
         case 'm':       // dump register maps only
             gOptions.dumpRegisterMaps = true;
             break;
+        case 'M':       // dump just this method
+            if (!parseMethodSpec(optarg))
+                wantUsage = true;
+            break;
+        case 's':       // use a sidecar metadata index
+            gOptions.useSidecar = true;
+            break;
+        case 'S':       // verify the SHA-1 signature
+            gOptions.verifySignature = true;
+            break;
         case 't':       // temp file, used when opening compressed Jar
             gOptions.tempFileName = optarg;
             break;
+        case 'V':       // full verification then exit
+            gOptions.verifyOnly = true;
+            break;
+        case 'x':       // write a line number index
+            gOptions.lineIndexOut = optarg;
+            break;
         default:
             wantUsage = true;
             break;
@@ -1758,9 +2914,15 @@ int main(int argc, char* const argv[])
         wantUsage = true;
     }
 
-    /* initialize some VM tables */
-    gInstrWidth = dexCreateInstrWidthTable();
-    gInstrFormat = dexCreateInstrFormatTable();
+    if (gOptions.className != NULL && gOptions.methodClass != NULL) {
+        fprintf(stderr, "Can't specify both -C and -M\n");
+        wantUsage = true;
+    }
+
+    if (gOptions.lineIndexOut != NULL && argc - optind > 1) {
+        fprintf(stderr, "Can only write a line index for one file\n");
+        wantUsage = true;
+    }
 
     if (wantUsage) {
         usage();
@@ -1768,12 +2930,21 @@ int main(int argc, char* const argv[])
     }
 
     int result = 0;
-    while (optind < argc) {
-        result |= process(argv[optind++]);
+    if (gOptions.lineIndexIn != NULL) {
+        gOptions.verbose = false;
+        result = lookupLines(gOptions.lineIndexIn, argv + optind,
+            argc - optind);
+    } else if (gOptions.numJobs > 1 && argc - optind > 1) {
+        result = processInParallel(argv + optind, argc - optind,
+            gOptions.numJobs);
+    } else {
+        while (optind < argc) {
+            result |= process(argv[optind++]);
+        }
     }
 
-    free(gInstrWidth);
-    free(gInstrFormat);
+    free(gStdoutSink.buf);
+    free(gOptions.methodClass);
 
     return (result != 0);
 }
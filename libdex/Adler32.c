@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Adler-32 checksums.
+ *
+ * For bytes b[0..n-1] the two halves of the checksum advance as
+ *
+ *   s1' = s1 + sum(b[i])
+ *   s2' = s2 + n*s1 + sum((n-i) * b[i])
+ *
+ * so a block can be done with a horizontal byte sum and a dot product
+ * against the weights n..1, which map directly onto SIMD instructions.
+ * Sums are reduced mod 65521 every kAdlerMaxRun bytes, the longest run
+ * that can't overflow 32 bits (zlib's NMAX).
+ */
+
+#include "Adler32.h"
+#include "SysUtil.h"
+
+#include <zlib.h>
+
+#include <stdlib.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+# define ADLER32_X86_SIMD
+# include <immintrin.h>
+#endif
+
+#define kAdlerBase      65521
+#define kAdlerMaxRun    5552
+
+/* below this, threads cost more than they save */
+#define kAdlerMinParallel   (4 * 1024 * 1024)
+
+/*
+ * Portable version, for the ends of buffers and CPUs without SIMD.
+ */
+static u4 adler32Scalar(u4 adler, const u1* buf, size_t len)
+{
+    u4 s1 = adler & 0xffff;
+    u4 s2 = adler >> 16;
+
+    while (len > 0) {
+        size_t run = (len < kAdlerMaxRun) ? len : kAdlerMaxRun;
+
+        len -= run;
+        while (run >= 8) {
+            s1 += buf[0]; s2 += s1;
+            s1 += buf[1]; s2 += s1;
+            s1 += buf[2]; s2 += s1;
+            s1 += buf[3]; s2 += s1;
+            s1 += buf[4]; s2 += s1;
+            s1 += buf[5]; s2 += s1;
+            s1 += buf[6]; s2 += s1;
+            s1 += buf[7]; s2 += s1;
+            buf += 8;
+            run -= 8;
+        }
+        while (run-- > 0) {
+            s1 += *buf++;
+            s2 += s1;
+        }
+        s1 %= kAdlerBase;
+        s2 %= kAdlerBase;
+    }
+
+    return (s2 << 16) | s1;
+}
+
+#ifdef ADLER32_X86_SIMD
+/*
+ * SSSE3 version, 16 bytes at a time.
+ */
+__attribute__((target("ssse3")))
+static u4 adler32Ssse3(u4 adler, const u1* buf, size_t len)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i weights = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+        8, 7, 6, 5, 4, 3, 2, 1);
+    u4 s1 = adler & 0xffff;
+    u4 s2 = adler >> 16;
+
+    while (len >= 16) {
+        size_t run = (len < kAdlerMaxRun) ? len : kAdlerMaxRun;
+        __m128i vs1, vs2, vs1Sum;
+
+        run &= ~(size_t) 15;
+        len -= run;
+
+        /* s2 picks up 16*s1 for every block, so keep a sum of the s1s */
+        vs1 = _mm_cvtsi32_si128(s1);
+        vs2 = _mm_cvtsi32_si128(s2);
+        vs1Sum = zero;
+        while (run > 0) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*) buf);
+
+            vs1Sum = _mm_add_epi32(vs1Sum, vs1);
+            vs1 = _mm_add_epi32(vs1, _mm_sad_epu8(bytes, zero));
+            vs2 = _mm_add_epi32(vs2,
+                _mm_madd_epi16(_mm_maddubs_epi16(bytes, weights), ones));
+            buf += 16;
+            run -= 16;
+        }
+        vs2 = _mm_add_epi32(vs2, _mm_slli_epi32(vs1Sum, 4));
+
+        /* add up the lanes */
+        vs1 = _mm_add_epi32(vs1, _mm_shuffle_epi32(vs1, 0x4e));
+        vs1 = _mm_add_epi32(vs1, _mm_shuffle_epi32(vs1, 0xb1));
+        vs2 = _mm_add_epi32(vs2, _mm_shuffle_epi32(vs2, 0x4e));
+        vs2 = _mm_add_epi32(vs2, _mm_shuffle_epi32(vs2, 0xb1));
+        s1 = (u4) _mm_cvtsi128_si32(vs1) % kAdlerBase;
+        s2 = (u4) _mm_cvtsi128_si32(vs2) % kAdlerBase;
+    }
+
+    return adler32Scalar((s2 << 16) | s1, buf, len);
+}
+
+/*
+ * AVX2 version, 32 bytes at a time.
+ */
+__attribute__((target("avx2")))
+static u4 adler32Avx2(u4 adler, const u1* buf, size_t len)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+        24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9,
+        8, 7, 6, 5, 4, 3, 2, 1);
+    u4 s1 = adler & 0xffff;
+    u4 s2 = adler >> 16;
+
+    while (len >= 32) {
+        size_t run = (len < kAdlerMaxRun) ? len : kAdlerMaxRun;
+        __m256i vs1, vs2, vs1Sum;
+        __m128i s1Half, s2Half;
+
+        run &= ~(size_t) 31;
+        len -= run;
+
+        vs1 = _mm256_setr_epi32(s1, 0, 0, 0, 0, 0, 0, 0);
+        vs2 = _mm256_setr_epi32(s2, 0, 0, 0, 0, 0, 0, 0);
+        vs1Sum = zero;
+        while (run > 0) {
+            __m256i bytes = _mm256_loadu_si256((const __m256i*) buf);
+
+            vs1Sum = _mm256_add_epi32(vs1Sum, vs1);
+            vs1 = _mm256_add_epi32(vs1, _mm256_sad_epu8(bytes, zero));
+            vs2 = _mm256_add_epi32(vs2,
+                _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, weights), ones));
+            buf += 32;
+            run -= 32;
+        }
+        vs2 = _mm256_add_epi32(vs2, _mm256_slli_epi32(vs1Sum, 5));
+
+        s1Half = _mm_add_epi32(_mm256_castsi256_si128(vs1),
+            _mm256_extracti128_si256(vs1, 1));
+        s2Half = _mm_add_epi32(_mm256_castsi256_si128(vs2),
+            _mm256_extracti128_si256(vs2, 1));
+        s1Half = _mm_add_epi32(s1Half, _mm_shuffle_epi32(s1Half, 0x4e));
+        s1Half = _mm_add_epi32(s1Half, _mm_shuffle_epi32(s1Half, 0xb1));
+        s2Half = _mm_add_epi32(s2Half, _mm_shuffle_epi32(s2Half, 0x4e));
+        s2Half = _mm_add_epi32(s2Half, _mm_shuffle_epi32(s2Half, 0xb1));
+        s1 = (u4) _mm_cvtsi128_si32(s1Half) % kAdlerBase;
+        s2 = (u4) _mm_cvtsi128_si32(s2Half) % kAdlerBase;
+    }
+
+    return adler32Scalar((s2 << 16) | s1, buf, len);
+}
+#endif /*ADLER32_X86_SIMD*/
+
+/*
+ * Compute a checksum with the best version the CPU supports.
+ */
+u4 dexAdler32(u4 adler, const u1* buf, size_t len)
+{
+#ifdef ADLER32_X86_SIMD
+    if (__builtin_cpu_supports("avx2"))
+        return adler32Avx2(adler, buf, len);
+    if (__builtin_cpu_supports("ssse3"))
+        return adler32Ssse3(adler, buf, len);
+#endif
+    return adler32Scalar(adler, buf, len);
+}
+
+/*
+ * Pieces of the buffer for dexAdler32Parallel().  Each piece is summed
+ * on its own from kAdler32Init, and the results combined in order.
+ */
+typedef struct Adler32Work {
+    const u1*   buf;
+    size_t      len;
+    int         numPieces;
+    u4*         results;
+} Adler32Work;
+
+/*
+ * Get the length of a piece.  The last one takes up the slack.
+ */
+static size_t adler32PieceLen(const Adler32Work* pWork, int idx)
+{
+    size_t pieceLen = pWork->len / pWork->numPieces;
+
+    if (idx == pWork->numPieces-1)
+        return pWork->len - pieceLen * idx;
+    return pieceLen;
+}
+
+static void adler32Worker(void* arg, int idx)
+{
+    Adler32Work* pWork = (Adler32Work*) arg;
+    size_t start = (pWork->len / pWork->numPieces) * idx;
+
+    pWork->results[idx] = dexAdler32(kAdler32Init, pWork->buf + start,
+        adler32PieceLen(pWork, idx));
+}
+
+/*
+ * Compute a checksum in parallel.
+ */
+u4 dexAdler32Parallel(u4 adler, const u1* buf, size_t len, int numThreads)
+{
+    Adler32Work work;
+    int numPieces = numThreads;
+    int i;
+
+    if ((size_t) numPieces > len / kAdlerMinParallel)
+        numPieces = len / kAdlerMinParallel;
+    if (numPieces < 2)
+        return dexAdler32(adler, buf, len);
+
+    work.results = (u4*) malloc(numPieces * sizeof(u4));
+    if (work.results == NULL)
+        return dexAdler32(adler, buf, len);
+
+    work.buf = buf;
+    work.len = len;
+    work.numPieces = numPieces;
+    sysRunParallel(numPieces, numThreads, adler32Worker, &work);
+
+    for (i = 0; i < numPieces; i++) {
+        adler = (u4) adler32_combine(adler, work.results[i],
+            adler32PieceLen(&work, i));
+    }
+
+    free(work.results);
+    return adler;
+}
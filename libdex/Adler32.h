@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Adler-32 checksums, as used in the DEX header.  The results are the same
+ * as zlib's adler32(), but the work is done with SSSE3 or AVX2 when the
+ * CPU has them, and large buffers can be split across threads.
+ */
+
+#ifndef _LIBDEX_ADLER32
+#define _LIBDEX_ADLER32
+
+#include "DexFile.h"
+
+/* the checksum of nothing; the starting value for dexAdler32() */
+#define kAdler32Init    1
+
+/*
+ * Update a running Adler-32 checksum with "len" bytes from "buf".
+ */
+u4 dexAdler32(u4 adler, const u1* buf, size_t len);
+
+/*
+ * Like dexAdler32(), but with up to "numThreads" threads working on
+ * separate pieces of a large buffer.  Small buffers aren't worth the
+ * threads, and are done on the calling thread.
+ */
+u4 dexAdler32Parallel(u4 adler, const u1* buf, size_t len, int numThreads);
+
+#endif /*_LIBDEX_ADLER32*/
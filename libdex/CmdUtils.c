@@ -25,14 +25,17 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
+#include <limits.h>
 
 /*
  * Extract "classes.dex" from archive file.
  *
+ * If "pDigest" is non-NULL, it's fed the data as it's expanded.
+ *
  * If "quiet" is set, don't report common errors.
  */
 UnzipToFileResult dexUnzipToFile(const char* zipFileName,
-    const char* outFileName, bool quiet)
+    const char* outFileName, DexStreamDigest* pDigest, bool quiet)
 {
     UnzipToFileResult result = kUTFRSuccess;
     static const char* kFileToExtract = "classes.dex";
@@ -70,7 +73,7 @@ UnzipToFileResult dexUnzipToFile(const char* zipFileName,
         goto bail;
     }
 
-    if (!dexZipExtractEntryToFile(&archive, entry, fd)) {
+    if (!dexZipExtractEntryToFile(&archive, entry, fd, pDigest)) {
         fprintf(stderr, "Extract of '%s' from '%s' failed\n",
             kFileToExtract, zipFileName);
         result = kUTFRBadZip;
@@ -87,26 +90,241 @@ bail:
 }
 
 /*
- * Map the specified DEX file read-only (possibly after expanding it into a
- * temp file from a Jar).  Pass in a MemMapping struct to hold the info.
+ * Get the name of the "dexIdx"th DEX file in an archive, counting from 1:
+ * "classes.dex", "classes2.dex", "classes3.dex", and so on.
+ */
+void dexGetMultiDexEntryName(int dexIdx, char* buf, size_t bufLen)
+{
+    if (dexIdx <= 1)
+        snprintf(buf, bufLen, "classes.dex");
+    else
+        snprintf(buf, bufLen, "classes%d.dex", dexIdx);
+}
+
+/*
+ * Shared state for extractWorker().
+ */
+typedef struct ExtractWork {
+    const ZipArchive*   pArchive;
+    const ZipEntry*     entries;
+    MemMapping*         maps;
+    DexStreamDigest*    digests;    /* may be NULL */
+} ExtractWork;
+
+/*
+ * Expand one entry into memory, unless it's already mapped in place.  On
+ * failure the mapping is left zeroed.
+ */
+static void extractWorker(void* arg, int idx)
+{
+    ExtractWork* pWork = (ExtractWork*) arg;
+    MemMapping* pMap = &pWork->maps[idx];
+
+    if (pMap->addr != NULL)
+        return;
+
+    if (!dexZipExtractEntryToMemory(pWork->pArchive, pWork->entries[idx],
+            pMap, (pWork->digests != NULL) ? &pWork->digests[idx] : NULL))
+    {
+        memset(pMap, 0, sizeof(*pMap));
+    }
+}
+
+/*
+ * Get "classes.dex", "classes2.dex", ... (up to "maxEntries" of them) from
+ * an archive.  Stored entries are used in place; compressed ones are
+ * expanded into memory, in parallel when there's more than one.
+ *
+ * On success, "*ppMaps" points to "*pCount" mappings, which must be
+ * released together with dexReleaseMaps().  If "ppDigests" is non-NULL,
+ * it gets a matching array of digests, computed according to
+ * "digestFlags" for the entries that were expanded.
+ */
+static UnzipToFileResult unzipDexEntries(const char* zipFileName,
+    int maxEntries, MemMapping** ppMaps, DexStreamDigest** ppDigests,
+    int digestFlags, int* pCount, bool quiet)
+{
+    UnzipToFileResult result = kUTFRSuccess;
+    char entryName[kMultiDexNameBufLen];
+    ZipArchive archive;
+    ZipEntry* entries = NULL;
+    MemMapping* maps = NULL;
+    DexStreamDigest* digests = NULL;
+    ExtractWork work;
+    int count = 0;
+    int owner = -1;
+    int i;
+
+    if (dexZipOpenArchive(zipFileName, &archive) != 0) {
+        if (!quiet) {
+            fprintf(stderr, "Unable to open '%s' as zip archive\n",
+                zipFileName);
+        }
+        result = kUTFRNotZip;
+        goto bail;
+    }
+
+    /*
+     * Secondary DEX files are numbered consecutively from 2, so we stop
+     * looking at the first one that's missing.
+     */
+    if (maxEntries > archive.mNumEntries)
+        maxEntries = archive.mNumEntries;
+    entries = (ZipEntry*) malloc(sizeof(ZipEntry) * maxEntries);
+    while (count < maxEntries) {
+        ZipEntry entry;
+
+        dexGetMultiDexEntryName(count+1, entryName, sizeof(entryName));
+        entry = dexZipFindEntry(&archive, entryName);
+        if (entry == NULL)
+            break;
+        entries[count++] = entry;
+    }
+
+    if (count == 0) {
+        if (!quiet) {
+            fprintf(stderr, "Unable to find 'classes.dex' in '%s'\n",
+                zipFileName);
+        }
+        result = kUTFRNoClassesDex;
+        goto bail;
+    }
+
+    maps = (MemMapping*) calloc(count, sizeof(MemMapping));
+    if (ppDigests != NULL) {
+        digests = (DexStreamDigest*) malloc(count * sizeof(DexStreamDigest));
+        for (i = 0; i < count; i++)
+            dexStreamDigestInit(&digests[i], digestFlags);
+    }
+
+    for (i = 0; i < count; i++) {
+        if (dexZipMapStoredEntry(&archive, entries[i], &maps[i]) && owner < 0)
+            owner = i;
+    }
+
+    work.pArchive = &archive;
+    work.entries = entries;
+    work.maps = maps;
+    work.digests = digests;
+    sysRunParallel(count, sysGetCpuCount(), extractWorker, &work);
+
+    for (i = 0; i < count; i++) {
+        if (maps[i].addr == NULL) {
+            dexGetMultiDexEntryName(i+1, entryName, sizeof(entryName));
+            fprintf(stderr, "Extract of '%s' from '%s' failed\n",
+                entryName, zipFileName);
+            result = kUTFRBadZip;
+        }
+    }
+    if (result != kUTFRSuccess)
+        goto bail;
+
+    /*
+     * Entries used in place point into the archive's mapping, so it has to
+     * outlive the archive.  Give it to the first of them.
+     */
+    if (owner >= 0)
+        dexZipDetachMap(&archive, &maps[owner]);
+
+    *ppMaps = maps;
+    *pCount = count;
+    maps = NULL;
+    if (ppDigests != NULL) {
+        *ppDigests = digests;
+        digests = NULL;
+    }
+
+bail:
+    if (maps != NULL)
+        dexReleaseMaps(maps, count);
+    free(digests);
+    free(entries);
+    dexZipCloseArchive(&archive);
+    return result;
+}
+
+/*
+ * Extract "classes.dex" from archive file into a private memory segment,
+ * or use it in place if it's stored uncompressed.  On success, "pMap"
+ * holds the data; release it with sysReleaseShmem().
+ *
+ * If "pDigest" is non-NULL, it's fed the data as it's expanded.
+ *
+ * If "quiet" is set, don't report common errors.
+ */
+UnzipToFileResult dexUnzipToMemory(const char* zipFileName,
+    MemMapping* pMap, DexStreamDigest* pDigest, bool quiet)
+{
+    UnzipToFileResult result;
+    MemMapping* maps;
+    DexStreamDigest* digests = NULL;
+    int count;
+
+    result = unzipDexEntries(zipFileName, 1, &maps,
+        (pDigest != NULL) ? &digests : NULL,
+        (pDigest != NULL) ? pDigest->flags : 0, &count, quiet);
+    if (result == kUTFRSuccess) {
+        sysCopyMap(pMap, &maps[0]);
+        free(maps);
+        if (pDigest != NULL) {
+            *pDigest = digests[0];
+            free(digests);
+        }
+    }
+    return result;
+}
+
+/*
+ * Map a plain DEX file read-only.
+ */
+static UnzipToFileResult mapDexFile(const char* fileName, MemMapping* pMap,
+    bool quiet)
+{
+    int fd;
+
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        if (!quiet) {
+            fprintf(stderr, "ERROR: unable to open '%s': %s\n",
+                fileName, strerror(errno));
+        }
+        return kUTFRGenericFailure;
+    }
+
+    if (sysMapFileInShmemReadOnly(fd, pMap) != 0) {
+        fprintf(stderr, "ERROR: Unable to map %s\n", fileName);
+        close(fd);
+        return kUTFRGenericFailure;
+    }
+
+    close(fd);
+    return kUTFRSuccess;
+}
+
+/*
+ * Map the specified DEX file read-only (possibly after expanding it from
+ * a Jar).  Pass in a MemMapping struct to hold the info.
  *
- * The temp file is deleted after the map succeeds.
+ * Archives are expanded straight into memory unless "tempFileName" is
+ * given, in which case the contents are written there first and the temp
+ * file is deleted after the map succeeds.
  *
  * This is intended for use by tools (e.g. dexdump) that need to get a
  * read-only copy of a DEX file that could be in a number of different states.
  *
+ * If "pDigest" is non-NULL, it's fed the data of an archive entry as it's
+ * expanded.
+ *
  * If "quiet" is set, don't report common errors.
  *
  * Returns 0 (kUTFRSuccess) on success.
  */
 UnzipToFileResult dexOpenAndMap(const char* fileName, const char* tempFileName,
-    MemMapping* pMap, bool quiet)
+    MemMapping* pMap, DexStreamDigest* pDigest, bool quiet)
 {
     UnzipToFileResult result = kUTFRGenericFailure;
     int len = strlen(fileName);
-    char tempNameBuf[32];
     bool removeTemp = false;
-    int fd = -1;
 
     if (len < 5) {
         if (!quiet) {
@@ -118,31 +336,30 @@ UnzipToFileResult dexOpenAndMap(const char* fileName, const char* tempFileName,
     }
 
     if (strcasecmp(fileName + len -3, "dex") != 0) {
+        /*
+         * Try .zip/.jar/.apk, all of which are Zip archives with
+         * "classes.dex" inside.  Unless we were asked for a temp file,
+         * expand the data directly into memory; there's no need to
+         * round-trip it through the filesystem.
+         */
         if (tempFileName == NULL) {
-            /*
-             * Try .zip/.jar/.apk, all of which are Zip archives with
-             * "classes.dex" inside.  We need to extract the compressed
-             * data to a temp file, the location of which varies.
-             */
-            if (access("/tmp", W_OK) == 0)
-                sprintf(tempNameBuf, "/tmp/dex-temp-%d", getpid());
-            else
-                sprintf(tempNameBuf, "/sdcard/dex-temp-%d", getpid());
-
-            tempFileName = tempNameBuf;
+            result = dexUnzipToMemory(fileName, pMap, pDigest, quiet);
+            if (result == kUTFRSuccess)
+                goto bail;
+        } else {
+            result = dexUnzipToFile(fileName, tempFileName, pDigest, quiet);
+            if (result == kUTFRSuccess) {
+                //printf("+++ Good unzip to '%s'\n", tempFileName);
+                fileName = tempFileName;
+                removeTemp = true;
+            }
         }
 
-        result = dexUnzipToFile(fileName, tempFileName, quiet);
-        
-        if (result == kUTFRSuccess) {
-            //printf("+++ Good unzip to '%s'\n", tempFileName);
-            fileName = tempFileName;
-            removeTemp = true;
-        } else if (result == kUTFRNotZip) {
+        if (result == kUTFRNotZip) {
             if (!quiet) {
                 fprintf(stderr, "Not Zip, retrying as DEX\n");
             }
-        } else {
+        } else if (result != kUTFRSuccess) {
             if (!quiet && result == kUTFRNoClassesDex) {
                 fprintf(stderr, "Zip has no classes.dex\n");
             }
@@ -153,29 +370,9 @@ UnzipToFileResult dexOpenAndMap(const char* fileName, const char* tempFileName,
     /*
      * Pop open the (presumed) DEX file.
      */
-    fd = open(fileName, O_RDONLY);
-    if (fd < 0) {
-        if (!quiet) {
-            fprintf(stderr, "ERROR: unable to open '%s': %s\n",
-                fileName, strerror(errno));
-        }
-        goto bail;
-    }
-
-    if (sysMapFileInShmemReadOnly(fd, pMap) != 0) {
-        fprintf(stderr, "ERROR: Unable to map %s\n", fileName);
-        close(fd);
-        goto bail;
-    }
-
-    /*
-     * Success!  Close the file and return with the start/length in pMap.
-     */
-    result = 0;
+    result = mapDexFile(fileName, pMap, quiet);
 
 bail:
-    if (fd >= 0)
-        close(fd);
     if (removeTemp) {
         if (unlink(tempFileName) != 0) {
             fprintf(stderr, "Warning: unable to remove temp '%s'\n",
@@ -184,3 +381,80 @@ bail:
     }
     return result;
 }
+
+/*
+ * Map every DEX file in the named file.  A plain DEX file yields a single
+ * mapping; a Zip archive yields one for each of "classes.dex",
+ * "classes2.dex", and so on.
+ *
+ * On success, "*ppMaps" points to "*pCount" mappings, in order.  They may
+ * share storage, so release them together with dexReleaseMaps().  If
+ * "ppDigests" is non-NULL, it gets a matching array of digests, computed
+ * according to "digestFlags" for the entries that had to be expanded;
+ * release it with free().
+ *
+ * If "quiet" is set, don't report common errors.
+ *
+ * Returns 0 (kUTFRSuccess) on success.
+ */
+UnzipToFileResult dexOpenAndMapAll(const char* fileName, MemMapping** ppMaps,
+    DexStreamDigest** ppDigests, int digestFlags, int* pCount, bool quiet)
+{
+    UnzipToFileResult result = kUTFRGenericFailure;
+    int len = strlen(fileName);
+    MemMapping* pMap;
+
+    if (len < 5) {
+        if (!quiet) {
+            fprintf(stderr, 
+                "ERROR: filename must end in .dex, .zip, .jar, or .apk\n");
+        }
+        return kUTFRBadArgs;
+    }
+
+    if (strcasecmp(fileName + len -3, "dex") != 0) {
+        result = unzipDexEntries(fileName, INT_MAX, ppMaps, ppDigests,
+            digestFlags, pCount, quiet);
+        if (result == kUTFRSuccess)
+            return result;
+
+        if (result == kUTFRNotZip) {
+            if (!quiet) {
+                fprintf(stderr, "Not Zip, retrying as DEX\n");
+            }
+        } else {
+            if (!quiet && result == kUTFRNoClassesDex) {
+                fprintf(stderr, "Zip has no classes.dex\n");
+            }
+            return result;
+        }
+    }
+
+    pMap = (MemMapping*) malloc(sizeof(MemMapping));
+    result = mapDexFile(fileName, pMap, quiet);
+    if (result != kUTFRSuccess) {
+        free(pMap);
+        return result;
+    }
+
+    if (ppDigests != NULL) {
+        *ppDigests = (DexStreamDigest*) malloc(sizeof(DexStreamDigest));
+        dexStreamDigestInit(*ppDigests, digestFlags);
+    }
+    *ppMaps = pMap;
+    *pCount = 1;
+    return kUTFRSuccess;
+}
+
+/*
+ * Release a set of mappings from dexOpenAndMapAll(), and the array that
+ * holds them.
+ */
+void dexReleaseMaps(MemMapping* pMaps, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+        sysReleaseShmem(&pMaps[i]);
+    free(pMaps);
+}
@@ -42,26 +42,71 @@ typedef enum UnzipToFileResult {
     kUTFRBadZip,
 } UnzipToFileResult;
 
+/* big enough for the name of any entry from dexGetMultiDexEntryName() */
+#define kMultiDexNameBufLen     32
+
 /*
- * Map the specified DEX file, possibly after expanding it into a temp file
- * from a Jar.  Pass in a MemMapping struct to hold the info.
+ * Map the specified DEX file, possibly after expanding it from a Jar.
+ * Pass in a MemMapping struct to hold the info.
  *
  * This is intended for use by tools (e.g. dexdump) that need to get a
  * read-only copy of a DEX file that could be in a number of different states.
  *
- * If "tempFileName" is NULL, a default value is used.  The temp file is
+ * If "tempFileName" is NULL, archive contents are expanded directly into
+ * memory.  Otherwise they're written to the named temp file, which is
  * deleted after the map succeeds.
  *
+ * If "pDigest" is non-NULL (and set up with dexStreamDigestInit()), the
+ * checksums are computed as the data is expanded, for passing to
+ * dexFileParseWithDigest().  It's only finished if there was something to
+ * expand.
+ *
  * Returns 0 on success.
  */
 UnzipToFileResult dexOpenAndMap(const char* fileName, const char* tempFileName,
-    MemMapping* pMap, bool quiet);
+    MemMapping* pMap, DexStreamDigest* pDigest, bool quiet);
+
+/*
+ * Map every DEX file in the named file: the file itself, or each of
+ * "classes.dex", "classes2.dex", ... if it's a Zip archive.  Compressed
+ * entries are expanded in parallel.
+ *
+ * On success, "*ppMaps" points to "*pCount" mappings, in order.  They may
+ * share storage, so they must be released together with dexReleaseMaps().
+ *
+ * If "ppDigests" is non-NULL, "*ppDigests" gets a matching array of
+ * digests, which the caller must free().  As with dexOpenAndMap(), they
+ * are computed as entries are expanded, with "digestFlags" passed to
+ * dexStreamDigestInit().
+ *
+ * Returns 0 on success.
+ */
+UnzipToFileResult dexOpenAndMapAll(const char* fileName, MemMapping** ppMaps,
+    DexStreamDigest** ppDigests, int digestFlags, int* pCount, bool quiet);
+
+/*
+ * Release the mappings from dexOpenAndMapAll(), and the array itself.
+ */
+void dexReleaseMaps(MemMapping* pMaps, int count);
+
+/*
+ * Get the archive entry name of the "dexIdx"th DEX file, counting from 1
+ * ("classes.dex", "classes2.dex", ...).
+ */
+void dexGetMultiDexEntryName(int dexIdx, char* buf, size_t bufLen);
 
 /*
  * Utility function to open a Zip archive, find "classes.dex", and extract
  * it to a file.
  */
 UnzipToFileResult dexUnzipToFile(const char* zipFileName,
-    const char* outFileName, bool quiet);
+    const char* outFileName, DexStreamDigest* pDigest, bool quiet);
+
+/*
+ * Like dexUnzipToFile, but expands "classes.dex" into a private memory
+ * segment instead.  Suitably aligned stored entries are used in place.
+ */
+UnzipToFileResult dexUnzipToMemory(const char* zipFileName,
+    MemMapping* pMap, DexStreamDigest* pDigest, bool quiet);
 
 #endif /*_LIBDEX_CMDUTILS*/
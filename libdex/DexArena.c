@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Bump-pointer allocator.
+ */
+#include "DexArena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* allocations are rounded up to a multiple of this */
+#define kArenaAlign     8
+
+struct DexArenaChunk {
+    DexArenaChunk*  next;
+    size_t          size;           /* usable bytes after the header */
+    /* pad the header so the data that follows is aligned */
+    u8              data[0];
+};
+
+/*
+ * Initialize an empty arena.
+ */
+void dexArenaInit(DexArena* pArena, size_t chunkSize)
+{
+    pArena->chunks = NULL;
+    pArena->ptr = pArena->end = NULL;
+    pArena->chunkSize = chunkSize;
+}
+
+/*
+ * Release everything allocated from the arena.
+ */
+void dexArenaRelease(DexArena* pArena)
+{
+    DexArenaChunk* pChunk = pArena->chunks;
+
+    while (pChunk != NULL) {
+        DexArenaChunk* pNext = pChunk->next;
+        free(pChunk);
+        pChunk = pNext;
+    }
+    pArena->chunks = NULL;
+    pArena->ptr = pArena->end = NULL;
+}
+
+/*
+ * Discard everything but the first chunk.
+ */
+void dexArenaReset(DexArena* pArena)
+{
+    DexArenaChunk* pChunk = pArena->chunks;
+
+    if (pChunk == NULL)
+        return;
+
+    while (pChunk->next != NULL) {
+        DexArenaChunk* pNext = pChunk->next;
+        free(pChunk);
+        pChunk = pNext;
+    }
+    pArena->chunks = pChunk;
+    pArena->ptr = (u1*) pChunk->data;
+    pArena->end = pArena->ptr + pChunk->size;
+}
+
+/*
+ * Allocate "size" bytes.
+ */
+void* dexArenaAlloc(DexArena* pArena, size_t size)
+{
+    void* result;
+
+    size = (size + kArenaAlign - 1) & ~(size_t) (kArenaAlign - 1);
+
+    if ((size_t) (pArena->end - pArena->ptr) < size) {
+        size_t chunkSize = pArena->chunkSize;
+        DexArenaChunk* pChunk;
+
+        if (size > chunkSize)
+            chunkSize = size;
+        pChunk = (DexArenaChunk*) malloc(sizeof(DexArenaChunk) + chunkSize);
+        if (pChunk == NULL)
+            return NULL;
+
+        pChunk->next = pArena->chunks;
+        pChunk->size = chunkSize;
+        pArena->chunks = pChunk;
+        pArena->ptr = (u1*) pChunk->data;
+        pArena->end = pArena->ptr + chunkSize;
+    }
+
+    result = pArena->ptr;
+    pArena->ptr += size;
+    return result;
+}
+
+/*
+ * Copy a string into the arena.
+ */
+char* dexArenaStrdup(DexArena* pArena, const char* str)
+{
+    size_t len = strlen(str) + 1;
+    char* copy = (char*) dexArenaAlloc(pArena, len);
+
+    if (copy != NULL)
+        memcpy(copy, str, len);
+    return copy;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Simple bump-pointer allocator, for lots of small allocations that all
+ * go away at the same time.
+ *
+ * Not thread-safe; callers that share an arena must lock around it.
+ */
+#ifndef _LIBDEX_DEXARENA
+#define _LIBDEX_DEXARENA
+
+#include "DexFile.h"
+
+typedef struct DexArenaChunk DexArenaChunk;
+
+typedef struct DexArena {
+    DexArenaChunk*  chunks;         /* most recent first */
+    u1*             ptr;            /* next free byte in chunks[0] */
+    u1*             end;            /* end of chunks[0] */
+    size_t          chunkSize;      /* usable size of a normal chunk */
+} DexArena;
+
+/*
+ * Initialize an empty arena.  Memory is obtained "chunkSize" bytes at a
+ * time (or more, for allocations that won't fit in that).
+ */
+void dexArenaInit(DexArena* pArena, size_t chunkSize);
+
+/*
+ * Release everything allocated from the arena.  The arena can be reused
+ * afterward.
+ */
+void dexArenaRelease(DexArena* pArena);
+
+/*
+ * Discard everything allocated from the arena, but hang on to the first
+ * chunk so an arena that's reset regularly settles into making no calls
+ * to malloc.
+ */
+void dexArenaReset(DexArena* pArena);
+
+/*
+ * Allocate "size" bytes, aligned for any basic type.  Returns NULL if
+ * we're out of memory.
+ */
+void* dexArenaAlloc(DexArena* pArena, size_t size);
+
+/*
+ * Copy a string into the arena.  Returns NULL if we're out of memory.
+ */
+char* dexArenaStrdup(DexArena* pArena, const char* str);
+
+#endif /*_LIBDEX_DEXARENA*/
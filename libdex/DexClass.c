@@ -18,6 +18,7 @@
  * Functions to deal with class definition structures in DEX files
  */
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include "DexClass.h"
@@ -36,6 +37,18 @@ static bool verifyUlebs(const u1* pData, const u1* pLimit, u4 count) {
     return okay;
 }
 
+/* Turn the index deltas at every "stride"th element of "values" into
+ * indices. */
+static void resolveIndexDeltas(u4* values, u4 count, u4 stride) {
+    u4 lastIndex = 0;
+    u4 i;
+
+    for (i = 0; i < count; i++, values += stride) {
+        lastIndex += *values;
+        *values = lastIndex;
+    }
+}
+
 /* Read and verify the header of a class_data_item. This updates the
  * given data pointer to point past the end of the read data and
  * returns an "okay" flag (that is, false == failure). */
@@ -103,7 +116,6 @@ bool dexReadAndVerifyClassDataMethod(const u1** pData, const u1* pLimit,
  * are valid. */
 DexClassData* dexReadAndVerifyClassData(const u1** pData, const u1* pLimit) {
     DexClassDataHeader header;
-    u4 lastIndex;
 
     if (*pData == NULL) {
         DexClassData* result = malloc(sizeof(DexClassData));
@@ -115,6 +127,20 @@ DexClassData* dexReadAndVerifyClassData(const u1** pData, const u1* pLimit) {
         return NULL;
     }
 
+    /*
+     * The fields and methods are decoded in one go below, so check their
+     * value count first.  Each value takes at least a byte.
+     */
+    u8 count = 2 * ((u8) header.staticFieldsSize + header.instanceFieldsSize) +
+        3 * ((u8) header.directMethodsSize + header.virtualMethodsSize);
+
+    if (count > UINT32_MAX) {
+        return NULL;
+    }
+    if ((pLimit != NULL) && (count > (u8) (pLimit - *pData))) {
+        return NULL;
+    }
+
     size_t resultSize = sizeof(DexClassData) +
         (header.staticFieldsSize * sizeof(DexField)) +
         (header.instanceFieldsSize * sizeof(DexField)) +
@@ -124,7 +150,6 @@ DexClassData* dexReadAndVerifyClassData(const u1** pData, const u1* pLimit) {
     DexClassData* result = malloc(resultSize);
     u1* ptr = ((u1*) result) + sizeof(DexClassData);
     bool okay = true;
-    u4 i;
 
     if (result == NULL) {
         return NULL;
@@ -159,28 +184,24 @@ DexClassData* dexReadAndVerifyClassData(const u1** pData, const u1* pLimit) {
         result->virtualMethods = NULL;
     }
 
-    lastIndex = 0;
-    for (i = 0; okay && (i < header.staticFieldsSize); i++) {
-        okay = dexReadAndVerifyClassDataField(pData, pLimit,
-                &result->staticFields[i], &lastIndex);
-    }
-
-    lastIndex = 0;
-    for (i = 0; okay && (i < header.instanceFieldsSize); i++) {
-        okay = dexReadAndVerifyClassDataField(pData, pLimit,
-                &result->instanceFields[i], &lastIndex);
-    }
+    /*
+     * DexField and DexMethod hold their values in the order they're
+     * encoded, starting with the index, and the four arrays follow each
+     * other, so the whole lot can be decoded in one go.  The index deltas
+     * are then summed.
+     */
+    okay = readAndVerifyUnsignedLeb128Array(pData, pLimit,
+            (u4*) (((u1*) result) + sizeof(DexClassData)), (u4) count);
 
-    lastIndex = 0;
-    for (i = 0; okay && (i < header.directMethodsSize); i++) {
-        okay = dexReadAndVerifyClassDataMethod(pData, pLimit,
-                &result->directMethods[i], &lastIndex);
-    }
-    
-    lastIndex = 0;
-    for (i = 0; okay && (i < header.virtualMethodsSize); i++) {
-        okay = dexReadAndVerifyClassDataMethod(pData, pLimit,
-                &result->virtualMethods[i], &lastIndex);
+    if (okay) {
+        resolveIndexDeltas((u4*) result->staticFields,
+                header.staticFieldsSize, 2);
+        resolveIndexDeltas((u4*) result->instanceFields,
+                header.instanceFieldsSize, 2);
+        resolveIndexDeltas((u4*) result->directMethods,
+                header.directMethodsSize, 3);
+        resolveIndexDeltas((u4*) result->virtualMethods,
+                header.virtualMethodsSize, 3);
     }
 
     if (! okay) {
@@ -190,3 +211,33 @@ DexClassData* dexReadAndVerifyClassData(const u1** pData, const u1* pLimit) {
 
     return result;
 }
+
+/* Verify the raw data format of an entire class_data_item, without
+ * expanding it. Returns an "okay" flag (that is, false == failure). */
+bool dexVerifyClassData(const u1* pData, const u1* pLimit) {
+    DexClassDataHeader header;
+    u4 values[64];
+    bool okay = true;
+    u8 count;
+
+    if (pData == NULL) {
+        return true;
+    }
+
+    if (! dexReadAndVerifyClassDataHeader(&pData, pLimit, &header)) {
+        return false;
+    }
+
+    /* two ulebs per encoded_field, three per encoded_method */
+    count = 2 * ((u8) header.staticFieldsSize + header.instanceFieldsSize) +
+        3 * ((u8) header.directMethodsSize + header.virtualMethodsSize);
+
+    while (okay && (count != 0)) {
+        u4 chunk = (count < 64) ? count : 64;
+
+        okay = readAndVerifyUnsignedLeb128Array(&pData, pLimit, values, chunk);
+        count -= chunk;
+    }
+
+    return okay;
+}
@@ -24,6 +24,8 @@
 #include "DexFile.h"
 #include "Leb128.h"
 
+#include <string.h>
+
 /* expanded form of a class_data_item header */
 typedef struct DexClassDataHeader {
     u4 staticFieldsSize;
@@ -102,6 +104,15 @@ bool dexReadAndVerifyClassDataMethod(const u1** pData, const u1* pLimit,
  * are valid. */
 DexClassData* dexReadAndVerifyClassData(const u1** pData, const u1* pLimit);
 
+/* Verify the raw data format of an entire class_data_item, the same way
+ * dexReadAndVerifyClassData() does, but without expanding it. Returns
+ * an "okay" flag (that is, false == failure). A NULL pData is okay.
+ *
+ * pLimit should be passed as the end of the file (or NULL, if the
+ * item is already known to fit); otherwise a garbage item count can
+ * send us reading off the end. */
+bool dexVerifyClassData(const u1* pData, const u1* pLimit);
+
 /*
  * Get the DexCode for a DexMethod.  Returns NULL if the class is native
  * or abstract.
@@ -159,4 +170,125 @@ DEX_INLINE void dexReadClassDataMethod(const u1** pData, DexMethod* pMethod,
     *lastIndex = index;
 }
 
+/* the lists in a class_data_item, in the order they appear */
+enum {
+    kDexClassDataStaticFields = 0,
+    kDexClassDataInstanceFields,
+    kDexClassDataDirectMethods,
+    kDexClassDataVirtualMethods,
+    kDexClassDataEnd
+};
+
+/* Iterator over a class_data_item, which decodes the fields and methods
+ * one at a time, straight from the mapped data. Nothing is allocated
+ * and nothing is verified; use dexVerifyClassData() first if the data
+ * hasn't been checked.
+ *
+ * The iterator can also walk arrays of fields and methods that were
+ * decoded earlier (see dexClassDataIteratorInitDecoded()); pData is
+ * NULL in that case. */
+typedef struct DexClassDataIterator {
+    DexClassDataHeader header;
+    const u1* pData;        /* next encoded item */
+    const DexField* pFields;    /* next pre-decoded field, if any */
+    const DexMethod* pMethods;  /* next pre-decoded method, if any */
+    int list;               /* current list; see the enum above */
+    u4 remaining;           /* items left in the current list */
+    u4 lastIndex;           /* last index decoded in the current list */
+} DexClassDataIterator;
+
+/* Move past any lists that have been used up, starting the next one
+ * with a fresh lastIndex. */
+DEX_INLINE void dexClassDataIteratorSettle(DexClassDataIterator* pIter) {
+    while (pIter->remaining == 0 && pIter->list < kDexClassDataEnd) {
+        pIter->list++;
+        pIter->lastIndex = 0;
+        switch (pIter->list) {
+        case kDexClassDataInstanceFields:
+            pIter->remaining = pIter->header.instanceFieldsSize;
+            break;
+        case kDexClassDataDirectMethods:
+            pIter->remaining = pIter->header.directMethodsSize;
+            break;
+        case kDexClassDataVirtualMethods:
+            pIter->remaining = pIter->header.virtualMethodsSize;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/* Start iterating over the class_data_item at pData, reading its
+ * header. As with dexReadAndVerifyClassData(), a NULL pData is
+ * treated as an empty item. */
+DEX_INLINE void dexClassDataIteratorInit(DexClassDataIterator* pIter,
+        const u1* pData) {
+    if (pData == NULL) {
+        memset(&pIter->header, 0, sizeof(pIter->header));
+    } else {
+        dexReadClassDataHeader(&pData, &pIter->header);
+    }
+    pIter->pData = pData;
+    pIter->pFields = NULL;
+    pIter->pMethods = NULL;
+    pIter->list = kDexClassDataStaticFields;
+    pIter->remaining = pIter->header.staticFieldsSize;
+    pIter->lastIndex = 0;
+    dexClassDataIteratorSettle(pIter);
+}
+
+/* Start iterating over fields and methods that have already been
+ * decoded: the static then instance fields in pFields, and the direct
+ * then virtual methods in pMethods, with counts from pHeader. */
+DEX_INLINE void dexClassDataIteratorInitDecoded(DexClassDataIterator* pIter,
+        const DexClassDataHeader* pHeader, const DexField* pFields,
+        const DexMethod* pMethods) {
+    pIter->header = *pHeader;
+    pIter->pData = NULL;
+    pIter->pFields = pFields;
+    pIter->pMethods = pMethods;
+    pIter->list = kDexClassDataStaticFields;
+    pIter->remaining = pIter->header.staticFieldsSize;
+    pIter->lastIndex = 0;
+    dexClassDataIteratorSettle(pIter);
+}
+
+/* Read the next static or instance field. Returns false once the
+ * fields have all been read. */
+DEX_INLINE bool dexClassDataIteratorNextField(DexClassDataIterator* pIter,
+        DexField* pField) {
+    if (pIter->list > kDexClassDataInstanceFields)
+        return false;
+
+    if (pIter->pFields != NULL)
+        *pField = *pIter->pFields++;
+    else
+        dexReadClassDataField(&pIter->pData, pField, &pIter->lastIndex);
+    pIter->remaining--;
+    dexClassDataIteratorSettle(pIter);
+    return true;
+}
+
+/* Read the next direct or virtual method, skipping any fields that
+ * haven't been read yet. Returns false once the methods have all been
+ * read. */
+DEX_INLINE bool dexClassDataIteratorNextMethod(DexClassDataIterator* pIter,
+        DexMethod* pMethod) {
+    while (pIter->list < kDexClassDataDirectMethods) {
+        DexField field;
+        dexClassDataIteratorNextField(pIter, &field);
+    }
+    if (pIter->list == kDexClassDataEnd)
+        return false;
+
+    if (pIter->pMethods != NULL)
+        *pMethod = *pIter->pMethods++;
+    else
+        dexReadClassDataMethod(&pIter->pData, pMethod, &pIter->lastIndex);
+    pIter->remaining--;
+    dexClassDataIteratorSettle(pIter);
+    return true;
+}
+
 #endif
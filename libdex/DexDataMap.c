@@ -51,6 +51,9 @@ DexDataMap* dexDataMapAlloc(u4 maxCount) {
     map->max = maxCount;
     map->offsets = (u4*) (map + 1);
     map->types = (u2*) (map->offsets + maxCount);
+    map->words = NULL;
+    map->base = 0;
+    map->span = 0;
 
     return map;
 }
@@ -60,10 +63,14 @@ DexDataMap* dexDataMapAlloc(u4 maxCount) {
  */
 void dexDataMapFree(DexDataMap* map) {
     /*
-     * Since everything got allocated together, everything can be freed
-     * in one fell swoop. Also, free(NULL) is a nop (per spec), so we
-     * don't have to worry about an explicit test for that.
+     * Since everything but the dense index got allocated together,
+     * everything can be freed in one fell swoop. Also, free(NULL) is a
+     * nop (per spec), so we don't have to worry about an explicit test
+     * for that.
      */
+    if (map != NULL) {
+        free(map->words);
+    }
     free(map);
 }
 
@@ -82,11 +89,57 @@ void dexDataMapAdd(DexDataMap* map, u4 offset, u2 type) {
         return;
     }
 
+    if (map->words != NULL) {
+        free(map->words);
+        map->words = NULL;
+    }
+
     map->offsets[map->count] = offset;
     map->types[map->count] = type;
     map->count++;
 }
 
+/*
+ * Build the dense index.
+ */
+bool dexDataMapBuildIndex(DexDataMap* map) {
+    DexDataMapWord* words;
+    u4 numWords;
+    u4 i;
+
+    assert(map != NULL);
+
+    free(map->words);
+    map->words = NULL;
+
+    if (map->count == 0) {
+        return true;
+    }
+
+    map->base = map->offsets[0];
+    map->span = map->offsets[map->count - 1] - map->base + 1;
+    numWords = (map->span + 31) / 32;
+
+    words = calloc(numWords, sizeof(DexDataMapWord));
+    if (words == NULL) {
+        return false;
+    }
+
+    for (i = 0; i < map->count; i++) {
+        u4 delta = map->offsets[i] - map->base;
+        words[delta / 32].bits |= 1U << (delta % 32);
+    }
+
+    u4 rank = 0;
+    for (i = 0; i < numWords; i++) {
+        words[i].rank = rank;
+        rank += __builtin_popcount(words[i].bits);
+    }
+
+    map->words = words;
+    return true;
+}
+
 /*
  * Get the type associated with the given offset. This returns -1 if
  * there is no entry for the given offset.
@@ -94,6 +147,24 @@ void dexDataMapAdd(DexDataMap* map, u4 offset, u2 type) {
 int dexDataMapGet(DexDataMap* map, u4 offset) {
     assert(map != NULL);
 
+    if (map->words != NULL) {
+        u4 delta = offset - map->base;  // wraps if offset < base
+
+        if (delta >= map->span) {
+            return -1;
+        }
+
+        const DexDataMapWord* word = &map->words[delta / 32];
+        u4 bit = 1U << (delta % 32);
+
+        if ((word->bits & bit) == 0) {
+            return -1;
+        }
+
+        return map->types[word->rank
+                + __builtin_popcount(word->bits & (bit - 1))];
+    }
+
     // Note: Signed type is important for max and min.
     int min = 0;
     int max = map->count - 1;
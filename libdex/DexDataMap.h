@@ -23,11 +23,27 @@
 
 #include "DexFile.h"
 
+/*
+ * One word of the dense index: a bit for each of 32 consecutive offsets,
+ * set where an item starts, and the number of items before the first of
+ * those offsets.  An item's index in "offsets" and "types" is then "rank"
+ * plus the set bits below its own.
+ */
+typedef struct DexDataMapWord {
+    u4 rank;
+    u4 bits;
+} DexDataMapWord;
+
 typedef struct DexDataMap {
     u4 count;    /* number of items currently in the map */
     u4 max;      /* maximum number of items that may be held */
     u4* offsets; /* array of item offsets */
     u2* types;   /* corresponding array of item types */
+
+    /* dense index, from dexDataMapBuildIndex(); NULL if not built */
+    DexDataMapWord* words;
+    u4 base;     /* offset of the first item */
+    u4 span;     /* offsets covered, from base to the last item */
 } DexDataMap;
 
 /*
@@ -46,6 +62,17 @@ void dexDataMapFree(DexDataMap* map);
  */
 void dexDataMapAdd(DexDataMap* map, u4 offset, u2 type);
 
+/*
+ * Build a dense index over the items added so far, so that lookups take
+ * constant time instead of a binary search.  It costs a quarter of a byte
+ * per byte of the range the items cover.  Adding another item drops the
+ * index.
+ *
+ * Returns false (leaving lookups to the binary search) if there's not
+ * enough memory.
+ */
+bool dexDataMapBuildIndex(DexDataMap* map);
+
 /*
  * Get the type associated with the given offset. This returns -1 if
  * there is no entry for the given offset.
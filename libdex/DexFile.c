@@ -19,14 +19,15 @@
  */
 
 #include "DexFile.h"
+#include "Adler32.h"
 #include "DexProto.h"
 #include "DexCatch.h"
+#include "DexMemberCache.h"
 #include "Leb128.h"
 #include "sha1.h"
+#include "SysUtil.h"
 #include "ZipArchive.h"
 
-#include <zlib.h>
-
 #include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
@@ -352,9 +353,21 @@ static u4 classDescriptorHash(const char* str)
     return hash;
 }
 
+/*
+ * Get an entry's distance from its home slot in the class lookup table.
+ */
+static inline int classLookupDistance(const DexClassLookup* pLookup, int idx)
+{
+    int mask = pLookup->numEntries-1;
+
+    return (idx - (int) (pLookup->table[idx].classDescriptorHash & mask)) & mask;
+}
+
 /*
  * Add an entry to the class lookup table.  We hash the string and probe
- * until we find an open slot.
+ * until we find an open slot.  Robin Hood style, an entry that's further
+ * from its home slot than the one it lands on takes that slot, and we
+ * carry on placing the entry that was there.
  */
 static void classLookupAdd(DexFile* pDexFile, DexClassLookup* pLookup,
     int stringOff, int classDefOff, int* pNumProbes)
@@ -372,8 +385,26 @@ static void classLookupAdd(DexFile* pDexFile, DexClassLookup* pLookup,
      * guaranteed to finish.
      */
     int probes = 0;
+    int dist = 0;
     while (pLookup->table[idx].classDescriptorOffset != 0) {
+        int slotDist = classLookupDistance(pLookup, idx);
+
+        if (slotDist < dist) {
+            u4 tmpHash = pLookup->table[idx].classDescriptorHash;
+            int tmpStringOff = pLookup->table[idx].classDescriptorOffset;
+            int tmpClassDefOff = pLookup->table[idx].classDefOffset;
+
+            pLookup->table[idx].classDescriptorHash = hash;
+            pLookup->table[idx].classDescriptorOffset = stringOff;
+            pLookup->table[idx].classDefOffset = classDefOff;
+            hash = tmpHash;
+            stringOff = tmpStringOff;
+            classDefOff = tmpClassDefOff;
+            dist = slotDist;
+        }
+
         idx = (idx + 1) & mask;
+        dist++;
         probes++;
     }
     //if (probes > 1)
@@ -687,6 +718,79 @@ static bool parseAuxData(const u1* data, DexFile* pDexFile)
     return true;
 }
 
+/*
+ * Offsets of the first bytes covered by the checksum and the signature.
+ */
+#define kChecksumStart  (offsetof(DexHeader, checksum) + sizeof(u4))
+#define kSignatureStart (offsetof(DexHeader, signature) + kSHA1DigestLen)
+
+/*
+ * Start a stream digest.  Only the kDexParseVerifyChecksum and
+ * kDexParseVerifySignature bits of "flags" matter.
+ */
+void dexStreamDigestInit(DexStreamDigest* pDigest, int flags)
+{
+    memset(pDigest, 0, sizeof(*pDigest));
+    pDigest->flags =
+        flags & (kDexParseVerifyChecksum | kDexParseVerifySignature);
+    pDigest->checksum = kAdler32Init;
+    if (pDigest->flags & kDexParseVerifySignature)
+        SHA1Init(&pDigest->sha1Ctx);
+}
+
+/*
+ * Add the next "len" bytes of the file.  The header fields that hold the
+ * checksum and signature themselves are skipped, as they are when the
+ * values are computed from the whole file.
+ */
+void dexStreamDigestUpdate(DexStreamDigest* pDigest, const u1* data,
+    size_t len)
+{
+    size_t offset = pDigest->length;
+    size_t skip;
+
+    assert(!pDigest->done);
+    pDigest->length += len;
+
+    if ((pDigest->flags & kDexParseVerifyChecksum) &&
+        offset + len > kChecksumStart)
+    {
+        skip = (offset < kChecksumStart) ? kChecksumStart - offset : 0;
+        pDigest->checksum = dexAdler32(pDigest->checksum, data + skip,
+            len - skip);
+    }
+    if ((pDigest->flags & kDexParseVerifySignature) &&
+        offset + len > kSignatureStart)
+    {
+        skip = (offset < kSignatureStart) ? kSignatureStart - offset : 0;
+        SHA1Update(&pDigest->sha1Ctx, data + skip, len - skip);
+    }
+}
+
+/*
+ * Finish a stream digest after the last of the data.
+ */
+void dexStreamDigestFinish(DexStreamDigest* pDigest)
+{
+    if (pDigest->flags & kDexParseVerifySignature)
+        SHA1Final(pDigest->signature, &pDigest->sha1Ctx);
+    pDigest->done = true;
+}
+
+/*
+ * Determine whether "pDigest" holds the value asked for by "what" for the
+ * DEX file being parsed.  It has to cover exactly the same bytes, so it's
+ * no use for optimized DEX files, or ones with the wrong size in the
+ * header.
+ */
+static bool haveStreamDigest(const DexStreamDigest* pDigest,
+    const DexFile* pDexFile, size_t length, int what)
+{
+    return pDigest != NULL && pDigest->done && (pDigest->flags & what) &&
+        pDexFile->pOptHeader == NULL && pDigest->length == length &&
+        pDexFile->pHeader->fileSize == length;
+}
+
 /*
  * Parse an optimized or unoptimized .dex file sitting in memory.  This is
  * called after the byte-ordering and structure alignment has been fixed up.
@@ -694,6 +798,15 @@ static bool parseAuxData(const u1* data, DexFile* pDexFile)
  * On success, return a newly-allocated DexFile.
  */
 DexFile* dexFileParse(const u1* data, size_t length, int flags)
+{
+    return dexFileParseWithDigest(data, length, flags, NULL);
+}
+
+/*
+ * Parse a .dex file, using checksums computed earlier when we can.
+ */
+DexFile* dexFileParseWithDigest(const u1* data, size_t length, int flags,
+    const DexStreamDigest* pDigest)
 {
     DexFile* pDexFile = NULL;
     const DexHeader* pHeader;
@@ -762,7 +875,12 @@ DexFile* dexFileParse(const u1* data, size_t length, int flags)
      * byte-swapping and DEX optimization.
      */
     if (flags & kDexParseVerifyChecksum) {
-        u4 adler = dexComputeChecksum(pHeader);
+        u4 adler;
+        if (haveStreamDigest(pDigest, pDexFile, length,
+                kDexParseVerifyChecksum))
+            adler = pDigest->checksum;
+        else
+            adler = dexComputeChecksum(pHeader);
         if (adler != pHeader->checksum) {
             LOGE("ERROR: bad checksum (%08x vs %08x)\n",
                 adler, pHeader->checksum);
@@ -790,14 +908,18 @@ DexFile* dexFileParse(const u1* data, size_t length, int flags)
      * Verify the SHA-1 digest.  (Normally we don't want to do this --
      * the digest is used to uniquely identify the original DEX file, and
      * can't be computed for verification after the DEX is byte-swapped
-     * and optimized.)
+     * and optimized.)  Callers that have the original file can ask for it.
      */
-    if (kVerifySignature) {
+    if (kVerifySignature || (flags & kDexParseVerifySignature)) {
         unsigned char sha1Digest[kSHA1DigestLen];
         const int nonSum = sizeof(pHeader->magic) + sizeof(pHeader->checksum) +
                             kSHA1DigestLen;
 
-        dexComputeSHA1Digest(data + nonSum, length - nonSum, sha1Digest);
+        if (haveStreamDigest(pDigest, pDexFile, length,
+                kDexParseVerifySignature))
+            memcpy(sha1Digest, pDigest->signature, kSHA1DigestLen);
+        else
+            dexComputeSHA1Digest(data + nonSum, length - nonSum, sha1Digest);
         if (memcmp(sha1Digest, pHeader->signature, kSHA1DigestLen) != 0) {
             char tmpBuf1[kSHA1DigestOutputLen];
             char tmpBuf2[kSHA1DigestOutputLen];
@@ -846,27 +968,69 @@ void dexFileFree(DexFile* pDexFile)
     if (pDexFile == NULL)
         return;
 
+    dexFreeMemberCache(pDexFile->pMemberCache);
+    free(pDexFile->pLocalClassLookup);
     free(pDexFile);
 }
 
+/*
+ * Get the class lookup table we built for a DexFile, building it if this
+ * is the first time through.  Several threads may get here at once; one
+ * table wins and the others are thrown away.
+ */
+static const DexClassLookup* getLocalClassLookup(DexFile* pDexFile)
+{
+    DexClassLookup* pLookup;
+    DexClassLookup* pExpected = NULL;
+
+    pLookup = __atomic_load_n(&pDexFile->pLocalClassLookup, __ATOMIC_ACQUIRE);
+    if (pLookup != NULL)
+        return pLookup;
+
+    pLookup = dexCreateClassLookup(pDexFile);
+    if (pLookup == NULL)
+        return NULL;
+
+    if (!__atomic_compare_exchange_n(&pDexFile->pLocalClassLookup,
+            &pExpected, pLookup, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        free(pLookup);
+        pLookup = pExpected;
+    }
+    return pLookup;
+}
+
 /*
  * Look up a class definition entry by descriptor.
  *
  * "descriptor" should look like "Landroid/debug/Stuff;".
  */
-const DexClassDef* dexFindClass(const DexFile* pDexFile,
-    const char* descriptor)
+const DexClassDef* dexFindClass(DexFile* pDexFile, const char* descriptor)
 {
     const DexClassLookup* pLookup = pDexFile->pClassLookup;
+    bool robinHood = false;
     u4 hash;
-    int idx, mask;
+    int idx, mask, dist;
+
+    if (pLookup == NULL) {
+        if (pDexFile->pHeader->classDefsSize == 0)
+            return NULL;
+        pLookup = getLocalClassLookup(pDexFile);
+        if (pLookup == NULL)
+            return NULL;
+        robinHood = true;
+    }
 
     hash = classDescriptorHash(descriptor);
     mask = pLookup->numEntries - 1;
     idx = hash & mask;
+    dist = 0;
 
     /*
-     * Search until we find a matching entry or an empty slot.
+     * Search until we find a matching entry or an empty slot.  If we built
+     * the table, we know it was filled Robin Hood style, so we can also
+     * stop at an entry that's closer to home than we are: ours would
+     * have displaced it.
      */
     while (true) {
         int offset;
@@ -885,22 +1049,26 @@ const DexClassDef* dexFindClass(const DexFile* pDexFile,
             }
         }
 
+        if (robinHood && classLookupDistance(pLookup, idx) < dist)
+            return NULL;
+
         idx = (idx + 1) & mask;
+        dist++;
     }
 }
 
 
 /*
- * Compute the DEX file checksum for a memory-mapped DEX file.
+ * Compute the DEX file checksum for a memory-mapped DEX file.  Big files
+ * are split across the CPUs.
  */
 u4 dexComputeChecksum(const DexHeader* pHeader)
 {
     const u1* start = (const u1*) pHeader;
-
-    uLong adler = adler32(0L, Z_NULL, 0);
     const int nonSum = sizeof(pHeader->magic) + sizeof(pHeader->checksum);
 
-    return (u4) adler32(adler, start + nonSum, pHeader->fileSize - nonSum);
+    return dexAdler32Parallel(kAdler32Init, start + nonSum,
+        pHeader->fileSize - nonSum, sysGetCpuCount());
 }
 
 /*
@@ -912,9 +1080,7 @@ static u4 dexComputeOptChecksum(const DexOptHeader* pOptHeader)
     const u1* end = (const u1*) pOptHeader +
         pOptHeader->auxOffset + pOptHeader->auxLength;
 
-    uLong adler = adler32(0L, Z_NULL, 0);
-
-    return (u4) adler32(adler, start, end - start);
+    return dexAdler32(kAdler32Init, start, end - start);
 }
 
 
@@ -1029,6 +1195,44 @@ static const char* readStringIdx(const DexFile* pDexFile,
     }
 }
 
+/*
+ * The parameter names at the start of a debug info stream, decoded a
+ * batch at a time.  The batches are kept small so the decoder never gets
+ * far ahead of the caller's checks on the parameters.
+ */
+#define kDebugNameBatch 16
+
+typedef struct DebugNameReader {
+    u4          remaining;      /* names not decoded yet */
+    u4          next;           /* next name to hand out */
+    u4          count;          /* names in "names" */
+    u4          names[kDebugNameBatch];
+} DebugNameReader;
+
+static void debugNameReaderInit(DebugNameReader* pReader,
+        u4 parametersSize) {
+    pReader->remaining = parametersSize;
+    pReader->next = pReader->count = 0;
+}
+
+/*
+ * Reads the next parameter name, as a string index plus one (0 for no
+ * name).
+ */
+static u4 readDebugName(DebugNameReader* pReader, const u1** pStream) {
+    if (pReader->next == pReader->count) {
+        u4 count = (pReader->remaining < kDebugNameBatch) ?
+                pReader->remaining : kDebugNameBatch;
+
+        readUnsignedLeb128Array(pStream, pReader->names, count);
+        pReader->remaining -= count;
+        pReader->count = count;
+        pReader->next = 0;
+    }
+
+    return pReader->names[pReader->next++];
+}
+
 /*
  * Reads a type index as encoded for the debug info format, returning
  * a string pointer for its descriptor or NULL as appropriate.
@@ -1068,7 +1272,149 @@ static void emitLocalCbIfLive (void *cnxt, int reg, u4 endAddress,
     }
 }
 
-// TODO optimize localCb == NULL case
+static void logInvalidDebugInfo(const char* classDescriptor,
+        const DexProto* pProto)
+{
+    char* methodDescriptor = dexProtoCopyMethodDescriptor(pProto);
+    LOGE("Invalid debug info stream. class %s; proto %s",
+            classDescriptor, methodDescriptor);
+    free(methodDescriptor);
+}
+
+/*
+ * Positions-only version of dexDecodeDebugInfo(), used when there's no
+ * locals callback.
+ *
+ * The local variable entries still have to be parsed to get past them,
+ * but we don't look up any of their strings or track their live ranges.
+ * All we remember is which registers have had a named, typed local, since
+ * a DBG_RESTART_LOCAL on any other register makes the stream invalid.
+ */
+static void decodeDebugPositions(
+            const DexFile* pDexFile,
+            const DexCode* pCode,
+            const char* classDescriptor,
+            u4 protoIdx,
+            u4 accessFlags,
+            DexDebugNewPositionCb posCb,
+            void* cnxt)
+{
+    const u1 *stream = dexGetDebugInfoStream(pDexFile, pCode);
+    u4 line;
+    u4 parametersSize;
+    u4 address = 0;
+    /* one extra, since the register checks below allow registersSize */
+    bool hasLocal[pCode->registersSize + 1];
+    DexProto proto = { pDexFile, protoIdx };
+
+    if (stream == NULL)
+        return;
+
+    memset(hasLocal, 0, sizeof(hasLocal));
+
+    line = readUnsignedLeb128(&stream);
+    parametersSize = readUnsignedLeb128(&stream);
+
+    u2 argReg = pCode->registersSize - pCode->insSize;
+
+    if ((accessFlags & ACC_STATIC) == 0) {
+        assert(pCode->insSize == (dexProtoComputeArgsSize(&proto) + 1));
+        hasLocal[argReg] = true;            /* "this" */
+        argReg++;
+    } else {
+        assert(pCode->insSize == dexProtoComputeArgsSize(&proto));
+    }
+
+    DexParameterIterator iterator;
+    DebugNameReader nameReader;
+    dexParameterIteratorInit(&iterator, &proto);
+    debugNameReaderInit(&nameReader, parametersSize);
+
+    while (parametersSize-- != 0) {
+        const char* descriptor = dexParameterIteratorNextDescriptor(&iterator);
+        int reg;
+
+        if ((argReg >= pCode->registersSize) || (descriptor == NULL)) {
+            goto invalid_stream;
+        }
+
+        reg = argReg;
+        if (descriptor[0] == 'D' || descriptor[0] == 'J')
+            argReg += 2;
+        else
+            argReg += 1;
+
+        /* encoded string indices have 1 added to them */
+        if (readDebugName(&nameReader, &stream) != 0)
+            hasLocal[reg] = true;
+    }
+
+    for (;;)  {
+        u1 opcode = *stream++;
+        u2 reg;
+
+        switch (opcode) {
+            case DBG_END_SEQUENCE:
+                return;
+
+            case DBG_ADVANCE_PC:
+                address += readUnsignedLeb128(&stream);
+                break;
+
+            case DBG_ADVANCE_LINE:
+                line += readSignedLeb128(&stream);
+                break;
+
+            case DBG_START_LOCAL:
+            case DBG_START_LOCAL_EXTENDED: {
+                u4 nameIdx, typeIdx;
+
+                reg = readUnsignedLeb128(&stream);
+                if (reg > pCode->registersSize) goto invalid_stream;
+
+                nameIdx = readUnsignedLeb128(&stream);
+                typeIdx = readUnsignedLeb128(&stream);
+                if (opcode == DBG_START_LOCAL_EXTENDED)
+                    (void) readUnsignedLeb128(&stream);
+                hasLocal[reg] = (nameIdx != 0 && typeIdx != 0);
+                break;
+            }
+
+            case DBG_END_LOCAL:
+                reg = readUnsignedLeb128(&stream);
+                if (reg > pCode->registersSize) goto invalid_stream;
+                break;
+
+            case DBG_RESTART_LOCAL:
+                reg = readUnsignedLeb128(&stream);
+                if (reg > pCode->registersSize) goto invalid_stream;
+                if (!hasLocal[reg]) goto invalid_stream;
+                break;
+
+            case DBG_SET_PROLOGUE_END:
+            case DBG_SET_EPILOGUE_BEGIN:
+            case DBG_SET_FILE:
+                break;
+
+            default: {
+                int adjopcode = opcode - DBG_FIRST_SPECIAL;
+
+                address += adjopcode / DBG_LINE_RANGE;
+                line += DBG_LINE_BASE + (adjopcode % DBG_LINE_RANGE);
+
+                if (posCb != NULL && posCb(cnxt, address, line)) {
+                    // early exit
+                    return;
+                }
+                break;
+            }
+        }
+    }
+
+invalid_stream:
+    logInvalidDebugInfo(classDescriptor, &proto);
+}
+
 void dexDecodeDebugInfo(
             const DexFile* pDexFile,
             const DexCode* pCode,
@@ -1078,6 +1424,12 @@ void dexDecodeDebugInfo(
             DexDebugNewPositionCb posCb, DexDebugNewLocalCb localCb,
             void* cnxt)
 {
+    if (localCb == NULL) {
+        decodeDebugPositions(pDexFile, pCode, classDescriptor, protoIdx,
+            accessFlags, posCb, cnxt);
+        return;
+    }
+
     const u1 *stream = dexGetDebugInfoStream(pDexFile, pCode);
     u4 line;
     u4 parametersSize;
@@ -1115,18 +1467,23 @@ void dexDecodeDebugInfo(
     }
     
     DexParameterIterator iterator;
+    DebugNameReader nameReader;
     dexParameterIteratorInit(&iterator, &proto);
+    debugNameReaderInit(&nameReader, parametersSize);
 
     while (parametersSize-- != 0) {
         const char* descriptor = dexParameterIteratorNextDescriptor(&iterator);
         const char *name;
+        u4 nameIdx;
         int reg;
         
         if ((argReg >= pCode->registersSize) || (descriptor == NULL)) {
             goto invalid_stream;
         }
 
-        name = readStringIdx(pDexFile, &stream);
+        // Remember, encoded string indicies have 1 added to them.
+        nameIdx = readDebugName(&nameReader, &stream);
+        name = (nameIdx == 0) ? NULL : dexStringById(pDexFile, nameIdx - 1);
         reg = argReg;
 
         switch (descriptor[0]) {
@@ -1247,12 +1604,6 @@ end:
     return;
 
 invalid_stream:
-	{
-//    IF_LOGE() {
-        char* methodDescriptor = dexProtoCopyMethodDescriptor(&proto);
-        LOGE("Invalid debug info stream. class %s; proto %s",
-                classDescriptor, methodDescriptor);
-        free(methodDescriptor);
-    }
+    logInvalidDebugInfo(classDescriptor, &proto);
 }
 
@@ -33,6 +33,7 @@
 
 #include "vm/Common.h"      // basic type defs, e.g. u1/u2/u4/u8, and LOG
 #include "libdex/SysUtil.h"
+#include "libdex/sha1.h"
 
 /*
  * gcc-style inline management -- ensures we have a copy of all functions
@@ -430,6 +431,11 @@ typedef struct DexEncodedArray {
  * don't need the same hash table in every VM.  This is slightly slower than
  * a hash table with direct pointers to the items, but because it's shared
  * there's less of a penalty for using a fairly sparse table.
+ *
+ * Entries are placed with Robin Hood linear probing, which keeps probe
+ * sequences short and lets a lookup give up early.  A lookup that just
+ * scans to the next empty slot still works, so older tables (which were
+ * built with plain linear probing) and newer ones are interchangeable.
  */
 typedef struct DexClassLookup {
     int     size;                       // total size, including "size"
@@ -530,8 +536,11 @@ typedef struct DexFile {
     /* track memory overhead for auxillary structures */
     int                 overhead;
 
-    /* additional app-specific data structures associated with the DEX */
-    //void*               auxData;
+    /* resolved method/field strings; see DexMemberCache.h */
+    struct DexMemberCache* pMemberCache;
+
+    /* class lookup built by dexFindClass() when the file doesn't have one */
+    DexClassLookup*     pLocalClassLookup;
 } DexFile;
 
 /*
@@ -546,11 +555,43 @@ u4 dexRoundUpPower2(u4 val);
  */
 DexFile* dexFileParse(const u1* data, size_t length, int flags);
 
+/*
+ * Checksums of a DEX file computed as it was being produced (e.g. by the
+ * inflater), a block at a time while each block was still in cache.
+ */
+typedef struct DexStreamDigest {
+    int         flags;      /* what to compute: kDexParseVerifyChecksum and
+                               kDexParseVerifySignature */
+    bool        done;       /* set by dexStreamDigestFinish() */
+    size_t      length;     /* number of bytes seen */
+    u4          checksum;   /* adler32, as in the header */
+    u1          signature[kSHA1DigestLen];
+    SHA1_CTX    sha1Ctx;
+} DexStreamDigest;
+
+/*
+ * Start, continue and finish a digest of a plain (unoptimized) DEX file.
+ * The data is passed in order, in pieces of any size.
+ */
+void dexStreamDigestInit(DexStreamDigest* pDigest, int flags);
+void dexStreamDigestUpdate(DexStreamDigest* pDigest, const u1* data,
+    size_t len);
+void dexStreamDigestFinish(DexStreamDigest* pDigest);
+
+/*
+ * Like dexFileParse(), but use the checksum and signature in "pDigest",
+ * if it's non-NULL and was finished over exactly this data, rather than
+ * reading the whole file again to compute them.
+ */
+DexFile* dexFileParseWithDigest(const u1* data, size_t length, int flags,
+    const DexStreamDigest* pDigest);
+
 /* bit values for "flags" argument to dexFileParse */
 enum {
     kDexParseDefault            = 0,
     kDexParseVerifyChecksum     = 1,
     kDexParseContinueOnError    = (1 << 1),
+    kDexParseVerifySignature    = (1 << 2),
 };
 
 /*
@@ -561,6 +602,44 @@ enum {
  */
 int dexFixByteOrdering(u1* addr, int len);
 
+/* at most one map section of each kDexType* */
+#define kDexMaxMapSections  18
+
+/*
+ * Time spent verifying one map section, in nanoseconds.
+ */
+typedef struct DexSectionTiming {
+    u2  type;               /* kDexType* */
+    u4  size;               /* number of items */
+    u8  intraNsec;          /* checking items on their own */
+    u8  crossNsec;          /* checking references between items */
+} DexSectionTiming;
+
+typedef struct DexVerifyTimings {
+    u8  totalNsec;
+    u8  checksumNsec;
+    u4  numSections;        /* in map order */
+    DexSectionTiming sections[kDexMaxMapSections];
+} DexVerifyTimings;
+
+/*
+ * Do the same checks as dexFixByteOrdering() on a DEX file that's already
+ * in host byte order, without writing to it, so it can be used on a
+ * read-only mapping.  This is only possible on a little-endian host;
+ * elsewhere it fails.
+ *
+ * If "numThreads" is more than 1, sections are split into chunks that are
+ * verified in parallel.
+ *
+ * If "pTimings" is non-NULL, the time spent on each section is recorded
+ * there.  In a parallel run the section times are summed over the
+ * threads, so they can add up to more than the total.
+ *
+ * Return 0 on success.
+ */
+int dexVerifyReadOnly(const u1* addr, int len, int numThreads,
+    DexVerifyTimings* pTimings);
+
 /*
  * Compute DEX checksum.
  */
@@ -577,9 +656,11 @@ void dexFileFree(DexFile* pDexFile);
 DexClassLookup* dexCreateClassLookup(DexFile* pDexFile);
 
 /*
- * Find a class definition by descriptor.
+ * Find a class definition by descriptor.  If the file doesn't come with a
+ * class lookup table (i.e. it isn't optimized), one is built on the first
+ * call.
  */
-const DexClassDef* dexFindClass(const DexFile* pFile, const char* descriptor);
+const DexClassDef* dexFindClass(DexFile* pFile, const char* descriptor);
 
 /*
  * Set up the basic raw data pointers of a DexFile. This function isn't
@@ -787,6 +868,9 @@ typedef void (*DexDebugNewLocalCb)(void *cnxt, u2 reg, u4 startAddress,
  * 
  * posCb is called in ascending address order.
  * localCb is called in order of ascending end address.
+ *
+ * Both callbacks may be used in a single pass.  If localCb is NULL, a
+ * cheaper decoder that doesn't track local variables is used.
  */
 void dexDecodeDebugInfo(
             const DexFile* pDexFile,
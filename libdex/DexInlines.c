@@ -24,6 +24,8 @@
 #include "DexCatch.h"
 #include "DexClass.h"
 #include "DexDataMap.h"
+#include "DexMetaIndex.h"
+#include "DexMethodIndex.h"
 #include "DexProto.h"
 #include "InstrUtils.h"
 #include "Leb128.h"
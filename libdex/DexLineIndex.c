@@ -0,0 +1,462 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Pre-decoded line number tables.
+ */
+#include "DexLineIndex.h"
+#include "DexClass.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+
+/*
+ * Growable arrays used while building an index.
+ */
+typedef struct LineIndexBuilder {
+    DexLineMethod*      methods;
+    u4                  numMethods;
+    u4                  maxMethods;
+    DexLinePosition*    positions;
+    u4                  numPositions;
+    u4                  maxPositions;
+    bool                failed;
+} LineIndexBuilder;
+
+/*
+ * Make room for one more element in a growable array.
+ */
+static bool growArray(void** pArray, u4 count, u4* pMax, size_t elemSize)
+{
+    if (count < *pMax)
+        return true;
+
+    u4 newMax = (*pMax == 0) ? 256 : *pMax * 2;
+    void* newArray = realloc(*pArray, newMax * elemSize);
+    if (newArray == NULL)
+        return false;
+    *pArray = newArray;
+    *pMax = newMax;
+    return true;
+}
+
+/*
+ * Debug info callback: append a position to the current method.
+ */
+static int addPositionCb(void* cnxt, u4 address, u4 lineNum)
+{
+    LineIndexBuilder* pBuilder = (LineIndexBuilder*) cnxt;
+
+    if (!growArray((void**) &pBuilder->positions, pBuilder->numPositions,
+            &pBuilder->maxPositions, sizeof(DexLinePosition)))
+    {
+        pBuilder->failed = true;
+        return 1;
+    }
+
+    DexLinePosition* pPos = &pBuilder->positions[pBuilder->numPositions++];
+    pPos->address = address;
+    pPos->line = lineNum;
+    return 0;
+}
+
+/*
+ * Decode the positions of one method and add them to the index.
+ */
+static void addMethod(LineIndexBuilder* pBuilder, const DexFile* pDexFile,
+    u4 dexIdx, const DexMethod* pDexMethod)
+{
+    const DexCode* pCode = dexGetCode(pDexFile, pDexMethod);
+    if (pCode == NULL)
+        return;
+
+    const DexMethodId* pMethodId =
+        dexGetMethodId(pDexFile, pDexMethod->methodIdx);
+    const char* classDescriptor =
+        dexStringByTypeIdx(pDexFile, pMethodId->classIdx);
+    u4 firstPosition = pBuilder->numPositions;
+
+    dexDecodeDebugInfo(pDexFile, pCode, classDescriptor, pMethodId->protoIdx,
+        pDexMethod->accessFlags, addPositionCb, NULL, pBuilder);
+    if (pBuilder->failed || pBuilder->numPositions == firstPosition)
+        return;
+
+    if (!growArray((void**) &pBuilder->methods, pBuilder->numMethods,
+            &pBuilder->maxMethods, sizeof(DexLineMethod)))
+    {
+        pBuilder->failed = true;
+        return;
+    }
+
+    DexLineMethod* pMethod = &pBuilder->methods[pBuilder->numMethods++];
+    pMethod->dexIdx = dexIdx;
+    pMethod->methodIdx = pDexMethod->methodIdx;
+    pMethod->firstPosition = firstPosition;
+    pMethod->numPositions = pBuilder->numPositions - firstPosition;
+}
+
+/*
+ * Add every method of every class in "pDexFile".
+ */
+static void addDexFile(LineIndexBuilder* pBuilder, const DexFile* pDexFile,
+    u4 dexIdx)
+{
+    u4 classIdx;
+
+    for (classIdx = 0; classIdx < pDexFile->pHeader->classDefsSize;
+        classIdx++)
+    {
+        const DexClassDef* pClassDef = dexGetClassDef(pDexFile, classIdx);
+        const u1* pData = dexGetClassData(pDexFile, pClassDef);
+        DexClassDataHeader header;
+        DexField field;
+        DexMethod method;
+        u4 lastIndex;
+        u4 i;
+
+        if (pData == NULL)
+            continue;
+
+        dexReadClassDataHeader(&pData, &header);
+
+        lastIndex = 0;
+        for (i = 0; i < header.staticFieldsSize; i++)
+            dexReadClassDataField(&pData, &field, &lastIndex);
+        lastIndex = 0;
+        for (i = 0; i < header.instanceFieldsSize; i++)
+            dexReadClassDataField(&pData, &field, &lastIndex);
+
+        lastIndex = 0;
+        for (i = 0; i < header.directMethodsSize; i++) {
+            dexReadClassDataMethod(&pData, &method, &lastIndex);
+            addMethod(pBuilder, pDexFile, dexIdx, &method);
+        }
+        lastIndex = 0;
+        for (i = 0; i < header.virtualMethodsSize; i++) {
+            dexReadClassDataMethod(&pData, &method, &lastIndex);
+            addMethod(pBuilder, pDexFile, dexIdx, &method);
+        }
+
+        if (pBuilder->failed)
+            return;
+    }
+}
+
+/*
+ * qsort() comparator for DexLineMethod, by DEX file and then method index.
+ */
+static int compareMethods(const void* vpLhs, const void* vpRhs)
+{
+    const DexLineMethod* pLhs = (const DexLineMethod*) vpLhs;
+    const DexLineMethod* pRhs = (const DexLineMethod*) vpRhs;
+
+    if (pLhs->dexIdx != pRhs->dexIdx)
+        return (pLhs->dexIdx < pRhs->dexIdx) ? -1 : 1;
+    if (pLhs->methodIdx != pRhs->methodIdx)
+        return (pLhs->methodIdx < pRhs->methodIdx) ? -1 : 1;
+    return 0;
+}
+
+/*
+ * Point the fields of "pIndex" at the sections in its mapping.
+ */
+static void setSections(DexLineIndex* pIndex)
+{
+    const u1* base = (const u1*) pIndex->map.addr;
+
+    pIndex->pHeader = (const DexLineIndexHeader*) base;
+    pIndex->dexChecksums = (const u4*) (base + sizeof(DexLineIndexHeader));
+    pIndex->methods = (const DexLineMethod*)
+        (pIndex->dexChecksums + pIndex->pHeader->numDex);
+    pIndex->positions = (const DexLinePosition*)
+        (pIndex->methods + pIndex->pHeader->numMethods);
+}
+
+/*
+ * Compute the size of an index with the given counts.  Returns 0 if it
+ * would be too large.
+ */
+static size_t computeIndexSize(u4 numDex, u4 numMethods, u4 numPositions)
+{
+    u8 size = sizeof(DexLineIndexHeader) + (u8) numDex * sizeof(u4) +
+        (u8) numMethods * sizeof(DexLineMethod) +
+        (u8) numPositions * sizeof(DexLinePosition);
+
+    if (size != (size_t) size || size > 0x7fffffff)
+        return 0;
+    return (size_t) size;
+}
+
+/*
+ * Build an index covering every method with code in "pDexFiles".
+ */
+DexLineIndex* dexLineIndexCreate(DexFile* const* pDexFiles, int numDex)
+{
+    LineIndexBuilder builder;
+    DexLineIndex* pIndex = NULL;
+    size_t size;
+    int i;
+
+    memset(&builder, 0, sizeof(builder));
+
+    for (i = 0; i < numDex && !builder.failed; i++)
+        addDexFile(&builder, pDexFiles[i], i);
+    if (builder.failed) {
+        LOGE("Out of memory building line number index\n");
+        goto bail;
+    }
+
+    qsort(builder.methods, builder.numMethods, sizeof(DexLineMethod),
+        compareMethods);
+
+    size = computeIndexSize(numDex, builder.numMethods, builder.numPositions);
+    if (size == 0)
+        goto bail;
+
+    pIndex = (DexLineIndex*) calloc(1, sizeof(DexLineIndex));
+    if (pIndex == NULL)
+        goto bail;
+    if (sysCreatePrivateMap(size, &pIndex->map) != 0) {
+        free(pIndex);
+        pIndex = NULL;
+        goto bail;
+    }
+
+    u1* ptr = (u1*) pIndex->map.addr;
+    DexLineIndexHeader* pHeader = (DexLineIndexHeader*) ptr;
+    memset(pHeader, 0, sizeof(*pHeader));
+    memcpy(pHeader->magic, DEX_LINE_INDEX_MAGIC, sizeof(pHeader->magic));
+    pHeader->numDex = numDex;
+    pHeader->numMethods = builder.numMethods;
+    pHeader->numPositions = builder.numPositions;
+    ptr += sizeof(*pHeader);
+
+    for (i = 0; i < numDex; i++) {
+        u4 checksum = pDexFiles[i]->pHeader->checksum;
+        memcpy(ptr, &checksum, sizeof(u4));
+        ptr += sizeof(u4);
+    }
+    memcpy(ptr, builder.methods, builder.numMethods * sizeof(DexLineMethod));
+    ptr += builder.numMethods * sizeof(DexLineMethod);
+    memcpy(ptr, builder.positions,
+        builder.numPositions * sizeof(DexLinePosition));
+
+    setSections(pIndex);
+
+bail:
+    free(builder.methods);
+    free(builder.positions);
+    return pIndex;
+}
+
+/*
+ * Write an index.  It goes to a temporary file that is then renamed
+ * into place, so a process mapping the old index never sees a partly
+ * written one.
+ */
+int dexLineIndexWrite(const DexLineIndex* pIndex, const char* fileName)
+{
+    const u1* data = (const u1*) pIndex->map.addr;
+    size_t len = pIndex->map.length;
+    char* tmpName;
+    int result = -1;
+    int fd;
+
+    tmpName = (char*) malloc(strlen(fileName) + 32);
+    if (tmpName == NULL)
+        return -1;
+    sprintf(tmpName, "%s.%d.tmp", fileName, (int) getpid());
+
+    fd = open(tmpName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to create line index '%s': %s\n",
+            tmpName, strerror(errno));
+        free(tmpName);
+        return -1;
+    }
+
+    while (len > 0) {
+        ssize_t actual = write(fd, data, len);
+        if (actual < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "Write to line index '%s' failed: %s\n",
+                tmpName, strerror(errno));
+            goto bail;
+        }
+        data += actual;
+        len -= actual;
+    }
+
+    result = 0;
+
+bail:
+    if (close(fd) != 0 && result == 0) {
+        fprintf(stderr, "Close of line index '%s' failed: %s\n",
+            tmpName, strerror(errno));
+        result = -1;
+    }
+    if (result == 0 && rename(tmpName, fileName) != 0) {
+        fprintf(stderr, "Unable to rename '%s' to '%s': %s\n",
+            tmpName, fileName, strerror(errno));
+        result = -1;
+    }
+    if (result != 0)
+        unlink(tmpName);
+    free(tmpName);
+    return result;
+}
+
+/*
+ * Map an index previously written with dexLineIndexWrite().
+ */
+DexLineIndex* dexLineIndexOpen(const char* fileName)
+{
+    DexLineIndex* pIndex = NULL;
+    const DexLineIndexHeader* pHeader;
+    int fd;
+
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to open line index '%s': %s\n",
+            fileName, strerror(errno));
+        return NULL;
+    }
+
+    pIndex = (DexLineIndex*) calloc(1, sizeof(DexLineIndex));
+    if (pIndex == NULL)
+        goto bail;
+
+    if (sysMapFileInShmemReadOnly(fd, &pIndex->map) != 0) {
+        fprintf(stderr, "Unable to map line index '%s'\n", fileName);
+        free(pIndex);
+        pIndex = NULL;
+        goto bail;
+    }
+
+    pHeader = (const DexLineIndexHeader*) pIndex->map.addr;
+    if (pIndex->map.length < sizeof(DexLineIndexHeader) ||
+        memcmp(pHeader->magic, DEX_LINE_INDEX_MAGIC,
+            sizeof(pHeader->magic)) != 0 ||
+        computeIndexSize(pHeader->numDex, pHeader->numMethods,
+            pHeader->numPositions) != pIndex->map.length)
+    {
+        fprintf(stderr, "'%s' is not a valid line index\n", fileName);
+        dexLineIndexFree(pIndex);
+        pIndex = NULL;
+        goto bail;
+    }
+
+    setSections(pIndex);
+
+bail:
+    close(fd);
+    return pIndex;
+}
+
+/*
+ * Free an index.
+ */
+void dexLineIndexFree(DexLineIndex* pIndex)
+{
+    if (pIndex == NULL)
+        return;
+    sysReleaseShmem(&pIndex->map);
+    free(pIndex);
+}
+
+/*
+ * Check the index against the checksums of a set of DEX files.
+ */
+bool dexLineIndexMatches(const DexLineIndex* pIndex, const u4* dexChecksums,
+    u4 numDex)
+{
+    u4 i;
+
+    if (pIndex->pHeader->numDex != numDex)
+        return false;
+    for (i = 0; i < numDex; i++) {
+        if (pIndex->dexChecksums[i] != dexChecksums[i])
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Find the source line for "address" in a method.
+ *
+ * Both searches are binary searches.  A method's positions can repeat an
+ * address (several lines mapped to one instruction); like the VM, we use
+ * the last of them.
+ */
+int dexLineIndexLookup(const DexLineIndex* pIndex, u4 dexIdx, u4 methodIdx,
+    u4 address)
+{
+    const DexLineMethod* pMethod = NULL;
+    int lo, hi;
+
+    lo = 0;
+    hi = (int) pIndex->pHeader->numMethods - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) >> 1;
+        const DexLineMethod* pMid = &pIndex->methods[mid];
+
+        if (pMid->dexIdx < dexIdx ||
+            (pMid->dexIdx == dexIdx && pMid->methodIdx < methodIdx))
+        {
+            lo = mid + 1;
+        } else if (pMid->dexIdx == dexIdx && pMid->methodIdx == methodIdx) {
+            pMethod = pMid;
+            break;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    if (pMethod == NULL)
+        return -1;
+
+    /* a mapped file could be corrupt */
+    if (pMethod->firstPosition > pIndex->pHeader->numPositions ||
+        pMethod->numPositions >
+            pIndex->pHeader->numPositions - pMethod->firstPosition)
+    {
+        return -1;
+    }
+
+    /* find the first position past "address" */
+    const DexLinePosition* positions =
+        &pIndex->positions[pMethod->firstPosition];
+    u4 first = 0;
+    u4 count = pMethod->numPositions;
+
+    while (count > 0) {
+        u4 step = count / 2;
+
+        if (positions[first + step].address <= address) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+
+    if (first == 0)
+        return -1;
+    return (int) positions[first - 1].line;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Pre-decoded line number tables, for mapping (method, address) pairs to
+ * source lines without replaying the debug info state machine.
+ *
+ * The index has the same layout in memory and on disk, so a saved index
+ * can be mapped and used as-is:
+ *
+ *   DexLineIndexHeader
+ *   u4                 dexChecksums[numDex]
+ *   DexLineMethod      methods[numMethods]     (by dexIdx, then methodIdx)
+ *   DexLinePosition    positions[numPositions] (by address, per method)
+ *
+ * The checksums of the DEX files it was built from are kept so a caller
+ * that has the files can tell whether the index is out of date.
+ *
+ * Everything is stored in host byte order.
+ */
+#ifndef _LIBDEX_DEXLINEINDEX
+#define _LIBDEX_DEXLINEINDEX
+
+#include "DexFile.h"
+#include "SysUtil.h"
+
+#define DEX_LINE_INDEX_MAGIC    "dxli001"
+
+typedef struct DexLineIndexHeader {
+    u1  magic[8];           /* includes version number */
+    u4  numDex;
+    u4  numMethods;
+    u4  numPositions;
+} DexLineIndexHeader;
+
+/* the positions table for one method */
+typedef struct DexLineMethod {
+    u4  dexIdx;             /* which DEX file, counting from 0 */
+    u4  methodIdx;
+    u4  firstPosition;      /* index into the positions array */
+    u4  numPositions;
+} DexLineMethod;
+
+typedef struct DexLinePosition {
+    u4  address;            /* in 16-bit code units */
+    u4  line;
+} DexLinePosition;
+
+/*
+ * An index, either built in memory or mapped from a file.
+ */
+typedef struct DexLineIndex {
+    MemMapping              map;
+    const DexLineIndexHeader* pHeader;
+    const u4*               dexChecksums;
+    const DexLineMethod*    methods;
+    const DexLinePosition*  positions;
+} DexLineIndex;
+
+/*
+ * Build an index covering every method with code in "pDexFiles".
+ *
+ * Returns NULL on failure.
+ */
+DexLineIndex* dexLineIndexCreate(DexFile* const* pDexFiles, int numDex);
+
+/*
+ * Write an index to "fileName".  The data goes to a temporary file that
+ * is renamed into place, so a reader never sees a partial index.
+ *
+ * Returns 0 on success.
+ */
+int dexLineIndexWrite(const DexLineIndex* pIndex, const char* fileName);
+
+/*
+ * Map an index previously written with dexLineIndexWrite().
+ *
+ * Returns NULL if the file can't be mapped or isn't a valid index.
+ */
+DexLineIndex* dexLineIndexOpen(const char* fileName);
+
+/*
+ * Free an index from dexLineIndexCreate() or dexLineIndexOpen().
+ */
+void dexLineIndexFree(DexLineIndex* pIndex);
+
+/*
+ * Check that the index was built from "numDex" DEX files with the given
+ * checksums, in order.
+ */
+bool dexLineIndexMatches(const DexLineIndex* pIndex, const u4* dexChecksums,
+    u4 numDex);
+
+/*
+ * Find the source line for "address" in a method.  This is the line of
+ * the last position entry at or before the address.
+ *
+ * Returns -1 if the method isn't in the index or the address comes
+ * before its first position entry.
+ */
+int dexLineIndexLookup(const DexLineIndex* pIndex, u4 dexIdx, u4 methodIdx,
+    u4 address);
+
+#endif /*_LIBDEX_DEXLINEINDEX*/
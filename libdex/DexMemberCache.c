@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Method/field string cache.
+ *
+ * An entry is filled in under the lock, and "classDescriptor" is stored
+ * last with release semantics; a reader that sees it non-NULL (with an
+ * acquire load) can use the rest of the entry without locking.
+ */
+#include "DexMemberCache.h"
+#include "DexArena.h"
+#include "DexMetaIndex.h"
+#include "DexProto.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* the signatures of a typical DEX file fit in a few chunks */
+#define kArenaChunkSize     (16 * 1024)
+
+struct DexMemberCache {
+    pthread_mutex_t lock;
+    DexArena        arena;          /* signatures and type names */
+    DexMemberInfo*  methods;        /* [methodIdsSize] */
+    DexMemberInfo*  fields;         /* [fieldIdsSize] */
+    const char**    protoDescriptors;   /* [protoIdsSize] */
+    DexTypeNames*   typeNames;      /* [typeIdsSize], built on first use */
+
+    /* decoded class data, from an index; see dexMemberCacheUseIndex() */
+    const DexMetaClass* indexedClasses;
+    const DexField*     indexedFields;
+    const DexMethod*    indexedMethods;
+};
+
+/*
+ * Attach an empty cache to a DexFile.
+ */
+bool dexCreateMemberCache(DexFile* pDexFile)
+{
+    const DexHeader* pHeader = pDexFile->pHeader;
+    DexMemberCache* pCache;
+
+    assert(pDexFile->pMemberCache == NULL);
+
+    pCache = (DexMemberCache*) calloc(1, sizeof(DexMemberCache));
+    if (pCache == NULL)
+        return false;
+
+    pthread_mutex_init(&pCache->lock, NULL);
+    dexArenaInit(&pCache->arena, kArenaChunkSize);
+    pCache->methods = (DexMemberInfo*)
+        calloc(pHeader->methodIdsSize + 1, sizeof(DexMemberInfo));
+    pCache->fields = (DexMemberInfo*)
+        calloc(pHeader->fieldIdsSize + 1, sizeof(DexMemberInfo));
+    pCache->protoDescriptors = (const char**)
+        calloc(pHeader->protoIdsSize + 1, sizeof(const char*));
+    if (pCache->methods == NULL || pCache->fields == NULL ||
+        pCache->protoDescriptors == NULL)
+    {
+        dexFreeMemberCache(pCache);
+        return false;
+    }
+
+    pDexFile->pMemberCache = pCache;
+    return true;
+}
+
+/*
+ * Free a cache.
+ */
+void dexFreeMemberCache(DexMemberCache* pCache)
+{
+    if (pCache == NULL)
+        return;
+
+    dexArenaRelease(&pCache->arena);
+    free(pCache->methods);
+    free(pCache->fields);
+    free(pCache->protoDescriptors);
+    pthread_mutex_destroy(&pCache->lock);
+    free(pCache);
+}
+
+/*
+ * Get the method descriptor for a proto_id, building it in the arena the
+ * first time through.  Methods with the same prototype share the string.
+ *
+ * Call with the lock held.
+ */
+static const char* getProtoDescriptor(const DexFile* pDexFile,
+    DexMemberCache* pCache, u4 protoIdx)
+{
+    const char* descriptor = pCache->protoDescriptors[protoIdx];
+
+    if (descriptor == NULL) {
+        DexStringCache stringCache;
+        DexProto proto;
+
+        proto.dexFile = pDexFile;
+        proto.protoIdx = protoIdx;
+        dexStringCacheInit(&stringCache);
+        descriptor = dexArenaStrdup(&pCache->arena,
+            dexProtoGetMethodDescriptor(&proto, &stringCache));
+        dexStringCacheRelease(&stringCache);
+
+        pCache->protoDescriptors[protoIdx] = descriptor;
+    }
+
+    return descriptor;
+}
+
+/*
+ * Get the strings for a method_id.
+ */
+const DexMemberInfo* dexGetMethodInfo(const DexFile* pDexFile, u4 methodIdx)
+{
+    DexMemberCache* pCache = pDexFile->pMemberCache;
+    DexMemberInfo* pInfo;
+    const DexMethodId* pMethodId;
+    const char* signature;
+
+    if (methodIdx >= pDexFile->pHeader->methodIdsSize)
+        return NULL;
+
+    pInfo = &pCache->methods[methodIdx];
+    if (__atomic_load_n(&pInfo->classDescriptor, __ATOMIC_ACQUIRE) != NULL)
+        return pInfo;
+
+    pthread_mutex_lock(&pCache->lock);
+    if (pInfo->classDescriptor == NULL) {
+        pMethodId = dexGetMethodId(pDexFile, methodIdx);
+        signature = getProtoDescriptor(pDexFile, pCache, pMethodId->protoIdx);
+        if (signature == NULL) {
+            pInfo = NULL;
+            goto bail;
+        }
+
+        pInfo->name = dexStringById(pDexFile, pMethodId->nameIdx);
+        pInfo->signature = signature;
+        __atomic_store_n(&pInfo->classDescriptor,
+            dexStringByTypeIdx(pDexFile, pMethodId->classIdx),
+            __ATOMIC_RELEASE);
+    }
+
+bail:
+    pthread_mutex_unlock(&pCache->lock);
+    return pInfo;
+}
+
+/*
+ * Get the strings for a field_id.
+ */
+const DexMemberInfo* dexGetFieldInfo(const DexFile* pDexFile, u4 fieldIdx)
+{
+    DexMemberCache* pCache = pDexFile->pMemberCache;
+    DexMemberInfo* pInfo;
+    const DexFieldId* pFieldId;
+
+    if (fieldIdx >= pDexFile->pHeader->fieldIdsSize)
+        return NULL;
+
+    pInfo = &pCache->fields[fieldIdx];
+    if (__atomic_load_n(&pInfo->classDescriptor, __ATOMIC_ACQUIRE) != NULL)
+        return pInfo;
+
+    pthread_mutex_lock(&pCache->lock);
+    if (pInfo->classDescriptor == NULL) {
+        pFieldId = dexGetFieldId(pDexFile, fieldIdx);
+        pInfo->name = dexStringById(pDexFile, pFieldId->nameIdx);
+        pInfo->signature = dexStringByTypeIdx(pDexFile, pFieldId->typeIdx);
+        __atomic_store_n(&pInfo->classDescriptor,
+            dexStringByTypeIdx(pDexFile, pFieldId->classIdx),
+            __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&pCache->lock);
+
+    return pInfo;
+}
+
+/*
+ * Converts a single-character primitive type into its human-readable
+ * equivalent.
+ */
+static const char* primitiveTypeLabel(char typeChar)
+{
+    switch (typeChar) {
+    case 'B':   return "byte";
+    case 'C':   return "char";
+    case 'D':   return "double";
+    case 'F':   return "float";
+    case 'I':   return "int";
+    case 'J':   return "long";
+    case 'S':   return "short";
+    case 'V':   return "void";
+    case 'Z':   return "boolean";
+    default:
+                return "UNKNOWN";
+    }
+}
+
+/*
+ * Copy "len" chars, converting '/' and '$' to '.'.  There's no branch in
+ * the loop body, so the compiler can vectorize it.
+ */
+static void copyDotted(char* dst, const char* src, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        char ch = src[i];
+        dst[i] = (ch == '/' || ch == '$') ? '.' : ch;
+    }
+}
+
+/*
+ * Fill in the dotted names for one descriptor.  Returns false if we're
+ * out of memory.
+ */
+static bool setTypeNames(DexArena* pArena, const char* str,
+    DexTypeNames* pNames)
+{
+    size_t targetLen = strlen(str);
+    size_t offset = 0;
+    size_t arrayDepth;
+    const char* lastSlash;
+    char* newStr;
+    char* cp;
+    bool isClass = false;
+
+    /* strip leading [s; will be added to end */
+    while (targetLen > 1 && str[offset] == '[') {
+        offset++;
+        targetLen--;
+    }
+    arrayDepth = offset;
+
+    if (targetLen == 1) {
+        /* primitive type */
+        pNames->dotted = primitiveTypeLabel(str[offset]);
+    } else {
+        /* account for leading 'L' and trailing ';' */
+        if (targetLen >= 2 && str[offset] == 'L' &&
+            str[offset+targetLen-1] == ';')
+        {
+            targetLen -= 2;
+            offset++;
+            isClass = (arrayDepth == 0);
+        }
+
+        newStr = (char*) dexArenaAlloc(pArena, targetLen + arrayDepth*2 +1);
+        if (newStr == NULL)
+            return false;
+
+        copyDotted(newStr, str + offset, targetLen);
+        cp = newStr + targetLen;
+
+        /* add the appropriate number of brackets for arrays */
+        while (arrayDepth-- > 0) {
+            *cp++ = '[';
+            *cp++ = ']';
+        }
+        *cp = '\0';
+        pNames->dotted = newStr;
+    }
+
+    /*
+     * The class name comes after the last '/'.  For a plain class that's
+     * just the tail of the dotted name; anything else gets the same
+     * treatment on the raw descriptor (skip a char, drop the last).
+     */
+    lastSlash = strrchr(str, '/');
+    if (isClass) {
+        pNames->classDotted = pNames->dotted +
+            ((lastSlash != NULL) ? lastSlash - str : 0);
+    } else {
+        const char* start = (lastSlash != NULL) ? lastSlash+1 : str+1;
+        size_t len = (str[0] != '\0') ? strlen(start) : 0;
+
+        if (len > 0)
+            len--;
+        newStr = (char*) dexArenaAlloc(pArena, len +1);
+        if (newStr == NULL)
+            return false;
+        for (cp = newStr; len > 0; len--, start++)
+            *cp++ = (*start == '$') ? '.' : *start;
+        *cp = '\0';
+        pNames->classDotted = newStr;
+    }
+
+    return true;
+}
+
+/*
+ * Get the dotted names for a type_id.
+ */
+const DexTypeNames* dexGetTypeNames(const DexFile* pDexFile, u4 typeIdx)
+{
+    DexMemberCache* pCache = pDexFile->pMemberCache;
+    u4 typeIdsSize = pDexFile->pHeader->typeIdsSize;
+    DexTypeNames* typeNames;
+    u4 i;
+
+    if (typeIdx >= typeIdsSize)
+        return NULL;
+
+    typeNames = __atomic_load_n(&pCache->typeNames, __ATOMIC_ACQUIRE);
+    if (typeNames != NULL)
+        return &typeNames[typeIdx];
+
+    pthread_mutex_lock(&pCache->lock);
+    typeNames = pCache->typeNames;
+    if (typeNames == NULL) {
+        typeNames = (DexTypeNames*) dexArenaAlloc(&pCache->arena,
+            typeIdsSize * sizeof(DexTypeNames));
+        if (typeNames == NULL)
+            goto bail;
+
+        for (i = 0; i < typeIdsSize; i++) {
+            if (!setTypeNames(&pCache->arena,
+                    dexStringByTypeIdx(pDexFile, i), &typeNames[i]))
+            {
+                typeNames = NULL;
+                goto bail;
+            }
+        }
+        __atomic_store_n(&pCache->typeNames, typeNames, __ATOMIC_RELEASE);
+    }
+
+bail:
+    pthread_mutex_unlock(&pCache->lock);
+    return (typeNames != NULL) ? &typeNames[typeIdx] : NULL;
+}
+
+/*
+ * Seed the cache from an index entry.
+ */
+void dexMemberCacheUseIndex(DexFile* pDexFile, const DexMetaIndex* pIndex,
+    const DexMetaIndexDex* pEntry)
+{
+    DexMemberCache* pCache = pDexFile->pMemberCache;
+    const DexMetaTypeNames* metaNames;
+    const u4* protoDescriptors;
+    DexTypeNames* typeNames;
+    u4 i;
+
+    pthread_mutex_lock(&pCache->lock);
+
+    if (pCache->typeNames == NULL) {
+        metaNames = (const DexMetaTypeNames*)
+            dexMetaIndexSection(pIndex, pEntry->typeNamesOff);
+        typeNames = (DexTypeNames*) dexArenaAlloc(&pCache->arena,
+            pEntry->typeIdsSize * sizeof(DexTypeNames));
+        if (typeNames != NULL) {
+            for (i = 0; i < pEntry->typeIdsSize; i++) {
+                typeNames[i].dotted = pIndex->strings + metaNames[i].dotted;
+                typeNames[i].classDotted =
+                    pIndex->strings + metaNames[i].classDotted;
+            }
+            __atomic_store_n(&pCache->typeNames, typeNames, __ATOMIC_RELEASE);
+        }
+    }
+
+    protoDescriptors = (const u4*)
+        dexMetaIndexSection(pIndex, pEntry->protoDescriptorsOff);
+    for (i = 0; i < pEntry->protoIdsSize; i++) {
+        if (pCache->protoDescriptors[i] == NULL) {
+            pCache->protoDescriptors[i] =
+                pIndex->strings + protoDescriptors[i];
+        }
+    }
+
+    pCache->indexedFields = (const DexField*)
+        dexMetaIndexSection(pIndex, pEntry->fieldsOff);
+    pCache->indexedMethods = (const DexMethod*)
+        dexMetaIndexSection(pIndex, pEntry->methodsOff);
+    __atomic_store_n(&pCache->indexedClasses, (const DexMetaClass*)
+        dexMetaIndexSection(pIndex, pEntry->classesOff), __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&pCache->lock);
+}
+
+/*
+ * Start iterating over indexed class data.
+ */
+int dexGetIndexedClassData(const DexFile* pDexFile, u4 classDefIdx,
+    DexClassDataIterator* pIter)
+{
+    DexMemberCache* pCache = pDexFile->pMemberCache;
+    const DexMetaClass* classes;
+    const DexMetaClass* pClass;
+
+    if (pCache == NULL)
+        return 0;
+    classes = __atomic_load_n(&pCache->indexedClasses, __ATOMIC_ACQUIRE);
+    if (classes == NULL || classDefIdx >= pDexFile->pHeader->classDefsSize)
+        return 0;
+
+    pClass = &classes[classDefIdx];
+    if ((pClass->flags & kDexMetaClassBadData) != 0)
+        return -1;
+
+    dexClassDataIteratorInitDecoded(pIter, &pClass->header,
+        pCache->indexedFields + pClass->firstField,
+        pCache->indexedMethods + pClass->firstMethod);
+    return 1;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Lazily-resolved class/name/signature strings for the method_ids and
+ * field_ids of a DEX file, and human-readable names for its type_ids.
+ *
+ * Method signatures have to be assembled from the proto_id, which is
+ * too expensive to redo for every instruction that refers to a method.
+ * The cache builds each one once, in an arena owned by the DexFile, and
+ * hands out the same pointers from then on.
+ *
+ * Lookups may be made from several threads at once.
+ */
+#ifndef _LIBDEX_DEXMEMBERCACHE
+#define _LIBDEX_DEXMEMBERCACHE
+
+#include "DexFile.h"
+#include "DexClass.h"
+
+struct DexMetaIndex;
+struct DexMetaIndexDex;
+
+typedef struct DexMemberCache DexMemberCache;
+
+typedef struct DexMemberInfo {
+    const char* classDescriptor;
+    const char* name;
+    const char* signature;      /* method descriptor, or field type */
+} DexMemberInfo;
+
+/*
+ * "Dotted" forms of a type descriptor.  "Ljava/lang/String;" becomes
+ * "java.lang.String", and "[I" becomes "int[]".  '$' is also converted to
+ * '.', so these can't be turned back into descriptors.
+ */
+typedef struct DexTypeNames {
+    const char* dotted;
+    const char* classDotted;    /* just the class name, e.g. "String" */
+} DexTypeNames;
+
+/*
+ * Attach an empty cache to "pDexFile".  It is freed by dexFileFree().
+ *
+ * Returns false if we're out of memory.
+ */
+bool dexCreateMemberCache(DexFile* pDexFile);
+
+/*
+ * Free a cache.  Called from dexFileFree().
+ */
+void dexFreeMemberCache(DexMemberCache* pCache);
+
+/*
+ * Get the strings for a method_id or field_id.  The pointers remain
+ * valid until the DexFile is freed.
+ *
+ * Returns NULL if the index is out of range (or if we're out of memory).
+ * dexCreateMemberCache() must have been called.
+ */
+const DexMemberInfo* dexGetMethodInfo(const DexFile* pDexFile, u4 methodIdx);
+const DexMemberInfo* dexGetFieldInfo(const DexFile* pDexFile, u4 fieldIdx);
+
+/*
+ * Get the dotted names for a type_id.  The table for all type_ids is
+ * built the first time this is called on a DexFile.
+ *
+ * Returns NULL if the index is out of range (or if we're out of memory).
+ */
+const DexTypeNames* dexGetTypeNames(const DexFile* pDexFile, u4 typeIdx);
+
+/*
+ * Take type names, method signatures and decoded class data from a saved
+ * index entry (see DexMetaIndex.h) rather than building them.  Anything
+ * the cache has already built is kept.  The index must stay mapped until
+ * the DexFile is freed.
+ */
+void dexMemberCacheUseIndex(DexFile* pDexFile,
+    const struct DexMetaIndex* pIndex, const struct DexMetaIndexDex* pEntry);
+
+/*
+ * Start iterating over a class_def's fields and methods with the decoded
+ * class data from an index attached by dexMemberCacheUseIndex().
+ *
+ * Returns 1 on success, 0 if there's no index, or -1 if the class data
+ * was found to be malformed when the index was built.
+ */
+int dexGetIndexedClassData(const DexFile* pDexFile, u4 classDefIdx,
+    DexClassDataIterator* pIter);
+
+#endif /*_LIBDEX_DEXMEMBERCACHE*/
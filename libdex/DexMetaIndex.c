@@ -0,0 +1,554 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Saved DEX metadata (".dexidx" files).
+ */
+#include "DexMetaIndex.h"
+#include "DexMemberCache.h"
+#include "DexProto.h"
+
+#include <zlib.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+
+/*
+ * Growable byte buffer used while building an index.
+ */
+typedef struct MetaBuffer {
+    u1*     data;
+    u4      len;
+    u4      max;
+    bool    failed;
+} MetaBuffer;
+
+/*
+ * Make sure "pBuf" can hold "newLen" bytes.
+ */
+static bool reserveBytes(MetaBuffer* pBuf, u8 newLen)
+{
+    if (pBuf->failed)
+        return false;
+    if (newLen > 0x7fffffff) {
+        pBuf->failed = true;
+        return false;
+    }
+
+    if (newLen > pBuf->max) {
+        u4 newMax = (pBuf->max == 0) ? 4096 : pBuf->max;
+        while (newMax < newLen)
+            newMax *= 2;
+
+        u1* newData = (u1*) realloc(pBuf->data, newMax);
+        if (newData == NULL) {
+            pBuf->failed = true;
+            return false;
+        }
+        pBuf->data = newData;
+        pBuf->max = newMax;
+    }
+    return true;
+}
+
+/*
+ * Append "len" bytes (zeroed if "data" is NULL), 4-byte aligned.  Returns
+ * the offset they were placed at.
+ */
+static u4 appendBytes(MetaBuffer* pBuf, const void* data, size_t len)
+{
+    u4 offset = (pBuf->len + 3) & ~3;
+
+    if (!reserveBytes(pBuf, (u8) offset + len))
+        return 0;
+
+    memset(pBuf->data + pBuf->len, 0, offset - pBuf->len);
+    if (data != NULL)
+        memcpy(pBuf->data + offset, data, len);
+    else
+        memset(pBuf->data + offset, 0, len);
+    pBuf->len = offset + len;
+    return offset;
+}
+
+/*
+ * Add a string to the pool, unaligned.  Returns its offset.
+ */
+static u4 appendString(MetaBuffer* pPool, const char* str)
+{
+    size_t len = strlen(str) + 1;
+    u4 offset = pPool->len;
+
+    if (!reserveBytes(pPool, (u8) offset + len))
+        return 0;
+
+    memcpy(pPool->data + offset, str, len);
+    pPool->len += len;
+    return offset;
+}
+
+/*
+ * Add the type names of every type_id.  The class name of a plain class
+ * is a suffix of its dotted name, so it shares the string.
+ */
+static u4 addTypeNames(MetaBuffer* pBuf, MetaBuffer* pPool,
+    const DexFile* pDexFile)
+{
+    u4 count = pDexFile->pHeader->typeIdsSize;
+    u4 offset = appendBytes(pBuf, NULL, count * sizeof(DexMetaTypeNames));
+    u4 i;
+
+    for (i = 0; i < count && !pBuf->failed; i++) {
+        const DexTypeNames* pNames = dexGetTypeNames(pDexFile, i);
+        DexMetaTypeNames names;
+        size_t dottedLen;
+
+        if (pNames == NULL) {
+            pBuf->failed = true;
+            break;
+        }
+
+        names.dotted = appendString(pPool, pNames->dotted);
+        dottedLen = strlen(pNames->dotted);
+        if (pNames->classDotted >= pNames->dotted &&
+            pNames->classDotted <= pNames->dotted + dottedLen)
+        {
+            names.classDotted = names.dotted +
+                (pNames->classDotted - pNames->dotted);
+        } else {
+            names.classDotted = appendString(pPool, pNames->classDotted);
+        }
+
+        memcpy(pBuf->data + offset + i * sizeof(names), &names, sizeof(names));
+    }
+
+    return offset;
+}
+
+/*
+ * Add the method descriptor of every proto_id.
+ */
+static u4 addProtoDescriptors(MetaBuffer* pBuf, MetaBuffer* pPool,
+    const DexFile* pDexFile)
+{
+    u4 count = pDexFile->pHeader->protoIdsSize;
+    u4 offset = appendBytes(pBuf, NULL, count * sizeof(u4));
+    DexStringCache stringCache;
+    u4 i;
+
+    dexStringCacheInit(&stringCache);
+    for (i = 0; i < count && !pBuf->failed; i++) {
+        DexProto proto;
+        u4 strOff;
+
+        proto.dexFile = pDexFile;
+        proto.protoIdx = i;
+        strOff = appendString(pPool,
+            dexProtoGetMethodDescriptor(&proto, &stringCache));
+        memcpy(pBuf->data + offset + i * sizeof(u4), &strOff, sizeof(u4));
+    }
+    dexStringCacheRelease(&stringCache);
+
+    return offset;
+}
+
+/*
+ * Decode the class data of every class_def.  The fields and methods go
+ * into "pFields" and "pMethods", which become the last two sections.
+ */
+static u4 addClasses(MetaBuffer* pBuf, MetaBuffer* pFields,
+    MetaBuffer* pMethods, const DexFile* pDexFile)
+{
+    const u1* pLimit = pDexFile->baseAddr + pDexFile->pHeader->fileSize;
+    u4 count = pDexFile->pHeader->classDefsSize;
+    u4 offset = appendBytes(pBuf, NULL, count * sizeof(DexMetaClass));
+    u4 i;
+
+    for (i = 0; i < count && !pBuf->failed; i++) {
+        const DexClassDef* pClassDef = dexGetClassDef(pDexFile, i);
+        const u1* pData = dexGetClassData(pDexFile, pClassDef);
+        DexClassDataIterator classData;
+        DexMetaClass metaClass;
+        DexField field;
+        DexMethod method;
+
+        memset(&metaClass, 0, sizeof(metaClass));
+        metaClass.firstField = pFields->len / sizeof(DexField);
+        metaClass.firstMethod = pMethods->len / sizeof(DexMethod);
+
+        if (pData != NULL &&
+            (pData >= pLimit || !dexVerifyClassData(pData, pLimit)))
+        {
+            metaClass.flags = kDexMetaClassBadData;
+        } else {
+            dexClassDataIteratorInit(&classData, pData);
+            metaClass.header = classData.header;
+            while (dexClassDataIteratorNextField(&classData, &field))
+                appendBytes(pFields, &field, sizeof(field));
+            while (dexClassDataIteratorNextMethod(&classData, &method))
+                appendBytes(pMethods, &method, sizeof(method));
+        }
+
+        memcpy(pBuf->data + offset + i * sizeof(metaClass), &metaClass,
+            sizeof(metaClass));
+    }
+
+    return offset;
+}
+
+/*
+ * Compute the checksum of an index that's "length" bytes long.
+ */
+static u4 computeChecksum(const DexMetaIndexHeader* pHeader, size_t length)
+{
+    const int nonSum = sizeof(pHeader->magic) + sizeof(pHeader->checksum);
+    uLong adler = adler32(0L, Z_NULL, 0);
+
+    return (u4) adler32(adler, (const u1*) pHeader + nonSum, length - nonSum);
+}
+
+/*
+ * Point the fields of "pIndex" at the sections in its mapping.
+ */
+static void setSections(DexMetaIndex* pIndex)
+{
+    const u1* base = (const u1*) pIndex->map.addr;
+
+    pIndex->pHeader = (const DexMetaIndexHeader*) base;
+    pIndex->dexes = (const DexMetaIndexDex*)
+        (base + sizeof(DexMetaIndexHeader));
+    pIndex->strings = (const char*) (base + pIndex->pHeader->stringsOff);
+}
+
+/*
+ * Build an index.
+ */
+DexMetaIndex* dexMetaIndexCreate(DexFile* const* pDexFiles, int numDex)
+{
+    DexMetaIndex* pIndex = NULL;
+    MetaBuffer buf, pool, fields, methods;
+    DexMetaIndexHeader header;
+    int i;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(&pool, 0, sizeof(pool));
+    memset(&fields, 0, sizeof(fields));
+    memset(&methods, 0, sizeof(methods));
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DEX_META_INDEX_MAGIC, sizeof(header.magic));
+    header.numDex = numDex;
+    appendBytes(&buf, &header, sizeof(header));
+    appendBytes(&buf, NULL, numDex * sizeof(DexMetaIndexDex));
+
+    for (i = 0; i < numDex && !buf.failed; i++) {
+        const DexFile* pDexFile = pDexFiles[i];
+        const DexHeader* pDexHeader = pDexFile->pHeader;
+        DexMetaIndexDex entry;
+
+        memset(&entry, 0, sizeof(entry));
+        memcpy(entry.signature, pDexHeader->signature, kSHA1DigestLen);
+        entry.checksum = pDexHeader->checksum;
+        entry.fileSize = pDexHeader->fileSize;
+        entry.typeIdsSize = pDexHeader->typeIdsSize;
+        entry.protoIdsSize = pDexHeader->protoIdsSize;
+        entry.classDefsSize = pDexHeader->classDefsSize;
+
+        entry.typeNamesOff = addTypeNames(&buf, &pool, pDexFile);
+        entry.protoDescriptorsOff =
+            addProtoDescriptors(&buf, &pool, pDexFile);
+
+        fields.len = methods.len = 0;
+        entry.classesOff = addClasses(&buf, &fields, &methods, pDexFile);
+        entry.numFields = fields.len / sizeof(DexField);
+        entry.numMethods = methods.len / sizeof(DexMethod);
+        entry.fieldsOff = appendBytes(&buf, fields.data, fields.len);
+        entry.methodsOff = appendBytes(&buf, methods.data, methods.len);
+        if (fields.failed || methods.failed || pool.failed)
+            buf.failed = true;
+
+        if (!buf.failed) {
+            memcpy(buf.data + sizeof(header) + i * sizeof(entry), &entry,
+                sizeof(entry));
+        }
+    }
+
+    header.stringsOff = appendBytes(&buf, pool.data, pool.len);
+    header.stringsSize = pool.len;
+    header.fileSize = buf.len;
+    if (buf.failed) {
+        LOGE("Out of memory building DEX metadata index\n");
+        goto bail;
+    }
+    memcpy(buf.data, &header, sizeof(header));
+
+    pIndex = (DexMetaIndex*) calloc(1, sizeof(DexMetaIndex));
+    if (pIndex == NULL)
+        goto bail;
+    if (sysCreatePrivateMap(buf.len, &pIndex->map) != 0) {
+        free(pIndex);
+        pIndex = NULL;
+        goto bail;
+    }
+    memcpy(pIndex->map.addr, buf.data, buf.len);
+    ((DexMetaIndexHeader*) pIndex->map.addr)->checksum =
+        computeChecksum((const DexMetaIndexHeader*) pIndex->map.addr, buf.len);
+
+    setSections(pIndex);
+
+bail:
+    free(buf.data);
+    free(pool.data);
+    free(fields.data);
+    free(methods.data);
+    return pIndex;
+}
+
+/*
+ * Write an index.
+ */
+int dexMetaIndexWrite(const DexMetaIndex* pIndex, const char* fileName)
+{
+    const u1* data = (const u1*) pIndex->map.addr;
+    size_t len = pIndex->pHeader->fileSize;
+    char* tmpName;
+    int result = -1;
+    int fd;
+
+    tmpName = (char*) malloc(strlen(fileName) + 32);
+    if (tmpName == NULL)
+        return -1;
+    sprintf(tmpName, "%s.%d.tmp", fileName, (int) getpid());
+
+    fd = open(tmpName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to create index '%s': %s\n",
+            tmpName, strerror(errno));
+        free(tmpName);
+        return -1;
+    }
+
+    while (len > 0) {
+        ssize_t actual = write(fd, data, len);
+        if (actual < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "Write to index '%s' failed: %s\n",
+                tmpName, strerror(errno));
+            goto bail;
+        }
+        data += actual;
+        len -= actual;
+    }
+
+    result = 0;
+
+bail:
+    if (close(fd) != 0 && result == 0) {
+        fprintf(stderr, "Close of index '%s' failed: %s\n",
+            tmpName, strerror(errno));
+        result = -1;
+    }
+    if (result == 0 && rename(tmpName, fileName) != 0) {
+        fprintf(stderr, "Unable to rename '%s' to '%s': %s\n",
+            tmpName, fileName, strerror(errno));
+        result = -1;
+    }
+    if (result != 0)
+        unlink(tmpName);
+    free(tmpName);
+    return result;
+}
+
+/*
+ * Check that a table of "count" elements of "elemSize" bytes at "offset"
+ * lies within "limit" bytes and is 4-byte aligned.
+ */
+static bool checkSection(u4 offset, u4 count, size_t elemSize, size_t limit)
+{
+    u8 end = (u8) offset + (u8) count * elemSize;
+
+    return (offset & 3) == 0 && end <= limit;
+}
+
+/*
+ * Check everything an index says about one DEX file, so that nothing
+ * read through it later can point outside the mapping.
+ */
+static bool checkEntry(const DexMetaIndex* pIndex,
+    const DexMetaIndexDex* pEntry)
+{
+    size_t limit = pIndex->pHeader->stringsOff;
+    u4 stringsSize = pIndex->pHeader->stringsSize;
+    const DexMetaTypeNames* typeNames;
+    const u4* protoDescriptors;
+    const DexMetaClass* classes;
+    u4 i;
+
+    if (!checkSection(pEntry->typeNamesOff, pEntry->typeIdsSize,
+            sizeof(DexMetaTypeNames), limit) ||
+        !checkSection(pEntry->protoDescriptorsOff, pEntry->protoIdsSize,
+            sizeof(u4), limit) ||
+        !checkSection(pEntry->classesOff, pEntry->classDefsSize,
+            sizeof(DexMetaClass), limit) ||
+        !checkSection(pEntry->fieldsOff, pEntry->numFields,
+            sizeof(DexField), limit) ||
+        !checkSection(pEntry->methodsOff, pEntry->numMethods,
+            sizeof(DexMethod), limit))
+    {
+        return false;
+    }
+
+    typeNames = (const DexMetaTypeNames*)
+        dexMetaIndexSection(pIndex, pEntry->typeNamesOff);
+    for (i = 0; i < pEntry->typeIdsSize; i++) {
+        if (typeNames[i].dotted >= stringsSize ||
+            typeNames[i].classDotted >= stringsSize)
+        {
+            return false;
+        }
+    }
+
+    protoDescriptors = (const u4*)
+        dexMetaIndexSection(pIndex, pEntry->protoDescriptorsOff);
+    for (i = 0; i < pEntry->protoIdsSize; i++) {
+        if (protoDescriptors[i] >= stringsSize)
+            return false;
+    }
+
+    classes = (const DexMetaClass*)
+        dexMetaIndexSection(pIndex, pEntry->classesOff);
+    for (i = 0; i < pEntry->classDefsSize; i++) {
+        const DexClassDataHeader* pHeader = &classes[i].header;
+        u8 numFields = (u8) pHeader->staticFieldsSize +
+            pHeader->instanceFieldsSize;
+        u8 numMethods = (u8) pHeader->directMethodsSize +
+            pHeader->virtualMethodsSize;
+
+        if (classes[i].firstField + numFields > pEntry->numFields ||
+            classes[i].firstMethod + numMethods > pEntry->numMethods)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Map an index.
+ */
+DexMetaIndex* dexMetaIndexOpen(const char* fileName)
+{
+    DexMetaIndex* pIndex = NULL;
+    const DexMetaIndexHeader* pHeader;
+    size_t length;
+    u4 i;
+    int fd;
+
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            fprintf(stderr, "Unable to open index '%s': %s\n",
+                fileName, strerror(errno));
+        }
+        return NULL;
+    }
+
+    pIndex = (DexMetaIndex*) calloc(1, sizeof(DexMetaIndex));
+    if (pIndex == NULL)
+        goto bail;
+
+    if (sysMapFileInShmemReadOnly(fd, &pIndex->map) != 0) {
+        fprintf(stderr, "Unable to map index '%s'\n", fileName);
+        free(pIndex);
+        pIndex = NULL;
+        goto bail;
+    }
+
+    pHeader = (const DexMetaIndexHeader*) pIndex->map.addr;
+    length = pIndex->map.length;
+    if (length < sizeof(DexMetaIndexHeader) ||
+        memcmp(pHeader->magic, DEX_META_INDEX_MAGIC,
+            sizeof(pHeader->magic)) != 0 ||
+        pHeader->fileSize != length ||
+        pHeader->checksum != computeChecksum(pHeader, length) ||
+        !checkSection(sizeof(DexMetaIndexHeader), pHeader->numDex,
+            sizeof(DexMetaIndexDex), pHeader->stringsOff) ||
+        (u8) pHeader->stringsOff + pHeader->stringsSize != length ||
+        (pHeader->stringsSize > 0 &&
+            ((const char*) pHeader)[length - 1] != '\0'))
+    {
+        goto bad;
+    }
+
+    setSections(pIndex);
+    for (i = 0; i < pHeader->numDex; i++) {
+        if (!checkEntry(pIndex, &pIndex->dexes[i]))
+            goto bad;
+    }
+
+bail:
+    close(fd);
+    return pIndex;
+
+bad:
+    fprintf(stderr, "'%s' is not a valid DEX index\n", fileName);
+    dexMetaIndexFree(pIndex);
+    pIndex = NULL;
+    goto bail;
+}
+
+/*
+ * Free an index.
+ */
+void dexMetaIndexFree(DexMetaIndex* pIndex)
+{
+    if (pIndex == NULL)
+        return;
+    sysReleaseShmem(&pIndex->map);
+    free(pIndex);
+}
+
+/*
+ * Find the entry for a DEX file.
+ */
+const DexMetaIndexDex* dexMetaIndexFind(const DexMetaIndex* pIndex,
+    const DexFile* pDexFile)
+{
+    const DexHeader* pHeader = pDexFile->pHeader;
+    u4 i;
+
+    for (i = 0; i < pIndex->pHeader->numDex; i++) {
+        const DexMetaIndexDex* pEntry = &pIndex->dexes[i];
+
+        if (memcmp(pEntry->signature, pHeader->signature,
+                kSHA1DigestLen) == 0 &&
+            pEntry->checksum == pHeader->checksum &&
+            pEntry->fileSize == pHeader->fileSize &&
+            pEntry->typeIdsSize == pHeader->typeIdsSize &&
+            pEntry->protoIdsSize == pHeader->protoIdsSize &&
+            pEntry->classDefsSize == pHeader->classDefsSize)
+        {
+            return pEntry;
+        }
+    }
+
+    return NULL;
+}
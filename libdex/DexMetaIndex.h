@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Saved metadata for one or more DEX files (a ".dexidx" file), so a later
+ * run on the same files can map it instead of decoding class data and
+ * building type names and method signatures again.
+ *
+ * As with DexLineIndex, the layout is the same in memory and on disk:
+ *
+ *   DexMetaIndexHeader
+ *   DexMetaIndexDex    dexes[numDex]
+ *   (per DEX file, at the offsets given in its DexMetaIndexDex)
+ *     DexMetaTypeNames typeNames[typeIdsSize]
+ *     u4               protoDescriptors[protoIdsSize]
+ *     DexMetaClass     classes[classDefsSize]
+ *     DexField         fields[numFields]
+ *     DexMethod        methods[numMethods]
+ *   char               strings[stringsSize]
+ *
+ * Offsets of sections are from the start of the file; "string" values
+ * are offsets into the string pool at the end.  A checksum guards against
+ * damage to the index itself, and each DEX file is matched by the
+ * signature, checksum and sizes in its header, so an index that no
+ * longer fits is ignored rather than trusted.
+ *
+ * Everything is stored in host byte order.
+ */
+#ifndef _LIBDEX_DEXMETAINDEX
+#define _LIBDEX_DEXMETAINDEX
+
+#include "DexFile.h"
+#include "DexClass.h"
+#include "SysUtil.h"
+
+#define DEX_META_INDEX_MAGIC    "dexidx1"
+
+typedef struct DexMetaIndexHeader {
+    u1  magic[8];           /* includes version number */
+    u4  checksum;           /* adler32 of everything after this */
+    u4  numDex;
+    u4  fileSize;           /* of the whole index, as a sanity check */
+    u4  stringsOff;
+    u4  stringsSize;
+} DexMetaIndexHeader;
+
+/* where to find the tables for one DEX file */
+typedef struct DexMetaIndexDex {
+    u1  signature[kSHA1DigestLen];
+    u4  checksum;
+    u4  fileSize;
+    u4  typeIdsSize;
+    u4  protoIdsSize;
+    u4  classDefsSize;
+    u4  numFields;
+    u4  numMethods;
+    u4  typeNamesOff;
+    u4  protoDescriptorsOff;
+    u4  classesOff;
+    u4  fieldsOff;
+    u4  methodsOff;
+} DexMetaIndexDex;
+
+/* string pool offsets of the DexTypeNames for a type_id */
+typedef struct DexMetaTypeNames {
+    u4  dotted;
+    u4  classDotted;
+} DexMetaTypeNames;
+
+/* the decoded class_data_item of one class_def */
+typedef struct DexMetaClass {
+    DexClassDataHeader header;  /* all zero if there's no class data */
+    u4  firstField;         /* index into fields[] */
+    u4  firstMethod;        /* index into methods[] */
+    u4  flags;              /* kDexMetaClass* */
+} DexMetaClass;
+
+enum {
+    kDexMetaClassBadData    = 1,    /* class_data_item failed to verify */
+};
+
+/*
+ * An index, either built in memory or mapped from a file.
+ */
+typedef struct DexMetaIndex {
+    MemMapping              map;
+    const DexMetaIndexHeader* pHeader;
+    const DexMetaIndexDex*  dexes;
+    const char*             strings;
+} DexMetaIndex;
+
+/*
+ * Build an index for "pDexFiles", which must have member caches (see
+ * DexMemberCache.h).
+ *
+ * Returns NULL on failure.
+ */
+DexMetaIndex* dexMetaIndexCreate(DexFile* const* pDexFiles, int numDex);
+
+/*
+ * Write an index to "fileName".  The data goes to a temporary file that
+ * is renamed into place, so a reader never sees a partial index.
+ *
+ * Returns 0 on success.
+ */
+int dexMetaIndexWrite(const DexMetaIndex* pIndex, const char* fileName);
+
+/*
+ * Map an index previously written with dexMetaIndexWrite().
+ *
+ * Returns NULL if the file doesn't exist, can't be mapped, or isn't a
+ * valid index.  Only a file that exists but is bad gets a message.
+ */
+DexMetaIndex* dexMetaIndexOpen(const char* fileName);
+
+/*
+ * Free an index from dexMetaIndexCreate() or dexMetaIndexOpen().
+ */
+void dexMetaIndexFree(DexMetaIndex* pIndex);
+
+/*
+ * Find the entry for "pDexFile".  Returns NULL if the index doesn't have
+ * one that matches the file's header.
+ */
+const DexMetaIndexDex* dexMetaIndexFind(const DexMetaIndex* pIndex,
+    const DexFile* pDexFile);
+
+/*
+ * Get a section of an index.
+ */
+DEX_INLINE const void* dexMetaIndexSection(const DexMetaIndex* pIndex,
+    u4 offset)
+{
+    return (const u1*) pIndex->map.addr + offset;
+}
+
+#endif /*_LIBDEX_DEXMETAINDEX*/
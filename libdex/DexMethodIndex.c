@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Index from method_idx to defining class_def.
+ */
+#include "DexMethodIndex.h"
+
+#include <stdlib.h>
+
+/*
+ * Record every method defined by one class.
+ */
+static void addClass(DexMethodIndex* pIndex, const DexFile* pDexFile,
+    u4 classDefIdx)
+{
+    const DexClassDef* pClassDef = dexGetClassDef(pDexFile, classDefIdx);
+    const u1* pData = dexGetClassData(pDexFile, pClassDef);
+    const u1* pLimit = pDexFile->baseAddr + pDexFile->pHeader->fileSize;
+    DexClassDataIterator classData;
+    DexMethod method;
+    u4 numDirect;
+    u4 count = 0;
+
+    if (pData == NULL)
+        return;
+    if (pData >= pLimit || !dexVerifyClassData(pData, pLimit))
+        return;
+
+    dexClassDataIteratorInit(&classData, pData);
+    numDirect = classData.header.directMethodsSize;
+    while (dexClassDataIteratorNextMethod(&classData, &method)) {
+        bool isVirtual = (count >= numDirect);
+
+        if (method.methodIdx < pIndex->numMethods) {
+            DexMethodLocation* pLoc = &pIndex->locations[method.methodIdx];
+
+            /* a method defined twice is broken; keep the first */
+            if (pLoc->classDefIdx == kDexNoIndex) {
+                pLoc->classDefIdx = classDefIdx;
+                pLoc->position = isVirtual ? count - numDirect : count;
+                pLoc->isVirtual = isVirtual;
+                pLoc->method = method;
+            }
+        }
+        count++;
+    }
+}
+
+/*
+ * Build the index.
+ */
+DexMethodIndex* dexCreateMethodIndex(const DexFile* pDexFile)
+{
+    DexMethodIndex* pIndex;
+    u4 numMethods = pDexFile->pHeader->methodIdsSize;
+    u4 i;
+
+    pIndex = (DexMethodIndex*) malloc(sizeof(DexMethodIndex));
+    if (pIndex == NULL)
+        return NULL;
+    pIndex->numMethods = numMethods;
+    /* (+1 so an empty table isn't mistaken for a failure) */
+    pIndex->locations = (DexMethodLocation*)
+        malloc(numMethods * sizeof(DexMethodLocation) + 1);
+    if (pIndex->locations == NULL) {
+        free(pIndex);
+        return NULL;
+    }
+
+    for (i = 0; i < numMethods; i++)
+        pIndex->locations[i].classDefIdx = kDexNoIndex;
+
+    for (i = 0; i < pDexFile->pHeader->classDefsSize; i++)
+        addClass(pIndex, pDexFile, i);
+
+    return pIndex;
+}
+
+/*
+ * Free the index.
+ */
+void dexFreeMethodIndex(DexMethodIndex* pIndex)
+{
+    if (pIndex == NULL)
+        return;
+    free(pIndex->locations);
+    free(pIndex);
+}
+
+/*
+ * Binary search for the run of method_ids with class "classIdx".
+ */
+void dexFindClassMethodIds(const DexFile* pDexFile, u4 classIdx, u4* pFirst,
+    u4* pEnd)
+{
+    u4 lo = 0;
+    u4 hi = pDexFile->pHeader->methodIdsSize;
+
+    /* first method_id with classIdx >= the one we want */
+    while (lo < hi) {
+        u4 mid = lo + (hi - lo) / 2;
+        if (dexGetMethodId(pDexFile, mid)->classIdx < classIdx)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *pFirst = lo;
+
+    hi = pDexFile->pHeader->methodIdsSize;
+    while (lo < hi && dexGetMethodId(pDexFile, lo)->classIdx == classIdx)
+        lo++;
+    *pEnd = lo;
+}
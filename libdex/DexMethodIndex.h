@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2008 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Index from method_idx to the class_def and encoded_method that define
+ * the method, so a single method can be found without walking every
+ * class_data_item in the file.
+ */
+#ifndef _LIBDEX_DEXMETHODINDEX
+#define _LIBDEX_DEXMETHODINDEX
+
+#include "DexFile.h"
+#include "DexClass.h"
+
+/*
+ * Where one method is defined.  Methods that are only referred to from
+ * this DEX file have a classDefIdx of kDexNoIndex.
+ */
+typedef struct DexMethodLocation {
+    u4          classDefIdx;
+    u4          position;       /* in the direct or virtual method list */
+    bool        isVirtual;
+    DexMethod   method;         /* the decoded encoded_method */
+} DexMethodLocation;
+
+typedef struct DexMethodIndex {
+    u4                  numMethods;     /* same as methodIdsSize */
+    DexMethodLocation*  locations;      /* by method_idx */
+} DexMethodIndex;
+
+/*
+ * Build the index for "pDexFile" in one pass over its class data.  Classes
+ * with malformed class data are left out.
+ *
+ * Returns NULL if we're out of memory.
+ */
+DexMethodIndex* dexCreateMethodIndex(const DexFile* pDexFile);
+
+/*
+ * Free an index from dexCreateMethodIndex().
+ */
+void dexFreeMethodIndex(DexMethodIndex* pIndex);
+
+/*
+ * Find where a method is defined.  Returns NULL if "methodIdx" is out of
+ * range or the method isn't defined in this DEX file.
+ */
+DEX_INLINE const DexMethodLocation* dexGetMethodLocation(
+    const DexMethodIndex* pIndex, u4 methodIdx)
+{
+    const DexMethodLocation* pLoc;
+
+    if (methodIdx >= pIndex->numMethods)
+        return NULL;
+    pLoc = &pIndex->locations[methodIdx];
+    return (pLoc->classDefIdx == kDexNoIndex) ? NULL : pLoc;
+}
+
+/*
+ * Find the method_ids that belong to type "classIdx".  method_ids are
+ * sorted by class, so they form a run; on return the run is
+ * [*pFirst, *pEnd), which is empty if there are none.
+ */
+void dexFindClassMethodIds(const DexFile* pDexFile, u4 classIdx, u4* pFirst,
+    u4* pEnd);
+
+#endif /*_LIBDEX_DEXMETHODINDEX*/
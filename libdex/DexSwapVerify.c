@@ -19,16 +19,22 @@
  */
 
 #include "DexFile.h"
+#include "Adler32.h"
 #include "DexClass.h"
 #include "DexDataMap.h"
 #include "DexProto.h"
 #include "Leb128.h"
 
+#include "SysUtil.h"
+
 #include "safe_iop/safe_iop.h"
-#include <zlib.h>
 
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
 
 #ifndef __BYTE_ORDER
 # error "byte ordering not defined"
@@ -60,9 +66,19 @@ static u8 endianSwapU8(u8 value) {
 }
 #endif
 
-#define SWAP_FIELD2(_field) (_field) = SWAP2(_field)
-#define SWAP_FIELD4(_field) (_field) = SWAP4(_field)
-#define SWAP_FIELD8(_field) (_field) = SWAP8(_field)
+/*
+ * On a little-endian host nothing is written, which is what lets
+ * dexVerifyReadOnly() work on a read-only mapping.
+ */
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+# define SWAP_FIELD2(_field) ((void) 0)
+# define SWAP_FIELD4(_field) ((void) 0)
+# define SWAP_FIELD8(_field) ((void) 0)
+#else
+# define SWAP_FIELD2(_field) (_field) = SWAP2(_field)
+# define SWAP_FIELD4(_field) (_field) = SWAP4(_field)
+# define SWAP_FIELD8(_field) (_field) = SWAP8(_field)
+#endif
 
 /*
  * Some information we pass around to help verify values.
@@ -83,8 +99,50 @@ typedef struct CheckState {
     u4*               pDefinedClassBits;
 
     const void*       previousItem; // set during section iteration
+
+    DexVerifyTimings* pTimings;     // NULL unless timings were requested
 } CheckState;
 
+/*
+ * Get the time, for DexVerifyTimings.
+ */
+static u8 getTimeNsec(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u8) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*
+ * Find (or add) the timing entry for a map section.  Returns NULL if
+ * timings weren't requested.
+ */
+static DexSectionTiming* getSectionTiming(const CheckState* state,
+        const DexMapItem* item) {
+    DexVerifyTimings* pTimings = state->pTimings;
+    u4 i;
+
+    if (pTimings == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < pTimings->numSections; i++) {
+        if (pTimings->sections[i].type == item->type) {
+            return &pTimings->sections[i];
+        }
+    }
+
+    /* swapMap() rejects duplicate and unknown types, so this fits */
+    if (i == kDexMaxMapSections) {
+        return NULL;
+    }
+    pTimings->numSections++;
+    pTimings->sections[i].type = item->type;
+    pTimings->sections[i].size = item->size;
+    pTimings->sections[i].intraNsec = 0;
+    pTimings->sections[i].crossNsec = 0;
+    return &pTimings->sections[i];
+}
+
 /*
  * Return the file offset of the given pointer.
  */
@@ -1515,7 +1573,7 @@ static bool verifyClassDataItem0(const CheckState* state,
         return false;
     }
 
-    verifyFields(state, classData->header.instanceFieldsSize,
+    okay = verifyFields(state, classData->header.instanceFieldsSize,
             classData->instanceFields, false);
 
     if (!okay) {
@@ -1722,6 +1780,12 @@ static u4 setHandlerOffsAndVerify(const CheckState* state,
 /* Helper for swapCodeItem(), which does all the try-catch related
  * swapping and verification. */
 static void* swapTriesAndCatches(const CheckState* state, DexCode* code) {
+    DexTry* tries = (DexTry*) dexGetTries(code);
+    u4 count = code->triesSize;
+
+    /* the handlers follow the tries, so make sure they're in the file */
+    CHECK_LIST_SIZE(tries, count, sizeof(DexTry));
+
     const u1* encodedHandlers = dexGetCatchHandlerData(code);
     const u1* encodedPtr = encodedHandlers;
     bool okay = true;
@@ -1747,12 +1811,8 @@ static void* swapTriesAndCatches(const CheckState* state, DexCode* code) {
         return NULL;
     }
 
-    DexTry* tries = (DexTry*) dexGetTries(code);
-    u4 count = code->triesSize;
     u4 lastEnd = 0;
 
-    CHECK_LIST_SIZE(tries, count, sizeof(DexTry));
-
     while (count--) {
         u4 i;
 
@@ -1813,16 +1873,21 @@ static void* swapCodeItem(const CheckState* state, void* ptr) {
     insns = item->insns;
     CHECK_LIST_SIZE(insns, count, sizeof(u2));
 
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    insns += count;
+#else
     while (count--) {
         *insns = SWAP2(*insns);
         insns++;
     }
+#endif
 
     if (item->triesSize == 0) {
         ptr = insns;
     } else {
         if ((((u4) insns) & 3) != 0) {
             // Four-byte alignment for the tries. Verify the spacer is a 0.
+            CHECK_PTR_RANGE(insns, insns + 1);
             if (*insns != 0) {
                 LOGE("Non-zero padding: 0x%x\n", (u4) *insns);
                 return NULL;
@@ -1835,6 +1900,30 @@ static void* swapCodeItem(const CheckState* state, void* ptr) {
     return ptr;
 }
 
+/* Size of the blocks checked by asciiPrefixLength(). */
+#define kAsciiBlockSize 16
+
+/*
+ * Count how many of the kAsciiBlockSize bytes at "data" are plain ASCII
+ * (0x01-0x7f) before the first byte that isn't: a NUL, or a byte with
+ * the high bit set, which starts or continues a multibyte sequence.
+ */
+static inline u4 asciiPrefixLength(const u1* data) {
+#ifdef __SSE2__
+    __m128i block = _mm_loadu_si128((const __m128i*) data);
+    u4 mask = _mm_movemask_epi8(block) |
+        _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_setzero_si128()));
+
+    return (mask == 0) ? kAsciiBlockSize : (u4) __builtin_ctz(mask);
+#else
+    u4 len = 0;
+
+    while (len < kAsciiBlockSize && (u1) (data[len] - 1) < 0x7f)
+        len++;
+    return len;
+#endif
+}
+
 /* Perform intra-item verification on string_data_item. */
 static void* intraVerifyStringDataItem(const CheckState* state, void* ptr) {
     const u1* fileEnd = state->fileEnd;
@@ -1849,6 +1938,26 @@ static void* intraVerifyStringDataItem(const CheckState* state, void* ptr) {
     }
 
     for (i = 0; i < utf16Size; i++) {
+        /*
+         * Most string data is ASCII, which is one code unit per byte, so
+         * take it a block at a time while a whole block fits in the file.
+         * A block may run past the end of the string; only the part that
+         * belongs to it counts.  The byte that stops a block is handled
+         * below.
+         */
+        while (fileEnd - data >= kAsciiBlockSize) {
+            u4 len = asciiPrefixLength(data);
+
+            if (len > utf16Size - i)
+                len = utf16Size - i;
+            data += len;
+            i += len;
+            if (len < kAsciiBlockSize)
+                break;
+        }
+        if (i == utf16Size)
+            break;
+
         if (data >= fileEnd) {
             LOGE("String data would go beyond end-of-file\n");
             return NULL;
@@ -2359,18 +2468,17 @@ static void* crossVerifyAnnotationItem(const CheckState* state, void* ptr) {
 typedef void* ItemVisitorFunction(const CheckState* state, void* ptr);
 
 /*
- * Iterate over all the items in a section, optionally updating the
- * data map (done if mapType is passed as non-negative). The section
- * must consist of concatenated items of the same type.
+ * Iterate over "count" concatenated items of the same type, optionally
+ * updating the data map (done if mapType is passed as non-negative).
+ * The first item is compared against state->previousItem, so this can
+ * pick up part way through a section.
  */
-static bool iterateSectionWithOptionalUpdate(CheckState* state,
-        u4 offset, u4 count, ItemVisitorFunction* func, u4 alignment,
-        u4* nextOffset, int mapType) {
+static bool iterateItems(CheckState* state, u4 offset, u4 count,
+        ItemVisitorFunction* func, u4 alignment, u4* nextOffset,
+        int mapType) {
     u4 alignmentMask = alignment - 1;
     u4 i;
 
-    state->previousItem = NULL;
-
     for (i = 0; i < count; i++) {
         u4 newOffset = (offset + alignmentMask) & ~alignmentMask;
         u1* ptr = filePointer(state, newOffset);
@@ -2418,6 +2526,19 @@ static bool iterateSectionWithOptionalUpdate(CheckState* state,
     return true;
 }
 
+/*
+ * Iterate over all the items in a section, optionally updating the
+ * data map (done if mapType is passed as non-negative). The section
+ * must consist of concatenated items of the same type.
+ */
+static bool iterateSectionWithOptionalUpdate(CheckState* state,
+        u4 offset, u4 count, ItemVisitorFunction* func, u4 alignment,
+        u4* nextOffset, int mapType) {
+    state->previousItem = NULL;
+    return iterateItems(state, offset, count, func, alignment, nextOffset,
+            mapType);
+}
+
 /*
  * Iterate over all the items in a section. The section must consist of
  * concatenated items of the same type. This variant will not update the data
@@ -2430,12 +2551,11 @@ static bool iterateSection(CheckState* state, u4 offset, u4 count,
 }
 
 /*
- * Like iterateSection(), but also check that the offset and count match
- * a given pair of expected values.
+ * Check that a section's offset and count match a given pair of expected
+ * values.
  */
-static bool checkBoundsAndIterateSection(CheckState* state,
-        u4 offset, u4 count, u4 expectedOffset, u4 expectedCount,
-        ItemVisitorFunction* func, u4 alignment, u4* nextOffset) {
+static bool checkSectionBounds(u4 offset, u4 count, u4 expectedOffset,
+        u4 expectedCount) {
     if (offset != expectedOffset) {
         LOGE("Bogus offset for section: got 0x%x; expected 0x%x\n",
                 offset, expectedOffset);
@@ -2448,6 +2568,20 @@ static bool checkBoundsAndIterateSection(CheckState* state,
         return false;
     }
 
+    return true;
+}
+
+/*
+ * Like iterateSection(), but also check that the offset and count match
+ * a given pair of expected values.
+ */
+static bool checkBoundsAndIterateSection(CheckState* state,
+        u4 offset, u4 count, u4 expectedOffset, u4 expectedCount,
+        ItemVisitorFunction* func, u4 alignment, u4* nextOffset) {
+    if (!checkSectionBounds(offset, count, expectedOffset, expectedCount)) {
+        return false;
+    }
+
     return iterateSection(state, offset, count, func, alignment, nextOffset);
 }
 
@@ -2500,6 +2634,8 @@ static bool swapEverythingButHeaderAndMap(CheckState* state,
         u4 sectionOffset = item->offset;
         u4 sectionCount = item->size;
         u2 type = item->type;
+        DexSectionTiming* pTiming = getSectionTiming(state, item);
+        u8 startTime = (pTiming != NULL) ? getTimeNsec() : 0;
 
         if (lastOffset < sectionOffset) {
             CHECK_OFFSET_RANGE(lastOffset, sectionOffset);
@@ -2652,6 +2788,10 @@ static bool swapEverythingButHeaderAndMap(CheckState* state,
             LOGE("Swap of section type %04x failed\n", type);
         }
 
+        if (pTiming != NULL) {
+            pTiming->intraNsec = getTimeNsec() - startTime;
+        }
+
         item++;
     }
 
@@ -2672,6 +2812,8 @@ static bool crossVerifyEverything(CheckState* state, DexMapList* pMap)
     while (okay && count--) {
         u4 sectionOffset = item->offset;
         u4 sectionCount = item->size;
+        DexSectionTiming* pTiming = getSectionTiming(state, item);
+        u8 startTime = (pTiming != NULL) ? getTimeNsec() : 0;
 
         switch (item->type) {
             case kDexTypeHeaderItem:
@@ -2754,30 +2896,656 @@ static bool crossVerifyEverything(CheckState* state, DexMapList* pMap)
                     item->type);
         }
 
+        if (pTiming != NULL) {
+            pTiming->crossNsec = getTimeNsec() - startTime;
+        }
+
         item++;
     }
 
     return okay;
 }
 
+/*
+ * Sections are split into chunks of this many items for the parallel
+ * verifier.
+ */
+#define kVerifyChunkItems   1024
+
+/*
+ * A run of items from one map section, verified on its own by
+ * verifyChunk().
+ */
+typedef struct VerifyChunk {
+    const DexMapItem* item;         // the section
+    u4                offset;       // of the first item
+    u4                count;        // number of items
+    const void*       previousItem; // the item before "offset", or NULL
+    DexDataMap*       pDataMap;     // data items found (intra-item pass)
+    bool              okay;
+    u4                endOffset;    // just past the last item
+    u8                nsec;         // time spent, if timings were requested
+} VerifyChunk;
+
+/*
+ * The chunks for one pass of the parallel verifier.
+ */
+typedef struct VerifyPlan {
+    const CheckState* state;        // shared by all the workers; read-only
+    bool              cross;        // cross-item pass?
+    VerifyChunk*      chunks;       // in map order
+    u4                numChunks;
+    u4                maxChunks;
+    u4                firstChunk;   // of the current sysRunParallel() call
+} VerifyPlan;
+
+/*
+ * Get the size of the items in a fixed-size section, or 0 if the items
+ * in sections of this type can vary in size.
+ */
+static u4 fixedItemSize(u2 type) {
+    switch (type) {
+        case kDexTypeStringIdItem:  return sizeof(DexStringId);
+        case kDexTypeTypeIdItem:    return sizeof(DexTypeId);
+        case kDexTypeProtoIdItem:   return sizeof(DexProtoId);
+        case kDexTypeFieldIdItem:   return sizeof(DexFieldId);
+        case kDexTypeMethodIdItem:  return sizeof(DexMethodId);
+        case kDexTypeClassDefItem:  return sizeof(DexClassDef);
+        default:                    return 0;
+    }
+}
+
+/*
+ * Get the functions that verify the items of a section, the same ones
+ * swapEverythingButHeaderAndMap() and crossVerifyEverything() use.
+ * "*pCrossFunc" is set to NULL if the section doesn't need cross-item
+ * verification.  Returns false for the header and the map, which aren't
+ * lists of items, and for unknown types.
+ */
+static bool getSectionVisitors(u2 type, ItemVisitorFunction** pIntraFunc,
+        ItemVisitorFunction** pCrossFunc, u4* pAlignment) {
+    ItemVisitorFunction* intraFunc;
+    ItemVisitorFunction* crossFunc = NULL;
+    u4 alignment = sizeof(u4);
+
+    switch (type) {
+        case kDexTypeStringIdItem:
+            intraFunc = swapStringIdItem;
+            crossFunc = crossVerifyStringIdItem;
+            break;
+        case kDexTypeTypeIdItem:
+            intraFunc = swapTypeIdItem;
+            crossFunc = crossVerifyTypeIdItem;
+            break;
+        case kDexTypeProtoIdItem:
+            intraFunc = swapProtoIdItem;
+            crossFunc = crossVerifyProtoIdItem;
+            break;
+        case kDexTypeFieldIdItem:
+            intraFunc = swapFieldIdItem;
+            crossFunc = crossVerifyFieldIdItem;
+            break;
+        case kDexTypeMethodIdItem:
+            intraFunc = swapMethodIdItem;
+            crossFunc = crossVerifyMethodIdItem;
+            break;
+        case kDexTypeClassDefItem:
+            intraFunc = swapClassDefItem;
+            crossFunc = crossVerifyClassDefItem;
+            break;
+        case kDexTypeTypeList:
+            intraFunc = swapTypeList;
+            break;
+        case kDexTypeAnnotationSetRefList:
+            intraFunc = swapAnnotationSetRefList;
+            crossFunc = crossVerifyAnnotationSetRefList;
+            break;
+        case kDexTypeAnnotationSetItem:
+            intraFunc = swapAnnotationSetItem;
+            crossFunc = crossVerifyAnnotationSetItem;
+            break;
+        case kDexTypeClassDataItem:
+            intraFunc = intraVerifyClassDataItem;
+            crossFunc = crossVerifyClassDataItem;
+            alignment = sizeof(u1);
+            break;
+        case kDexTypeCodeItem:
+            intraFunc = swapCodeItem;
+            break;
+        case kDexTypeStringDataItem:
+            intraFunc = intraVerifyStringDataItem;
+            alignment = sizeof(u1);
+            break;
+        case kDexTypeDebugInfoItem:
+            intraFunc = intraVerifyDebugInfoItem;
+            alignment = sizeof(u1);
+            break;
+        case kDexTypeAnnotationItem:
+            intraFunc = intraVerifyAnnotationItem;
+            alignment = sizeof(u1);
+            break;
+        case kDexTypeEncodedArrayItem:
+            intraFunc = intraVerifyEncodedArrayItem;
+            alignment = sizeof(u1);
+            break;
+        case kDexTypeAnnotationsDirectoryItem:
+            intraFunc = swapAnnotationsDirectoryItem;
+            crossFunc = crossVerifyAnnotationsDirectoryItem;
+            break;
+        default:
+            return false;
+    }
+
+    *pIntraFunc = intraFunc;
+    *pCrossFunc = crossFunc;
+    *pAlignment = alignment;
+    return true;
+}
+
+/*
+ * Add a chunk to a plan.  Returns false if we run out of memory.
+ */
+static bool addChunk(VerifyPlan* plan, const DexMapItem* item, u4 offset,
+        u4 count, const void* previousItem) {
+    VerifyChunk* chunk;
+
+    if (plan->numChunks == plan->maxChunks) {
+        u4 newMax = (plan->maxChunks == 0) ? 32 : plan->maxChunks * 2;
+        VerifyChunk* newChunks = (VerifyChunk*)
+            realloc(plan->chunks, newMax * sizeof(VerifyChunk));
+        if (newChunks == NULL) {
+            LOGE("Unable to allocate verifier chunks\n");
+            return false;
+        }
+        plan->chunks = newChunks;
+        plan->maxChunks = newMax;
+    }
+
+    chunk = &plan->chunks[plan->numChunks++];
+    memset(chunk, 0, sizeof(*chunk));
+    chunk->item = item;
+    chunk->offset = offset;
+    chunk->count = count;
+    chunk->previousItem = previousItem;
+    return true;
+}
+
+/*
+ * Split a section of fixed-size items into chunks.  The items don't have
+ * to be valid yet; a section that runs off the end of the file is left
+ * in one piece, so it fails the same way it would sequentially.
+ */
+static bool addFixedSizeChunks(VerifyPlan* plan, const DexMapItem* item) {
+    const CheckState* state = plan->state;
+    u4 itemSize = fixedItemSize(item->type);
+    u4 offset = item->offset;
+    u4 left = item->size;
+
+    if ((u8) offset + (u8) left * itemSize > state->fileLen) {
+        return addChunk(plan, item, offset, left, NULL);
+    }
+
+    while (left > 0) {
+        u4 count = (left < kVerifyChunkItems) ? left : kVerifyChunkItems;
+        const void* previousItem = (offset == item->offset) ?
+            NULL : filePointer(state, offset - itemSize);
+
+        if (!addChunk(plan, item, offset, count, previousItem)) {
+            return false;
+        }
+        offset += count * itemSize;
+        left -= count;
+    }
+
+    return true;
+}
+
+/*
+ * Split the string_data_item section into chunks, finding where they
+ * start with a quick scan for each item's terminating NUL.  The scan
+ * trusts nothing but the file bounds: once it runs into trouble the rest
+ * of the section goes into one chunk, and verifying that chunk reports
+ * the problem.  A valid item never has a NUL before its end, so on a
+ * good file the chunks split exactly at item boundaries.
+ */
+static bool addStringDataChunks(VerifyPlan* plan, const DexMapItem* item) {
+    const CheckState* state = plan->state;
+    const u1* fileEnd = state->fileEnd;
+    u4 offset = item->offset;
+    u4 left = item->size;
+
+    while (left > kVerifyChunkItems) {
+        const u1* data = filePointer(state, offset);
+        bool okay = true;
+        u4 i;
+
+        for (i = 0; okay && i < kVerifyChunkItems; i++) {
+            readAndVerifyUnsignedLeb128(&data, fileEnd, &okay);
+            if (okay) {
+                data = memchr(data, '\0', fileEnd - data);
+                if (data == NULL) {
+                    okay = false;
+                } else {
+                    data++;
+                }
+            }
+        }
+
+        if (!okay) {
+            break;
+        }
+
+        if (!addChunk(plan, item, offset, kVerifyChunkItems, NULL)) {
+            return false;
+        }
+        offset = fileOffset(state, data);
+        left -= kVerifyChunkItems;
+    }
+
+    return addChunk(plan, item, offset, left, NULL);
+}
+
+/*
+ * Find the index of the data map entry at "offset".  Returns -1 if there
+ * isn't one.
+ */
+static int findDataMapIndex(const DexDataMap* pDataMap, u4 offset) {
+    // Note: Signed type is important for max and min.
+    int min = 0;
+    int max = pDataMap->count - 1;
+
+    while (max >= min) {
+        int guessIdx = (min + max) >> 1;
+        u4 guess = pDataMap->offsets[guessIdx];
+
+        if (offset < guess) {
+            max = guessIdx - 1;
+        } else if (offset > guess) {
+            min = guessIdx + 1;
+        } else {
+            return guessIdx;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Split an already intra-verified data section into chunks, at the item
+ * offsets recorded in the data map.  The section's items are found by
+ * looking up its first one, since not every data section (the map_list,
+ * for one) has entries in the map.
+ */
+static bool addDataMapChunks(VerifyPlan* plan, const DexMapItem* item) {
+    const DexDataMap* pDataMap = plan->state->pDataMap;
+    int firstIdx = findDataMapIndex(pDataMap, item->offset);
+    u4 left = item->size;
+    u4 idx;
+
+    if (left == 0) {
+        return true;
+    }
+    if (firstIdx < 0 || pDataMap->count - firstIdx < left
+            || pDataMap->types[firstIdx] != item->type) {
+        LOGE("No data map entries for section of type %x @ 0x%x\n",
+                item->type, item->offset);
+        return false;
+    }
+    idx = firstIdx;
+
+    while (left > 0) {
+        u4 count = (left < kVerifyChunkItems) ? left : kVerifyChunkItems;
+
+        if (!addChunk(plan, item, pDataMap->offsets[idx], count, NULL)) {
+            return false;
+        }
+        idx += count;
+        left -= count;
+    }
+
+    return true;
+}
+
+/*
+ * Verify one chunk.  This is a SysWorkFunc for sysRunParallel(); each
+ * call works on its own copy of the CheckState, and reports back only
+ * through its chunk.
+ */
+static void verifyChunk(void* arg, int idx) {
+    VerifyPlan* plan = (VerifyPlan*) arg;
+    VerifyChunk* chunk = &plan->chunks[plan->firstChunk + idx];
+    u2 type = chunk->item->type;
+    CheckState state = *plan->state;
+    ItemVisitorFunction* intraFunc;
+    ItemVisitorFunction* crossFunc;
+    u4 alignment;
+    u8 startTime = (state.pTimings != NULL) ? getTimeNsec() : 0;
+    bool okay;
+
+    state.pTimings = NULL;
+    state.previousItem = chunk->previousItem;
+
+    if (type == kDexTypeHeaderItem) {
+        okay = checkHeaderSection(&state, chunk->offset, chunk->count,
+                &chunk->endOffset);
+    } else if (type == kDexTypeMapList) {
+        okay = checkMapSection(&state, chunk->offset, chunk->count,
+                &chunk->endOffset);
+    } else if (!getSectionVisitors(type, &intraFunc, &crossFunc,
+                    &alignment)) {
+        LOGE("Unknown map item type %04x\n", type);
+        okay = false;
+    } else if (!plan->cross) {
+        state.pDataMap = chunk->pDataMap;
+        okay = iterateItems(&state, chunk->offset, chunk->count, intraFunc,
+                alignment, &chunk->endOffset,
+                (chunk->pDataMap != NULL) ? type : -1);
+    } else if (type == kDexTypeClassDefItem) {
+        // Allocate (on the stack) the "observed class_def" bits.
+        size_t arraySize = calcDefinedClassBitsSize(&state);
+        u4 definedClassBits[arraySize];
+        memset(definedClassBits, 0, arraySize * sizeof(u4));
+        state.pDefinedClassBits = definedClassBits;
+
+        okay = iterateItems(&state, chunk->offset, chunk->count, crossFunc,
+                alignment, &chunk->endOffset, -1);
+    } else {
+        okay = iterateItems(&state, chunk->offset, chunk->count, crossFunc,
+                alignment, &chunk->endOffset, -1);
+    }
+
+    chunk->okay = okay;
+    if (startTime != 0) {
+        chunk->nsec = getTimeNsec() - startTime;
+    }
+}
+
+/*
+ * Free the chunks of a plan.
+ */
+static void freeVerifyPlan(VerifyPlan* plan) {
+    u4 i;
+
+    for (i = 0; i < plan->numChunks; i++) {
+        dexDataMapFree(plan->chunks[i].pDataMap);
+    }
+    free(plan->chunks);
+}
+
+/*
+ * Parallel version of swapEverythingButHeaderAndMap().  Each section
+ * starts at its map offset, so the sections can all be verified at once,
+ * and big sections of fixed-size items and string data are split into
+ * chunks as well.  Afterwards the checks between sections (padding,
+ * overlap) are made in map order, and the data items each chunk found
+ * are added to the data map.
+ */
+static bool swapEverythingInParallel(CheckState* state, DexMapList* pMap,
+        int numThreads) {
+    const DexMapItem* item = pMap->list;
+    u4 dataStart = state->pHeader->dataOff;
+    u4 dataEnd = dataStart + state->pHeader->dataSize;
+    VerifyPlan plan;
+    u4 lastOffset = 0;
+    u4 chunkIdx = 0;
+    bool okay = true;
+    u4 i;
+
+    memset(&plan, 0, sizeof(plan));
+    plan.state = state;
+    plan.cross = false;
+
+    for (i = 0; okay && i < pMap->size; i++, item++) {
+        u4 sectionOffset = item->offset;
+        u4 sectionCount = item->size;
+
+        switch (item->type) {
+            case kDexTypeStringIdItem:
+                okay = checkSectionBounds(sectionOffset, sectionCount,
+                        state->pHeader->stringIdsOff,
+                        state->pHeader->stringIdsSize);
+                break;
+            case kDexTypeTypeIdItem:
+                okay = checkSectionBounds(sectionOffset, sectionCount,
+                        state->pHeader->typeIdsOff,
+                        state->pHeader->typeIdsSize);
+                break;
+            case kDexTypeProtoIdItem:
+                okay = checkSectionBounds(sectionOffset, sectionCount,
+                        state->pHeader->protoIdsOff,
+                        state->pHeader->protoIdsSize);
+                break;
+            case kDexTypeFieldIdItem:
+                okay = checkSectionBounds(sectionOffset, sectionCount,
+                        state->pHeader->fieldIdsOff,
+                        state->pHeader->fieldIdsSize);
+                break;
+            case kDexTypeMethodIdItem:
+                okay = checkSectionBounds(sectionOffset, sectionCount,
+                        state->pHeader->methodIdsOff,
+                        state->pHeader->methodIdsSize);
+                break;
+            case kDexTypeClassDefItem:
+                okay = checkSectionBounds(sectionOffset, sectionCount,
+                        state->pHeader->classDefsOff,
+                        state->pHeader->classDefsSize);
+                break;
+            default:
+                if (isDataSectionType(item->type)
+                        && ((sectionOffset < dataStart)
+                                || (sectionOffset >= dataEnd))) {
+                    LOGE("Bogus offset for data subsection: 0x%x\n",
+                            sectionOffset);
+                    okay = false;
+                }
+                break;
+        }
+
+        if (!okay) {
+            LOGE("Swap of section type %04x failed\n", item->type);
+        } else if (fixedItemSize(item->type) != 0) {
+            okay = addFixedSizeChunks(&plan, item);
+        } else if (item->type == kDexTypeStringDataItem) {
+            okay = addStringDataChunks(&plan, item);
+        } else {
+            okay = addChunk(&plan, item, sectionOffset, sectionCount, NULL);
+        }
+    }
+
+    for (i = 0; okay && i < plan.numChunks; i++) {
+        VerifyChunk* chunk = &plan.chunks[i];
+
+        if (isDataSectionType(chunk->item->type)) {
+            chunk->pDataMap = dexDataMapAlloc(chunk->count);
+            if (chunk->pDataMap == NULL) {
+                LOGE("Unable to allocate data map (size 0x%x)\n",
+                        chunk->count);
+                okay = false;
+            }
+        }
+    }
+
+    if (!okay) {
+        goto bail;
+    }
+
+    sysRunParallel(plan.numChunks, numThreads, verifyChunk, &plan);
+
+    item = pMap->list;
+    for (i = 0; okay && i < pMap->size; i++, item++) {
+        u4 sectionOffset = item->offset;
+        DexSectionTiming* pTiming = getSectionTiming(state, item);
+        bool first = true;
+
+        if (lastOffset < sectionOffset) {
+            const u1* ptr = filePointer(state, lastOffset);
+            okay = checkPtrRange(state, ptr,
+                    filePointer(state, sectionOffset),
+                    "lastOffset..sectionOffset");
+            while (okay && lastOffset < sectionOffset) {
+                if (*ptr != '\0') {
+                    LOGE("Non-zero padding 0x%02x before section start @ %x\n",
+                            *ptr, lastOffset);
+                    okay = false;
+                    break;
+                }
+                ptr++;
+                lastOffset++;
+            }
+        } else if (lastOffset > sectionOffset) {
+            LOGE("Section overlap or out-of-order map: %x, %x\n",
+                    lastOffset, sectionOffset);
+            okay = false;
+        }
+
+        for (; okay && chunkIdx < plan.numChunks
+                && plan.chunks[chunkIdx].item == item; chunkIdx++) {
+            const VerifyChunk* chunk = &plan.chunks[chunkIdx];
+            u4 j;
+
+            if (!chunk->okay) {
+                okay = false;
+            } else if (!first && chunk->offset != lastOffset) {
+                LOGE("Chunk of section type %04x @ 0x%x doesn't follow "
+                        "0x%x\n", item->type, chunk->offset, lastOffset);
+                okay = false;
+            } else if (chunk->pDataMap != NULL) {
+                for (j = 0; j < chunk->pDataMap->count; j++) {
+                    dexDataMapAdd(state->pDataMap,
+                            chunk->pDataMap->offsets[j],
+                            chunk->pDataMap->types[j]);
+                }
+            }
+
+            if (pTiming != NULL) {
+                pTiming->intraNsec += chunk->nsec;
+            }
+            lastOffset = chunk->endOffset;
+            first = false;
+        }
+
+        if (okay && isDataSectionType(item->type) && lastOffset > dataEnd) {
+            LOGE("Out-of-bounds end of data subsection: 0x%x\n", lastOffset);
+            okay = false;
+        }
+
+        if (!okay) {
+            LOGE("Swap of section type %04x failed\n", item->type);
+        }
+    }
+
+bail:
+    freeVerifyPlan(&plan);
+    return okay;
+}
+
+/*
+ * Parallel version of crossVerifyEverything().  By now every item has
+ * been verified and the data map is complete, so sections of fixed-size
+ * items are split into chunks by position, and data sections by the item
+ * offsets in the data map.  The class_defs are done in one piece, since
+ * each is checked against the ones before it.
+ *
+ * Checking a section trusts the references in the sections before it
+ * (a field_id's type_id is only safe to follow once the type_ids are
+ * known good), so the sections are still taken one at a time, in map
+ * order, and only the chunks within a section run in parallel.
+ */
+static bool crossVerifyInParallel(CheckState* state, DexMapList* pMap,
+        int numThreads) {
+    const DexMapItem* item = pMap->list;
+    VerifyPlan plan;
+    u4 chunkIdx = 0;
+    bool okay = true;
+    u4 i;
+
+    memset(&plan, 0, sizeof(plan));
+    plan.state = state;
+    plan.cross = true;
+
+    for (i = 0; okay && i < pMap->size; i++, item++) {
+        ItemVisitorFunction* intraFunc;
+        ItemVisitorFunction* crossFunc;
+        u4 alignment;
+
+        if (!getSectionVisitors(item->type, &intraFunc, &crossFunc,
+                        &alignment) || crossFunc == NULL) {
+            // header, map, or a section that needs no cross-verification
+        } else if (item->type == kDexTypeClassDefItem) {
+            okay = addChunk(&plan, item, item->offset, item->size, NULL);
+        } else if (fixedItemSize(item->type) != 0) {
+            okay = addFixedSizeChunks(&plan, item);
+        } else {
+            okay = addDataMapChunks(&plan, item);
+        }
+    }
+
+    if (!okay) {
+        goto bail;
+    }
+
+    item = pMap->list;
+    for (i = 0; okay && i < pMap->size; i++, item++) {
+        DexSectionTiming* pTiming = getSectionTiming(state, item);
+        u4 endIdx = chunkIdx;
+
+        while (endIdx < plan.numChunks && plan.chunks[endIdx].item == item) {
+            endIdx++;
+        }
+        plan.firstChunk = chunkIdx;
+        sysRunParallel(endIdx - chunkIdx, numThreads, verifyChunk, &plan);
+
+        for (; chunkIdx < endIdx
+                && plan.chunks[chunkIdx].item == item; chunkIdx++) {
+            const VerifyChunk* chunk = &plan.chunks[chunkIdx];
+
+            if (!chunk->okay) {
+                okay = false;
+            }
+            if (pTiming != NULL) {
+                pTiming->crossNsec += chunk->nsec;
+            }
+        }
+
+        if (!okay) {
+            LOGE("Cross-item verify of section type %04x failed\n",
+                    item->type);
+        }
+    }
+
+bail:
+    freeVerifyPlan(&plan);
+    return okay;
+}
+
 /*
  * Fix the byte ordering of all fields in the DEX file, and do structural
- * verification.
+ * verification, optionally timing each step.  With more than one thread,
+ * the items are verified in parallel; that's only safe when nothing needs
+ * swapping, since the header and map are read by every thread.
  *
  * While we're at it, make sure that the file offsets all refer to locations
  * within the file.
  *
  * Returns 0 on success, nonzero on failure.
  */
-int dexFixByteOrdering(u1* addr, int len)
+static int swapAndVerify(u1* addr, int len, int numThreads,
+        DexVerifyTimings* pTimings)
 {
     DexHeader* pHeader;
     CheckState state;
     bool okay = true;
+    u8 startTime = 0;
 
     memset(&state, 0, sizeof(state));
     LOGV("+++ swapping and verifying\n");
 
+    if (pTimings != NULL) {
+        memset(pTimings, 0, sizeof(*pTimings));
+        state.pTimings = pTimings;
+        startTime = getTimeNsec();
+    }
+
     /*
      * Start by verifying the magic number.  The caller verified that "len"
      * says we have at least a header's worth of data.
@@ -2823,19 +3591,22 @@ int dexFixByteOrdering(u1* addr, int len)
          * This might be a big-endian system, so we need to do this before
          * we byte-swap the header.
          */
-        uLong adler = adler32(0L, Z_NULL, 0);
         const int nonSum = sizeof(pHeader->magic) + sizeof(pHeader->checksum);
         u4 storedFileSize = SWAP4(pHeader->fileSize);
         u4 expectedChecksum = SWAP4(pHeader->checksum);
-
-        adler = adler32(adler, ((const u1*) pHeader) + nonSum,
-                    storedFileSize - nonSum);
+        u4 adler = dexAdler32Parallel(kAdler32Init,
+                ((const u1*) pHeader) + nonSum, storedFileSize - nonSum,
+                numThreads);
 
         if (adler != expectedChecksum) {
-            LOGE("ERROR: bad checksum (%08lx, expected %08x)\n",
+            LOGE("ERROR: bad checksum (%08x, expected %08x)\n",
                 adler, expectedChecksum);
             okay = false;
         }
+
+        if (pTimings != NULL) {
+            pTimings->checksumNsec = getTimeNsec() - startTime;
+        }
     }
 
     if (okay) {
@@ -2877,12 +3648,30 @@ int dexFixByteOrdering(u1* addr, int len)
             DexMapList* pDexMap = (DexMapList*) (addr + pHeader->mapOff);
 
             okay = okay && swapMap(&state, pDexMap);
-            okay = okay && swapEverythingButHeaderAndMap(&state, pDexMap);
+            if (numThreads > 1) {
+                okay = okay
+                    && swapEverythingInParallel(&state, pDexMap, numThreads);
+            } else {
+                okay = okay && swapEverythingButHeaderAndMap(&state, pDexMap);
+            }
+
+            /*
+             * Every data item is in the map now, and cross-verification
+             * looks up nearly every offset it sees, so index it.
+             */
+            if (okay) {
+                dexDataMapBuildIndex(state.pDataMap);
+            }
 
             dexFileSetupBasicPointers(&dexFile, addr);
             state.pDexFile = &dexFile;
 
-            okay = okay && crossVerifyEverything(&state, pDexMap);
+            if (numThreads > 1) {
+                okay = okay
+                    && crossVerifyInParallel(&state, pDexMap, numThreads);
+            } else {
+                okay = okay && crossVerifyEverything(&state, pDexMap);
+            }
         } else {
             LOGE("ERROR: No map found; impossible to byte-swap and verify");
             okay = false;
@@ -2897,5 +3686,33 @@ int dexFixByteOrdering(u1* addr, int len)
         dexDataMapFree(state.pDataMap);
     }
 
+    if (pTimings != NULL) {
+        pTimings->totalNsec = getTimeNsec() - startTime;
+    }
+
     return !okay;       // 0 == success
 }
+
+/*
+ * Fix the byte ordering of all fields in the DEX file, and do structural
+ * verification.
+ */
+int dexFixByteOrdering(u1* addr, int len)
+{
+    return swapAndVerify(addr, len, 1, NULL);
+}
+
+/*
+ * Verify a DEX file without changing it.
+ */
+int dexVerifyReadOnly(const u1* addr, int len, int numThreads,
+    DexVerifyTimings* pTimings)
+{
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    /* the SWAP_* macros don't write anything on this host */
+    return swapAndVerify((u1*) addr, len, numThreads, pTimings);
+#else
+    LOGE("ERROR: read-only verification needs a little-endian host\n");
+    return -1;
+#endif
+}
@@ -23,1180 +23,678 @@
 
 
 /*
- * Generate a table that holds the width of all instructions.
+ * Everything we know about each opcode, in opcode order:
  *
- * Standard instructions have positive values, optimizer instructions
- * have negative values, unimplemented instructions have a width of zero.
+ *   _(opcode, name, width, format, index type, flags)
  *
- * I'm doing it with a giant switch statement because it's easier to
- * maintain and update than a static table with 256 unadorned integers,
- * and if we're missing a case gcc emits a "warning: enumeration value not
- * handled" message.
+ * Widths are in 16-bit code units.  Standard instructions have positive
+ * values, optimizer instructions have negative values, unimplemented
+ * instructions have a width of zero.  The flags are used by the verifier
+ * to determine where control can flow to next.
  *
- * (To save space in the binary we could generate a static table with a
- * command-line utility.)
+ * This is the only place the per-opcode attributes are spelled out; the
+ * tables below are all expanded from it at compile time, so they cost
+ * nothing at startup and live in read-only, shareable pages.  An opcode
+ * left out of the list gets zero in every table, i.e. "not defined".
  */
-InstructionWidth* dexCreateInstrWidthTable(void)
-{
-#ifdef __ARM_ARCH_7A__
-    /* hack to work around mysterious problem on emulator */
-    LOGD("creating instr width table\n");
-#endif
-    InstructionWidth* instrWidth;
-    int i;
-
-    instrWidth = malloc(sizeof(InstructionWidth) * kNumDalvikInstructions);
-    if (instrWidth == NULL)
-        return NULL;
-
-    for (i = 0; i < kNumDalvikInstructions; i++) {
-        OpCode opc = (OpCode) i;
-        int width = 0;
-
-        switch (opc) {
-        case OP_NOP:    /* note data for e.g. switch-* encoded "inside" a NOP */
-        case OP_MOVE:
-        case OP_MOVE_WIDE:
-        case OP_MOVE_OBJECT:
-        case OP_MOVE_RESULT:
-        case OP_MOVE_RESULT_WIDE:
-        case OP_MOVE_RESULT_OBJECT:
-        case OP_MOVE_EXCEPTION:
-        case OP_RETURN_VOID:
-        case OP_RETURN:
-        case OP_RETURN_WIDE:
-        case OP_RETURN_OBJECT:
-        case OP_CONST_4:
-        case OP_MONITOR_ENTER:
-        case OP_MONITOR_EXIT:
-        case OP_ARRAY_LENGTH:
-        case OP_THROW:
-        case OP_GOTO:
-        case OP_NEG_INT:
-        case OP_NOT_INT:
-        case OP_NEG_LONG:
-        case OP_NOT_LONG:
-        case OP_NEG_FLOAT:
-        case OP_NEG_DOUBLE:
-        case OP_INT_TO_LONG:
-        case OP_INT_TO_FLOAT:
-        case OP_INT_TO_DOUBLE:
-        case OP_LONG_TO_INT:
-        case OP_LONG_TO_FLOAT:
-        case OP_LONG_TO_DOUBLE:
-        case OP_FLOAT_TO_INT:
-        case OP_FLOAT_TO_LONG:
-        case OP_FLOAT_TO_DOUBLE:
-        case OP_DOUBLE_TO_INT:
-        case OP_DOUBLE_TO_LONG:
-        case OP_DOUBLE_TO_FLOAT:
-        case OP_INT_TO_BYTE:
-        case OP_INT_TO_CHAR:
-        case OP_INT_TO_SHORT:
-        case OP_ADD_INT_2ADDR:
-        case OP_SUB_INT_2ADDR:
-        case OP_MUL_INT_2ADDR:
-        case OP_DIV_INT_2ADDR:
-        case OP_REM_INT_2ADDR:
-        case OP_AND_INT_2ADDR:
-        case OP_OR_INT_2ADDR:
-        case OP_XOR_INT_2ADDR:
-        case OP_SHL_INT_2ADDR:
-        case OP_SHR_INT_2ADDR:
-        case OP_USHR_INT_2ADDR:
-        case OP_ADD_LONG_2ADDR:
-        case OP_SUB_LONG_2ADDR:
-        case OP_MUL_LONG_2ADDR:
-        case OP_DIV_LONG_2ADDR:
-        case OP_REM_LONG_2ADDR:
-        case OP_AND_LONG_2ADDR:
-        case OP_OR_LONG_2ADDR:
-        case OP_XOR_LONG_2ADDR:
-        case OP_SHL_LONG_2ADDR:
-        case OP_SHR_LONG_2ADDR:
-        case OP_USHR_LONG_2ADDR:
-        case OP_ADD_FLOAT_2ADDR:
-        case OP_SUB_FLOAT_2ADDR:
-        case OP_MUL_FLOAT_2ADDR:
-        case OP_DIV_FLOAT_2ADDR:
-        case OP_REM_FLOAT_2ADDR:
-        case OP_ADD_DOUBLE_2ADDR:
-        case OP_SUB_DOUBLE_2ADDR:
-        case OP_MUL_DOUBLE_2ADDR:
-        case OP_DIV_DOUBLE_2ADDR:
-        case OP_REM_DOUBLE_2ADDR:
-            width = 1;
-            break;
-
-        case OP_MOVE_FROM16:
-        case OP_MOVE_WIDE_FROM16:
-        case OP_MOVE_OBJECT_FROM16:
-        case OP_CONST_16:
-        case OP_CONST_HIGH16:
-        case OP_CONST_WIDE_16:
-        case OP_CONST_WIDE_HIGH16:
-        case OP_CONST_STRING:
-        case OP_CONST_CLASS:
-        case OP_CHECK_CAST:
-        case OP_INSTANCE_OF:
-        case OP_NEW_INSTANCE:
-        case OP_NEW_ARRAY:
-        case OP_CMPL_FLOAT:
-        case OP_CMPG_FLOAT:
-        case OP_CMPL_DOUBLE:
-        case OP_CMPG_DOUBLE:
-        case OP_CMP_LONG:
-        case OP_GOTO_16:
-        case OP_IF_EQ:
-        case OP_IF_NE:
-        case OP_IF_LT:
-        case OP_IF_GE:
-        case OP_IF_GT:
-        case OP_IF_LE:
-        case OP_IF_EQZ:
-        case OP_IF_NEZ:
-        case OP_IF_LTZ:
-        case OP_IF_GEZ:
-        case OP_IF_GTZ:
-        case OP_IF_LEZ:
-        case OP_AGET:
-        case OP_AGET_WIDE:
-        case OP_AGET_OBJECT:
-        case OP_AGET_BOOLEAN:
-        case OP_AGET_BYTE:
-        case OP_AGET_CHAR:
-        case OP_AGET_SHORT:
-        case OP_APUT:
-        case OP_APUT_WIDE:
-        case OP_APUT_OBJECT:
-        case OP_APUT_BOOLEAN:
-        case OP_APUT_BYTE:
-        case OP_APUT_CHAR:
-        case OP_APUT_SHORT:
-        case OP_IGET:
-        case OP_IGET_WIDE:
-        case OP_IGET_OBJECT:
-        case OP_IGET_BOOLEAN:
-        case OP_IGET_BYTE:
-        case OP_IGET_CHAR:
-        case OP_IGET_SHORT:
-        case OP_IPUT:
-        case OP_IPUT_WIDE:
-        case OP_IPUT_OBJECT:
-        case OP_IPUT_BOOLEAN:
-        case OP_IPUT_BYTE:
-        case OP_IPUT_CHAR:
-        case OP_IPUT_SHORT:
-        case OP_SGET:
-        case OP_SGET_WIDE:
-        case OP_SGET_OBJECT:
-        case OP_SGET_BOOLEAN:
-        case OP_SGET_BYTE:
-        case OP_SGET_CHAR:
-        case OP_SGET_SHORT:
-        case OP_SPUT:
-        case OP_SPUT_WIDE:
-        case OP_SPUT_OBJECT:
-        case OP_SPUT_BOOLEAN:
-        case OP_SPUT_BYTE:
-        case OP_SPUT_CHAR:
-        case OP_SPUT_SHORT:
-        case OP_ADD_INT:
-        case OP_SUB_INT:
-        case OP_MUL_INT:
-        case OP_DIV_INT:
-        case OP_REM_INT:
-        case OP_AND_INT:
-        case OP_OR_INT:
-        case OP_XOR_INT:
-        case OP_SHL_INT:
-        case OP_SHR_INT:
-        case OP_USHR_INT:
-        case OP_ADD_LONG:
-        case OP_SUB_LONG:
-        case OP_MUL_LONG:
-        case OP_DIV_LONG:
-        case OP_REM_LONG:
-        case OP_AND_LONG:
-        case OP_OR_LONG:
-        case OP_XOR_LONG:
-        case OP_SHL_LONG:
-        case OP_SHR_LONG:
-        case OP_USHR_LONG:
-        case OP_ADD_FLOAT:
-        case OP_SUB_FLOAT:
-        case OP_MUL_FLOAT:
-        case OP_DIV_FLOAT:
-        case OP_REM_FLOAT:
-        case OP_ADD_DOUBLE:
-        case OP_SUB_DOUBLE:
-        case OP_MUL_DOUBLE:
-        case OP_DIV_DOUBLE:
-        case OP_REM_DOUBLE:
-        case OP_ADD_INT_LIT16:
-        case OP_RSUB_INT:
-        case OP_MUL_INT_LIT16:
-        case OP_DIV_INT_LIT16:
-        case OP_REM_INT_LIT16:
-        case OP_AND_INT_LIT16:
-        case OP_OR_INT_LIT16:
-        case OP_XOR_INT_LIT16:
-        case OP_ADD_INT_LIT8:
-        case OP_RSUB_INT_LIT8:
-        case OP_MUL_INT_LIT8:
-        case OP_DIV_INT_LIT8:
-        case OP_REM_INT_LIT8:
-        case OP_AND_INT_LIT8:
-        case OP_OR_INT_LIT8:
-        case OP_XOR_INT_LIT8:
-        case OP_SHL_INT_LIT8:
-        case OP_SHR_INT_LIT8:
-        case OP_USHR_INT_LIT8:
-            width = 2;
-            break;
-
-        case OP_MOVE_16:
-        case OP_MOVE_WIDE_16:
-        case OP_MOVE_OBJECT_16:
-        case OP_CONST:
-        case OP_CONST_WIDE_32:
-        case OP_CONST_STRING_JUMBO:
-        case OP_GOTO_32:
-        case OP_FILLED_NEW_ARRAY:
-        case OP_FILLED_NEW_ARRAY_RANGE:
-        case OP_FILL_ARRAY_DATA:
-        case OP_PACKED_SWITCH:
-        case OP_SPARSE_SWITCH:
-        case OP_INVOKE_VIRTUAL:
-        case OP_INVOKE_SUPER:
-        case OP_INVOKE_DIRECT:
-        case OP_INVOKE_STATIC:
-        case OP_INVOKE_INTERFACE:
-        case OP_INVOKE_VIRTUAL_RANGE:
-        case OP_INVOKE_SUPER_RANGE:
-        case OP_INVOKE_DIRECT_RANGE:
-        case OP_INVOKE_STATIC_RANGE:
-        case OP_INVOKE_INTERFACE_RANGE:
-            width = 3;
-            break;
-
-        case OP_CONST_WIDE:
-            width = 5;
-            break;
-
-        /*
-         * Optimized instructions.  We return negative size values for these
-         * to distinguish them.
-         */
-        case OP_IGET_QUICK:
-        case OP_IGET_WIDE_QUICK:
-        case OP_IGET_OBJECT_QUICK:
-        case OP_IPUT_QUICK:
-        case OP_IPUT_WIDE_QUICK:
-        case OP_IPUT_OBJECT_QUICK:
-        case OP_THROW_VERIFICATION_ERROR:
-            width = -2;
-            break;
-        case OP_INVOKE_VIRTUAL_QUICK:
-        case OP_INVOKE_VIRTUAL_QUICK_RANGE:
-        case OP_INVOKE_SUPER_QUICK:
-        case OP_INVOKE_SUPER_QUICK_RANGE:
-        case OP_EXECUTE_INLINE:
-        case OP_EXECUTE_INLINE_RANGE:
-        case OP_INVOKE_DIRECT_EMPTY:
-            width = -3;
-            break;
-
-        /* these should never appear when scanning bytecode */
-        case OP_UNUSED_3E:
-        case OP_UNUSED_3F:
-        case OP_UNUSED_40:
-        case OP_UNUSED_41:
-        case OP_UNUSED_42:
-        case OP_UNUSED_43:
-        case OP_UNUSED_73:
-        case OP_UNUSED_79:
-        case OP_UNUSED_7A:
-        case OP_UNUSED_E3:
-        case OP_UNUSED_E4:
-        case OP_UNUSED_E5:
-        case OP_UNUSED_E6:
-        case OP_UNUSED_E7:
-        case OP_UNUSED_E8:
-        case OP_UNUSED_E9:
-        case OP_UNUSED_EA:
-        case OP_UNUSED_EB:
-        case OP_BREAKPOINT:
-        case OP_UNUSED_F1:
-        case OP_UNUSED_FC:
-        case OP_UNUSED_FD:
-        case OP_UNUSED_FE:
-        case OP_UNUSED_FF:
-            assert(width == 0);
-            break;
+#define DEX_INSTR_INFO_LIST(_)                                              \
+    /* 0x00 */                                                              \
+    _(OP_NOP, "nop", 1, kFmt10x,                                            \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE, "move", 1, kFmt12x,                                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE_FROM16, "move/from16", 2, kFmt22x,                            \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE_16, "move/16", 3, kFmt32x,                                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE_WIDE, "move-wide", 1, kFmt12x,                                \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE_WIDE_FROM16, "move-wide/from16", 2, kFmt22x,                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE_WIDE_16, "move-wide/16", 3, kFmt32x,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE_OBJECT, "move-object", 1, kFmt12x,                            \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE_OBJECT_FROM16, "move-object/from16", 2, kFmt22x,              \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE_OBJECT_16, "move-object/16", 3, kFmt32x,                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE_RESULT, "move-result", 1, kFmt11x,                            \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE_RESULT_WIDE, "move-result-wide", 1, kFmt11x,                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE_RESULT_OBJECT, "move-result-object", 1, kFmt11x,              \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MOVE_EXCEPTION, "move-exception", 1, kFmt11x,                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_RETURN_VOID, "return-void", 1, kFmt10x,                            \
+        kIndexNone, kInstrCanReturn)                                        \
+    _(OP_RETURN, "return", 1, kFmt11x,                                      \
+        kIndexNone, kInstrCanReturn)                                        \
+    /* 0x10 */                                                              \
+    _(OP_RETURN_WIDE, "return-wide", 1, kFmt11x,                            \
+        kIndexNone, kInstrCanReturn)                                        \
+    _(OP_RETURN_OBJECT, "return-object", 1, kFmt11x,                        \
+        kIndexNone, kInstrCanReturn)                                        \
+    _(OP_CONST_4, "const/4", 1, kFmt11n,                                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_CONST_16, "const/16", 2, kFmt21s,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_CONST, "const", 3, kFmt31i,                                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_CONST_HIGH16, "const/high16", 2, kFmt21h,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_CONST_WIDE_16, "const-wide/16", 2, kFmt21s,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_CONST_WIDE_32, "const-wide/32", 3, kFmt31i,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_CONST_WIDE, "const-wide", 5, kFmt51l,                              \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_CONST_WIDE_HIGH16, "const-wide/high16", 2, kFmt21h,                \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_CONST_STRING, "const-string", 2, kFmt21c,                          \
+        kIndexStringRef, kInstrCanContinue | kInstrCanThrow)                \
+    _(OP_CONST_STRING_JUMBO, "const-string/jumbo", 3, kFmt31c,              \
+        kIndexStringRef, kInstrCanContinue | kInstrCanThrow)                \
+    _(OP_CONST_CLASS, "const-class", 2, kFmt21c,                            \
+        kIndexTypeRef, kInstrCanContinue | kInstrCanThrow)                  \
+    _(OP_MONITOR_ENTER, "monitor-enter", 1, kFmt11x,                        \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_MONITOR_EXIT, "monitor-exit", 1, kFmt11x,                          \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_CHECK_CAST, "check-cast", 2, kFmt21c,                              \
+        kIndexTypeRef, kInstrCanContinue | kInstrCanThrow)                  \
+    /* 0x20 */                                                              \
+    _(OP_INSTANCE_OF, "instance-of", 2, kFmt22c,                            \
+        kIndexTypeRef, kInstrCanContinue | kInstrCanThrow)                  \
+    _(OP_ARRAY_LENGTH, "array-length", 1, kFmt12x,                          \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_NEW_INSTANCE, "new-instance", 2, kFmt21c,                          \
+        kIndexTypeRef, kInstrCanContinue | kInstrCanThrow)                  \
+    _(OP_NEW_ARRAY, "new-array", 2, kFmt22c,                                \
+        kIndexTypeRef, kInstrCanContinue | kInstrCanThrow)                  \
+    _(OP_FILLED_NEW_ARRAY, "filled-new-array", 3, kFmt35c,                  \
+        kIndexTypeRef, kInstrCanContinue | kInstrCanThrow)                  \
+    _(OP_FILLED_NEW_ARRAY_RANGE, "filled-new-array/range", 3, kFmt3rc,      \
+        kIndexTypeRef, kInstrCanContinue | kInstrCanThrow)                  \
+    _(OP_FILL_ARRAY_DATA, "fill-array-data", 3, kFmt31t,                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_THROW, "throw", 1, kFmt11x,                                        \
+        kIndexNone, kInstrCanThrow)                                         \
+    _(OP_GOTO, "goto", 1, kFmt10t,                                          \
+        kIndexNone, kInstrCanBranch | kInstrUnconditional)                  \
+    _(OP_GOTO_16, "goto/16", 2, kFmt20t,                                    \
+        kIndexNone, kInstrCanBranch | kInstrUnconditional)                  \
+    _(OP_GOTO_32, "goto/32", 3, kFmt30t,                                    \
+        kIndexNone, kInstrCanBranch | kInstrUnconditional)                  \
+    _(OP_PACKED_SWITCH, "packed-switch", 3, kFmt31t,                        \
+        kIndexNone, kInstrCanContinue | kInstrCanSwitch)                    \
+    _(OP_SPARSE_SWITCH, "sparse-switch", 3, kFmt31t,                        \
+        kIndexNone, kInstrCanContinue | kInstrCanSwitch)                    \
+    _(OP_CMPL_FLOAT, "cmpl-float", 2, kFmt23x,                              \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_CMPG_FLOAT, "cmpg-float", 2, kFmt23x,                              \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_CMPL_DOUBLE, "cmpl-double", 2, kFmt23x,                            \
+        kIndexNone, kInstrCanContinue)                                      \
+    /* 0x30 */                                                              \
+    _(OP_CMPG_DOUBLE, "cmpg-double", 2, kFmt23x,                            \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_CMP_LONG, "cmp-long", 2, kFmt23x,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_IF_EQ, "if-eq", 2, kFmt22t,                                        \
+        kIndexNone, kInstrCanBranch | kInstrCanContinue)                    \
+    _(OP_IF_NE, "if-ne", 2, kFmt22t,                                        \
+        kIndexNone, kInstrCanBranch | kInstrCanContinue)                    \
+    _(OP_IF_LT, "if-lt", 2, kFmt22t,                                        \
+        kIndexNone, kInstrCanBranch | kInstrCanContinue)                    \
+    _(OP_IF_GE, "if-ge", 2, kFmt22t,                                        \
+        kIndexNone, kInstrCanBranch | kInstrCanContinue)                    \
+    _(OP_IF_GT, "if-gt", 2, kFmt22t,                                        \
+        kIndexNone, kInstrCanBranch | kInstrCanContinue)                    \
+    _(OP_IF_LE, "if-le", 2, kFmt22t,                                        \
+        kIndexNone, kInstrCanBranch | kInstrCanContinue)                    \
+    _(OP_IF_EQZ, "if-eqz", 2, kFmt21t,                                      \
+        kIndexNone, kInstrCanBranch | kInstrCanContinue)                    \
+    _(OP_IF_NEZ, "if-nez", 2, kFmt21t,                                      \
+        kIndexNone, kInstrCanBranch | kInstrCanContinue)                    \
+    _(OP_IF_LTZ, "if-ltz", 2, kFmt21t,                                      \
+        kIndexNone, kInstrCanBranch | kInstrCanContinue)                    \
+    _(OP_IF_GEZ, "if-gez", 2, kFmt21t,                                      \
+        kIndexNone, kInstrCanBranch | kInstrCanContinue)                    \
+    _(OP_IF_GTZ, "if-gtz", 2, kFmt21t,                                      \
+        kIndexNone, kInstrCanBranch | kInstrCanContinue)                    \
+    _(OP_IF_LEZ, "if-lez", 2, kFmt21t,                                      \
+        kIndexNone, kInstrCanBranch | kInstrCanContinue)                    \
+    _(OP_UNUSED_3E, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_3F, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    /* 0x40 */                                                              \
+    _(OP_UNUSED_40, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_41, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_42, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_43, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_AGET, "aget", 2, kFmt23x,                                          \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_AGET_WIDE, "aget-wide", 2, kFmt23x,                                \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_AGET_OBJECT, "aget-object", 2, kFmt23x,                            \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_AGET_BOOLEAN, "aget-boolean", 2, kFmt23x,                          \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_AGET_BYTE, "aget-byte", 2, kFmt23x,                                \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_AGET_CHAR, "aget-char", 2, kFmt23x,                                \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_AGET_SHORT, "aget-short", 2, kFmt23x,                              \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_APUT, "aput", 2, kFmt23x,                                          \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_APUT_WIDE, "aput-wide", 2, kFmt23x,                                \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_APUT_OBJECT, "aput-object", 2, kFmt23x,                            \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_APUT_BOOLEAN, "aput-boolean", 2, kFmt23x,                          \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_APUT_BYTE, "aput-byte", 2, kFmt23x,                                \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    /* 0x50 */                                                              \
+    _(OP_APUT_CHAR, "aput-char", 2, kFmt23x,                                \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_APUT_SHORT, "aput-short", 2, kFmt23x,                              \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_IGET, "iget", 2, kFmt22c,                                          \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IGET_WIDE, "iget-wide", 2, kFmt22c,                                \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IGET_OBJECT, "iget-object", 2, kFmt22c,                            \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IGET_BOOLEAN, "iget-boolean", 2, kFmt22c,                          \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IGET_BYTE, "iget-byte", 2, kFmt22c,                                \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IGET_CHAR, "iget-char", 2, kFmt22c,                                \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IGET_SHORT, "iget-short", 2, kFmt22c,                              \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IPUT, "iput", 2, kFmt22c,                                          \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IPUT_WIDE, "iput-wide", 2, kFmt22c,                                \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IPUT_OBJECT, "iput-object", 2, kFmt22c,                            \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IPUT_BOOLEAN, "iput-boolean", 2, kFmt22c,                          \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IPUT_BYTE, "iput-byte", 2, kFmt22c,                                \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IPUT_CHAR, "iput-char", 2, kFmt22c,                                \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_IPUT_SHORT, "iput-short", 2, kFmt22c,                              \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    /* 0x60 */                                                              \
+    _(OP_SGET, "sget", 2, kFmt21c,                                          \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SGET_WIDE, "sget-wide", 2, kFmt21c,                                \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SGET_OBJECT, "sget-object", 2, kFmt21c,                            \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SGET_BOOLEAN, "sget-boolean", 2, kFmt21c,                          \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SGET_BYTE, "sget-byte", 2, kFmt21c,                                \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SGET_CHAR, "sget-char", 2, kFmt21c,                                \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SGET_SHORT, "sget-short", 2, kFmt21c,                              \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SPUT, "sput", 2, kFmt21c,                                          \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SPUT_WIDE, "sput-wide", 2, kFmt21c,                                \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SPUT_OBJECT, "sput-object", 2, kFmt21c,                            \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SPUT_BOOLEAN, "sput-boolean", 2, kFmt21c,                          \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SPUT_BYTE, "sput-byte", 2, kFmt21c,                                \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SPUT_CHAR, "sput-char", 2, kFmt21c,                                \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_SPUT_SHORT, "sput-short", 2, kFmt21c,                              \
+        kIndexFieldRef, kInstrCanContinue | kInstrCanThrow)                 \
+    _(OP_INVOKE_VIRTUAL, "invoke-virtual", 3, kFmt35c,                      \
+        kIndexMethodRef, kInstrCanContinue | kInstrCanThrow | kInstrInvoke) \
+    _(OP_INVOKE_SUPER, "invoke-super", 3, kFmt35c,                          \
+        kIndexMethodRef, kInstrCanContinue | kInstrCanThrow | kInstrInvoke) \
+    /* 0x70 */                                                              \
+    _(OP_INVOKE_DIRECT, "invoke-direct", 3, kFmt35c,                        \
+        kIndexMethodRef, kInstrCanContinue | kInstrCanThrow | kInstrInvoke) \
+    _(OP_INVOKE_STATIC, "invoke-static", 3, kFmt35c,                        \
+        kIndexMethodRef, kInstrCanContinue | kInstrCanThrow | kInstrInvoke) \
+    _(OP_INVOKE_INTERFACE, "invoke-interface", 3, kFmt35c,                  \
+        kIndexMethodRef, kInstrCanContinue | kInstrCanThrow | kInstrInvoke) \
+    _(OP_UNUSED_73, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_INVOKE_VIRTUAL_RANGE, "invoke-virtual/range", 3, kFmt3rc,          \
+        kIndexMethodRef, kInstrCanContinue | kInstrCanThrow | kInstrInvoke) \
+    _(OP_INVOKE_SUPER_RANGE, "invoke-super/range", 3, kFmt3rc,              \
+        kIndexMethodRef, kInstrCanContinue | kInstrCanThrow | kInstrInvoke) \
+    _(OP_INVOKE_DIRECT_RANGE, "invoke-direct/range", 3, kFmt3rc,            \
+        kIndexMethodRef, kInstrCanContinue | kInstrCanThrow | kInstrInvoke) \
+    _(OP_INVOKE_STATIC_RANGE, "invoke-static/range", 3, kFmt3rc,            \
+        kIndexMethodRef, kInstrCanContinue | kInstrCanThrow | kInstrInvoke) \
+    _(OP_INVOKE_INTERFACE_RANGE, "invoke-interface/range", 3, kFmt3rc,      \
+        kIndexMethodRef, kInstrCanContinue | kInstrCanThrow | kInstrInvoke) \
+    _(OP_UNUSED_79, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_7A, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_NEG_INT, "neg-int", 1, kFmt12x,                                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_NOT_INT, "not-int", 1, kFmt12x,                                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_NEG_LONG, "neg-long", 1, kFmt12x,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_NOT_LONG, "not-long", 1, kFmt12x,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_NEG_FLOAT, "neg-float", 1, kFmt12x,                                \
+        kIndexNone, kInstrCanContinue)                                      \
+    /* 0x80 */                                                              \
+    _(OP_NEG_DOUBLE, "neg-double", 1, kFmt12x,                              \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_INT_TO_LONG, "int-to-long", 1, kFmt12x,                            \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_INT_TO_FLOAT, "int-to-float", 1, kFmt12x,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_INT_TO_DOUBLE, "int-to-double", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_LONG_TO_INT, "long-to-int", 1, kFmt12x,                            \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_LONG_TO_FLOAT, "long-to-float", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_LONG_TO_DOUBLE, "long-to-double", 1, kFmt12x,                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_FLOAT_TO_INT, "float-to-int", 1, kFmt12x,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_FLOAT_TO_LONG, "float-to-long", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_FLOAT_TO_DOUBLE, "float-to-double", 1, kFmt12x,                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DOUBLE_TO_INT, "double-to-int", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DOUBLE_TO_LONG, "double-to-long", 1, kFmt12x,                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DOUBLE_TO_FLOAT, "double-to-float", 1, kFmt12x,                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_INT_TO_BYTE, "int-to-byte", 1, kFmt12x,                            \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_INT_TO_CHAR, "int-to-char", 1, kFmt12x,                            \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_INT_TO_SHORT, "int-to-short", 1, kFmt12x,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    /* 0x90 */                                                              \
+    _(OP_ADD_INT, "add-int", 2, kFmt23x,                                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SUB_INT, "sub-int", 2, kFmt23x,                                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MUL_INT, "mul-int", 2, kFmt23x,                                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DIV_INT, "div-int", 2, kFmt23x,                                    \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_REM_INT, "rem-int", 2, kFmt23x,                                    \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_AND_INT, "and-int", 2, kFmt23x,                                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_OR_INT, "or-int", 2, kFmt23x,                                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_XOR_INT, "xor-int", 2, kFmt23x,                                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SHL_INT, "shl-int", 2, kFmt23x,                                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SHR_INT, "shr-int", 2, kFmt23x,                                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_USHR_INT, "ushr-int", 2, kFmt23x,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_ADD_LONG, "add-long", 2, kFmt23x,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SUB_LONG, "sub-long", 2, kFmt23x,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MUL_LONG, "mul-long", 2, kFmt23x,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DIV_LONG, "div-long", 2, kFmt23x,                                  \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_REM_LONG, "rem-long", 2, kFmt23x,                                  \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    /* 0xa0 */                                                              \
+    _(OP_AND_LONG, "and-long", 2, kFmt23x,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_OR_LONG, "or-long", 2, kFmt23x,                                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_XOR_LONG, "xor-long", 2, kFmt23x,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SHL_LONG, "shl-long", 2, kFmt23x,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SHR_LONG, "shr-long", 2, kFmt23x,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_USHR_LONG, "ushr-long", 2, kFmt23x,                                \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_ADD_FLOAT, "add-float", 2, kFmt23x,                                \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SUB_FLOAT, "sub-float", 2, kFmt23x,                                \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MUL_FLOAT, "mul-float", 2, kFmt23x,                                \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DIV_FLOAT, "div-float", 2, kFmt23x,                                \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_REM_FLOAT, "rem-float", 2, kFmt23x,                                \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_ADD_DOUBLE, "add-double", 2, kFmt23x,                              \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SUB_DOUBLE, "sub-double", 2, kFmt23x,                              \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MUL_DOUBLE, "mul-double", 2, kFmt23x,                              \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DIV_DOUBLE, "div-double", 2, kFmt23x,                              \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_REM_DOUBLE, "rem-double", 2, kFmt23x,                              \
+        kIndexNone, kInstrCanContinue)                                      \
+    /* 0xb0 */                                                              \
+    _(OP_ADD_INT_2ADDR, "add-int/2addr", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SUB_INT_2ADDR, "sub-int/2addr", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MUL_INT_2ADDR, "mul-int/2addr", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DIV_INT_2ADDR, "div-int/2addr", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_REM_INT_2ADDR, "rem-int/2addr", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_AND_INT_2ADDR, "and-int/2addr", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_OR_INT_2ADDR, "or-int/2addr", 1, kFmt12x,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_XOR_INT_2ADDR, "xor-int/2addr", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SHL_INT_2ADDR, "shl-int/2addr", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SHR_INT_2ADDR, "shr-int/2addr", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_USHR_INT_2ADDR, "ushr-int/2addr", 1, kFmt12x,                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_ADD_LONG_2ADDR, "add-long/2addr", 1, kFmt12x,                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SUB_LONG_2ADDR, "sub-long/2addr", 1, kFmt12x,                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MUL_LONG_2ADDR, "mul-long/2addr", 1, kFmt12x,                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DIV_LONG_2ADDR, "div-long/2addr", 1, kFmt12x,                      \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_REM_LONG_2ADDR, "rem-long/2addr", 1, kFmt12x,                      \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    /* 0xc0 */                                                              \
+    _(OP_AND_LONG_2ADDR, "and-long/2addr", 1, kFmt12x,                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_OR_LONG_2ADDR, "or-long/2addr", 1, kFmt12x,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_XOR_LONG_2ADDR, "xor-long/2addr", 1, kFmt12x,                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SHL_LONG_2ADDR, "shl-long/2addr", 1, kFmt12x,                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SHR_LONG_2ADDR, "shr-long/2addr", 1, kFmt12x,                      \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_USHR_LONG_2ADDR, "ushr-long/2addr", 1, kFmt12x,                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_ADD_FLOAT_2ADDR, "add-float/2addr", 1, kFmt12x,                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SUB_FLOAT_2ADDR, "sub-float/2addr", 1, kFmt12x,                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MUL_FLOAT_2ADDR, "mul-float/2addr", 1, kFmt12x,                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DIV_FLOAT_2ADDR, "div-float/2addr", 1, kFmt12x,                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_REM_FLOAT_2ADDR, "rem-float/2addr", 1, kFmt12x,                    \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_ADD_DOUBLE_2ADDR, "add-double/2addr", 1, kFmt12x,                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SUB_DOUBLE_2ADDR, "sub-double/2addr", 1, kFmt12x,                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MUL_DOUBLE_2ADDR, "mul-double/2addr", 1, kFmt12x,                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DIV_DOUBLE_2ADDR, "div-double/2addr", 1, kFmt12x,                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_REM_DOUBLE_2ADDR, "rem-double/2addr", 1, kFmt12x,                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    /* 0xd0 */                                                              \
+    _(OP_ADD_INT_LIT16, "add-int/lit16", 2, kFmt22s,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_RSUB_INT, "rsub-int", 2, kFmt22s,                                  \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MUL_INT_LIT16, "mul-int/lit16", 2, kFmt22s,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DIV_INT_LIT16, "div-int/lit16", 2, kFmt22s,                        \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_REM_INT_LIT16, "rem-int/lit16", 2, kFmt22s,                        \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_AND_INT_LIT16, "and-int/lit16", 2, kFmt22s,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_OR_INT_LIT16, "or-int/lit16", 2, kFmt22s,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_XOR_INT_LIT16, "xor-int/lit16", 2, kFmt22s,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_ADD_INT_LIT8, "add-int/lit8", 2, kFmt22b,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_RSUB_INT_LIT8, "rsub-int/lit8", 2, kFmt22b,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_MUL_INT_LIT8, "mul-int/lit8", 2, kFmt22b,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_DIV_INT_LIT8, "div-int/lit8", 2, kFmt22b,                          \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_REM_INT_LIT8, "rem-int/lit8", 2, kFmt22b,                          \
+        kIndexNone, kInstrCanContinue | kInstrCanThrow)                     \
+    _(OP_AND_INT_LIT8, "and-int/lit8", 2, kFmt22b,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_OR_INT_LIT8, "or-int/lit8", 2, kFmt22b,                            \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_XOR_INT_LIT8, "xor-int/lit8", 2, kFmt22b,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    /* 0xe0 */                                                              \
+    _(OP_SHL_INT_LIT8, "shl-int/lit8", 2, kFmt22b,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_SHR_INT_LIT8, "shr-int/lit8", 2, kFmt22b,                          \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_USHR_INT_LIT8, "ushr-int/lit8", 2, kFmt22b,                        \
+        kIndexNone, kInstrCanContinue)                                      \
+    _(OP_UNUSED_E3, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_E4, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_E5, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_E6, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_E7, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_E8, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_E9, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_EA, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_EB, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_BREAKPOINT, "^breakpoint", 0, kFmtUnknown,                         \
+        kIndexUnknown, 0)                                                   \
+    _(OP_THROW_VERIFICATION_ERROR, "^throw-verification-error", -2,         \
+        kFmt20bc, kIndexVaries, kInstrCanThrow)                             \
+    _(OP_EXECUTE_INLINE, "+execute-inline", -3, kFmt3inline,                \
+        kIndexInlineMethod, kInstrCanContinue | kInstrCanThrow)             \
+    _(OP_EXECUTE_INLINE_RANGE, "+execute-inline/range", -3, kFmt3rinline,   \
+        kIndexInlineMethod, kInstrCanContinue | kInstrCanThrow)             \
+    /* 0xf0 */                                                              \
+    _(OP_INVOKE_DIRECT_EMPTY, "+invoke-direct-empty", -3, kFmt35c,          \
+        kIndexMethodRef, kInstrCanContinue | kInstrCanThrow | kInstrInvoke) \
+    _(OP_UNUSED_F1, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_IGET_QUICK, "+iget-quick", -2, kFmt22cs,                           \
+        kIndexFieldOffset, kInstrCanContinue | kInstrCanThrow)              \
+    _(OP_IGET_WIDE_QUICK, "+iget-wide-quick", -2, kFmt22cs,                 \
+        kIndexFieldOffset, kInstrCanContinue | kInstrCanThrow)              \
+    _(OP_IGET_OBJECT_QUICK, "+iget-object-quick", -2, kFmt22cs,             \
+        kIndexFieldOffset, kInstrCanContinue | kInstrCanThrow)              \
+    _(OP_IPUT_QUICK, "+iput-quick", -2, kFmt22cs,                           \
+        kIndexFieldOffset, kInstrCanContinue | kInstrCanThrow)              \
+    _(OP_IPUT_WIDE_QUICK, "+iput-wide-quick", -2, kFmt22cs,                 \
+        kIndexFieldOffset, kInstrCanContinue | kInstrCanThrow)              \
+    _(OP_IPUT_OBJECT_QUICK, "+iput-object-quick", -2, kFmt22cs,             \
+        kIndexFieldOffset, kInstrCanContinue | kInstrCanThrow)              \
+    _(OP_INVOKE_VIRTUAL_QUICK, "+invoke-virtual-quick", -3, kFmt35ms,       \
+        kIndexVtableOffset, kInstrCanContinue | kInstrCanThrow |            \
+            kInstrInvoke)                                                   \
+    _(OP_INVOKE_VIRTUAL_QUICK_RANGE, "+invoke-virtual-quick/range", -3,     \
+        kFmt3rms, kIndexVtableOffset, kInstrCanContinue | kInstrCanThrow |  \
+            kInstrInvoke)                                                   \
+    _(OP_INVOKE_SUPER_QUICK, "+invoke-super-quick", -3, kFmt35ms,           \
+        kIndexVtableOffset, kInstrCanContinue | kInstrCanThrow |            \
+            kInstrInvoke)                                                   \
+    _(OP_INVOKE_SUPER_QUICK_RANGE, "+invoke-super-quick/range", -3,         \
+        kFmt3rms, kIndexVtableOffset, kInstrCanContinue | kInstrCanThrow |  \
+            kInstrInvoke)                                                   \
+    _(OP_UNUSED_FC, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_FD, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_FE, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)                                                   \
+    _(OP_UNUSED_FF, "UNUSED", 0, kFmtUnknown,                               \
+        kIndexUnknown, 0)
+
+#define INSTR_WIDTH(_op, _name, _width, _fmt, _index, _flags)   [_op] = _width,
+#define INSTR_FLAGS(_op, _name, _width, _fmt, _index, _flags)   [_op] = _flags,
+#define INSTR_FORMAT(_op, _name, _width, _fmt, _index, _flags)  [_op] = _fmt,
+#define INSTR_INFO(_op, _name, _width, _fmt, _index, _flags)                \
+    [_op] = { _name, _width, _fmt, _flags, _index },
+
+static const InstructionWidth gInstrWidthTable[kNumDalvikInstructions] = {
+    DEX_INSTR_INFO_LIST(INSTR_WIDTH)
+};
+
+static const InstructionFlags gInstrFlagsTable[kNumDalvikInstructions] = {
+    DEX_INSTR_INFO_LIST(INSTR_FLAGS)
+};
+
+static const InstructionFormat gInstrFormatTable[kNumDalvikInstructions] = {
+    DEX_INSTR_INFO_LIST(INSTR_FORMAT)
+};
+
+const InstructionInfo gDexInstrInfoTable[kNumDalvikInstructions] = {
+    DEX_INSTR_INFO_LIST(INSTR_INFO)
+};
 
-        /*
-         * DO NOT add a "default" clause here.  Without it the compiler will
-         * complain if an instruction is missing (which is desirable).
-         */
-        }
 
-        instrWidth[opc] = width;
-    }
-
-    return instrWidth;
+/*
+ * Return the table of instruction widths.
+ */
+const InstructionWidth* dexCreateInstrWidthTable(void)
+{
+    return gInstrWidthTable;
 }
 
 /*
- * Generate a table that holds instruction flags.
+ * Return the table of instruction flags.
  */
-InstructionFlags* dexCreateInstrFlagsTable(void)
+const InstructionFlags* dexCreateInstrFlagsTable(void)
 {
-    InstructionFlags* instrFlags;
-    int i;
-
-    instrFlags = malloc(sizeof(InstructionFlags) * kNumDalvikInstructions);
-    if (instrFlags == NULL)
-        return NULL;
-
-    for (i = 0; i < kNumDalvikInstructions; i++) {
-        OpCode opc = (OpCode) i;
-        InstructionFlags flags = 0;
-
-        switch (opc) {
-        /* these don't affect the PC and can't cause an exception */
-        case OP_NOP:
-        case OP_MOVE:
-        case OP_MOVE_FROM16:
-        case OP_MOVE_16:
-        case OP_MOVE_WIDE:
-        case OP_MOVE_WIDE_FROM16:
-        case OP_MOVE_WIDE_16:
-        case OP_MOVE_OBJECT:
-        case OP_MOVE_OBJECT_FROM16:
-        case OP_MOVE_OBJECT_16:
-        case OP_MOVE_RESULT:
-        case OP_MOVE_RESULT_WIDE:
-        case OP_MOVE_RESULT_OBJECT:
-        case OP_MOVE_EXCEPTION:
-        case OP_CONST_4:
-        case OP_CONST_16:
-        case OP_CONST:
-        case OP_CONST_HIGH16:
-        case OP_CONST_WIDE_16:
-        case OP_CONST_WIDE_32:
-        case OP_CONST_WIDE:
-        case OP_CONST_WIDE_HIGH16:
-        case OP_FILL_ARRAY_DATA:
-        case OP_CMPL_FLOAT:
-        case OP_CMPG_FLOAT:
-        case OP_CMPL_DOUBLE:
-        case OP_CMPG_DOUBLE:
-        case OP_CMP_LONG:
-        case OP_NEG_INT:
-        case OP_NOT_INT:
-        case OP_NEG_LONG:
-        case OP_NOT_LONG:
-        case OP_NEG_FLOAT:
-        case OP_NEG_DOUBLE:
-        case OP_INT_TO_LONG:
-        case OP_INT_TO_FLOAT:
-        case OP_INT_TO_DOUBLE:
-        case OP_LONG_TO_INT:
-        case OP_LONG_TO_FLOAT:
-        case OP_LONG_TO_DOUBLE:
-        case OP_FLOAT_TO_INT:
-        case OP_FLOAT_TO_LONG:
-        case OP_FLOAT_TO_DOUBLE:
-        case OP_DOUBLE_TO_INT:
-        case OP_DOUBLE_TO_LONG:
-        case OP_DOUBLE_TO_FLOAT:
-        case OP_INT_TO_BYTE:
-        case OP_INT_TO_CHAR:
-        case OP_INT_TO_SHORT:
-        case OP_ADD_INT:
-        case OP_SUB_INT:
-        case OP_MUL_INT:
-        case OP_AND_INT:
-        case OP_OR_INT:
-        case OP_XOR_INT:
-        case OP_SHL_INT:
-        case OP_SHR_INT:
-        case OP_USHR_INT:
-        case OP_ADD_LONG:
-        case OP_SUB_LONG:
-        case OP_MUL_LONG:
-        case OP_AND_LONG:
-        case OP_OR_LONG:
-        case OP_XOR_LONG:
-        case OP_SHL_LONG:
-        case OP_SHR_LONG:
-        case OP_USHR_LONG:
-        case OP_ADD_FLOAT:
-        case OP_SUB_FLOAT:
-        case OP_MUL_FLOAT:
-        case OP_DIV_FLOAT:
-        case OP_REM_FLOAT:
-        case OP_ADD_DOUBLE:
-        case OP_SUB_DOUBLE:
-        case OP_MUL_DOUBLE:
-        case OP_DIV_DOUBLE:         // div by zero just returns NaN
-        case OP_REM_DOUBLE:
-        case OP_ADD_INT_2ADDR:
-        case OP_SUB_INT_2ADDR:
-        case OP_MUL_INT_2ADDR:
-        case OP_AND_INT_2ADDR:
-        case OP_OR_INT_2ADDR:
-        case OP_XOR_INT_2ADDR:
-        case OP_SHL_INT_2ADDR:
-        case OP_SHR_INT_2ADDR:
-        case OP_USHR_INT_2ADDR:
-        case OP_ADD_LONG_2ADDR:
-        case OP_SUB_LONG_2ADDR:
-        case OP_MUL_LONG_2ADDR:
-        case OP_AND_LONG_2ADDR:
-        case OP_OR_LONG_2ADDR:
-        case OP_XOR_LONG_2ADDR:
-        case OP_SHL_LONG_2ADDR:
-        case OP_SHR_LONG_2ADDR:
-        case OP_USHR_LONG_2ADDR:
-        case OP_ADD_FLOAT_2ADDR:
-        case OP_SUB_FLOAT_2ADDR:
-        case OP_MUL_FLOAT_2ADDR:
-        case OP_DIV_FLOAT_2ADDR:
-        case OP_REM_FLOAT_2ADDR:
-        case OP_ADD_DOUBLE_2ADDR:
-        case OP_SUB_DOUBLE_2ADDR:
-        case OP_MUL_DOUBLE_2ADDR:
-        case OP_DIV_DOUBLE_2ADDR:
-        case OP_REM_DOUBLE_2ADDR:
-        case OP_ADD_INT_LIT16:
-        case OP_RSUB_INT:
-        case OP_MUL_INT_LIT16:
-        case OP_AND_INT_LIT16:
-        case OP_OR_INT_LIT16:
-        case OP_XOR_INT_LIT16:
-        case OP_ADD_INT_LIT8:
-        case OP_RSUB_INT_LIT8:
-        case OP_MUL_INT_LIT8:
-        case OP_AND_INT_LIT8:
-        case OP_OR_INT_LIT8:
-        case OP_XOR_INT_LIT8:
-        case OP_SHL_INT_LIT8:
-        case OP_SHR_INT_LIT8:
-        case OP_USHR_INT_LIT8:
-            flags = kInstrCanContinue;
-            break;
-
-        /* these don't affect the PC, but can cause exceptions */
-        case OP_CONST_STRING:
-        case OP_CONST_STRING_JUMBO:
-        case OP_CONST_CLASS:
-        case OP_MONITOR_ENTER:
-        case OP_MONITOR_EXIT:
-        case OP_CHECK_CAST:
-        case OP_INSTANCE_OF:
-        case OP_ARRAY_LENGTH:
-        case OP_NEW_INSTANCE:
-        case OP_NEW_ARRAY:
-        case OP_FILLED_NEW_ARRAY:
-        case OP_FILLED_NEW_ARRAY_RANGE:
-        case OP_AGET:
-        case OP_AGET_BOOLEAN:
-        case OP_AGET_BYTE:
-        case OP_AGET_CHAR:
-        case OP_AGET_SHORT:
-        case OP_AGET_WIDE:
-        case OP_AGET_OBJECT:
-        case OP_APUT:
-        case OP_APUT_BOOLEAN:
-        case OP_APUT_BYTE:
-        case OP_APUT_CHAR:
-        case OP_APUT_SHORT:
-        case OP_APUT_WIDE:
-        case OP_APUT_OBJECT:
-        case OP_IGET:
-        case OP_IGET_BOOLEAN:
-        case OP_IGET_BYTE:
-        case OP_IGET_CHAR:
-        case OP_IGET_SHORT:
-        case OP_IGET_WIDE:
-        case OP_IGET_OBJECT:
-        case OP_IPUT:
-        case OP_IPUT_BOOLEAN:
-        case OP_IPUT_BYTE:
-        case OP_IPUT_CHAR:
-        case OP_IPUT_SHORT:
-        case OP_IPUT_WIDE:
-        case OP_IPUT_OBJECT:
-        case OP_SGET:
-        case OP_SGET_BOOLEAN:
-        case OP_SGET_BYTE:
-        case OP_SGET_CHAR:
-        case OP_SGET_SHORT:
-        case OP_SGET_WIDE:
-        case OP_SGET_OBJECT:
-        case OP_SPUT:
-        case OP_SPUT_BOOLEAN:
-        case OP_SPUT_BYTE:
-        case OP_SPUT_CHAR:
-        case OP_SPUT_SHORT:
-        case OP_SPUT_WIDE:
-        case OP_SPUT_OBJECT:
-        case OP_DIV_INT:
-        case OP_REM_INT:
-        case OP_DIV_LONG:
-        case OP_REM_LONG:
-        case OP_DIV_INT_2ADDR:
-        case OP_REM_INT_2ADDR:
-        case OP_DIV_LONG_2ADDR:
-        case OP_REM_LONG_2ADDR:
-        case OP_DIV_INT_LIT16:
-        case OP_REM_INT_LIT16:
-        case OP_DIV_INT_LIT8:
-        case OP_REM_INT_LIT8:
-            flags = kInstrCanContinue | kInstrCanThrow;
-            break;
-
-        case OP_INVOKE_VIRTUAL:
-        case OP_INVOKE_VIRTUAL_RANGE:
-        case OP_INVOKE_SUPER:
-        case OP_INVOKE_SUPER_RANGE:
-        case OP_INVOKE_DIRECT:
-        case OP_INVOKE_DIRECT_RANGE:
-        case OP_INVOKE_STATIC:
-        case OP_INVOKE_STATIC_RANGE:
-        case OP_INVOKE_INTERFACE:
-        case OP_INVOKE_INTERFACE_RANGE:
-            flags = kInstrCanContinue | kInstrCanThrow | kInstrInvoke;
-            break;
-
-        case OP_RETURN_VOID:
-        case OP_RETURN:
-        case OP_RETURN_WIDE:
-        case OP_RETURN_OBJECT:
-            flags = kInstrCanReturn;
-            break;
-
-        case OP_THROW:
-            flags = kInstrCanThrow;
-            break;
-
-        /* unconditional branches */
-        case OP_GOTO:
-        case OP_GOTO_16:
-        case OP_GOTO_32:
-            flags = kInstrCanBranch | kInstrUnconditional;
-            break;
-
-        /* conditional branches */
-        case OP_IF_EQ:
-        case OP_IF_NE:
-        case OP_IF_LT:
-        case OP_IF_GE:
-        case OP_IF_GT:
-        case OP_IF_LE:
-        case OP_IF_EQZ:
-        case OP_IF_NEZ:
-        case OP_IF_LTZ:
-        case OP_IF_GEZ:
-        case OP_IF_GTZ:
-        case OP_IF_LEZ:
-            flags = kInstrCanBranch | kInstrCanContinue;
-            break;
-
-        /* switch statements; if value not in switch, it continues */
-        case OP_PACKED_SWITCH:
-        case OP_SPARSE_SWITCH:
-            flags = kInstrCanSwitch | kInstrCanContinue;
-            break;
-
-        /* verifier/optimizer-generated instructions */
-        case OP_THROW_VERIFICATION_ERROR:
-            flags = kInstrCanThrow;
-            break;
-        case OP_EXECUTE_INLINE:
-        case OP_EXECUTE_INLINE_RANGE:
-            flags = kInstrCanContinue | kInstrCanThrow;
-            break;
-        case OP_IGET_QUICK:
-        case OP_IGET_WIDE_QUICK:
-        case OP_IGET_OBJECT_QUICK:
-        case OP_IPUT_QUICK:
-        case OP_IPUT_WIDE_QUICK:
-        case OP_IPUT_OBJECT_QUICK:
-            flags = kInstrCanContinue | kInstrCanThrow;
-            break;
-
-        case OP_INVOKE_VIRTUAL_QUICK:
-        case OP_INVOKE_VIRTUAL_QUICK_RANGE:
-        case OP_INVOKE_SUPER_QUICK:
-        case OP_INVOKE_SUPER_QUICK_RANGE:
-        case OP_INVOKE_DIRECT_EMPTY:
-            flags = kInstrCanContinue | kInstrCanThrow | kInstrInvoke;
-            break;
-
-        /* these should never appear when scanning code */
-        case OP_UNUSED_3E:
-        case OP_UNUSED_3F:
-        case OP_UNUSED_40:
-        case OP_UNUSED_41:
-        case OP_UNUSED_42:
-        case OP_UNUSED_43:
-        case OP_UNUSED_73:
-        case OP_UNUSED_79:
-        case OP_UNUSED_7A:
-        case OP_UNUSED_E3:
-        case OP_UNUSED_E4:
-        case OP_UNUSED_E5:
-        case OP_UNUSED_E6:
-        case OP_UNUSED_E7:
-        case OP_UNUSED_E8:
-        case OP_UNUSED_E9:
-        case OP_UNUSED_EA:
-        case OP_UNUSED_EB:
-        case OP_BREAKPOINT:
-        case OP_UNUSED_F1:
-        case OP_UNUSED_FC:
-        case OP_UNUSED_FD:
-        case OP_UNUSED_FE:
-        case OP_UNUSED_FF:
-            break;
-
-        /*
-         * DO NOT add a "default" clause here.  Without it the compiler will
-         * complain if an instruction is missing (which is desirable).
-         */
-        }
-
-        instrFlags[opc] = flags;
-    }
-
-    return instrFlags;
+    return gInstrFlagsTable;
 }
 
 /*
- * Allocate and populate a 256-element array with instruction formats.
- * Used in conjunction with dexDecodeInstruction.
+ * Return the table of instruction formats.
  */
-InstructionFormat* dexCreateInstrFormatTable(void)
+const InstructionFormat* dexCreateInstrFormatTable(void)
 {
-    InstructionFormat* instFmt;
-    int i;
-
-    instFmt = malloc(sizeof(InstructionFormat) * kNumDalvikInstructions);
-    if (instFmt == NULL)
-        return NULL;
-
-    for (i = 0; i < kNumDalvikInstructions; i++) {
-        OpCode opc = (OpCode) i;
-        InstructionFormat fmt = kFmtUnknown;
-
-        switch (opc) {
-        case OP_GOTO:
-            fmt = kFmt10t;
-            break;
-        case OP_NOP:
-        case OP_RETURN_VOID:
-            fmt = kFmt10x;
-            break;
-        case OP_CONST_4:
-            fmt = kFmt11n;
-            break;
-        case OP_CONST_HIGH16:
-        case OP_CONST_WIDE_HIGH16:
-            fmt = kFmt21h;
-            break;
-        case OP_MOVE_RESULT:
-        case OP_MOVE_RESULT_WIDE:
-        case OP_MOVE_RESULT_OBJECT:
-        case OP_MOVE_EXCEPTION:
-        case OP_RETURN:
-        case OP_RETURN_WIDE:
-        case OP_RETURN_OBJECT:
-        case OP_MONITOR_ENTER:
-        case OP_MONITOR_EXIT:
-        case OP_THROW:
-            fmt = kFmt11x;
-            break;
-        case OP_MOVE:
-        case OP_MOVE_WIDE:
-        case OP_MOVE_OBJECT:
-        case OP_ARRAY_LENGTH:
-        case OP_NEG_INT:
-        case OP_NOT_INT:
-        case OP_NEG_LONG:
-        case OP_NOT_LONG:
-        case OP_NEG_FLOAT:
-        case OP_NEG_DOUBLE:
-        case OP_INT_TO_LONG:
-        case OP_INT_TO_FLOAT:
-        case OP_INT_TO_DOUBLE:
-        case OP_LONG_TO_INT:
-        case OP_LONG_TO_FLOAT:
-        case OP_LONG_TO_DOUBLE:
-        case OP_FLOAT_TO_INT:
-        case OP_FLOAT_TO_LONG:
-        case OP_FLOAT_TO_DOUBLE:
-        case OP_DOUBLE_TO_INT:
-        case OP_DOUBLE_TO_LONG:
-        case OP_DOUBLE_TO_FLOAT:
-        case OP_INT_TO_BYTE:
-        case OP_INT_TO_CHAR:
-        case OP_INT_TO_SHORT:
-        case OP_ADD_INT_2ADDR:
-        case OP_SUB_INT_2ADDR:
-        case OP_MUL_INT_2ADDR:
-        case OP_DIV_INT_2ADDR:
-        case OP_REM_INT_2ADDR:
-        case OP_AND_INT_2ADDR:
-        case OP_OR_INT_2ADDR:
-        case OP_XOR_INT_2ADDR:
-        case OP_SHL_INT_2ADDR:
-        case OP_SHR_INT_2ADDR:
-        case OP_USHR_INT_2ADDR:
-        case OP_ADD_LONG_2ADDR:
-        case OP_SUB_LONG_2ADDR:
-        case OP_MUL_LONG_2ADDR:
-        case OP_DIV_LONG_2ADDR:
-        case OP_REM_LONG_2ADDR:
-        case OP_AND_LONG_2ADDR:
-        case OP_OR_LONG_2ADDR:
-        case OP_XOR_LONG_2ADDR:
-        case OP_SHL_LONG_2ADDR:
-        case OP_SHR_LONG_2ADDR:
-        case OP_USHR_LONG_2ADDR:
-        case OP_ADD_FLOAT_2ADDR:
-        case OP_SUB_FLOAT_2ADDR:
-        case OP_MUL_FLOAT_2ADDR:
-        case OP_DIV_FLOAT_2ADDR:
-        case OP_REM_FLOAT_2ADDR:
-        case OP_ADD_DOUBLE_2ADDR:
-        case OP_SUB_DOUBLE_2ADDR:
-        case OP_MUL_DOUBLE_2ADDR:
-        case OP_DIV_DOUBLE_2ADDR:
-        case OP_REM_DOUBLE_2ADDR:
-            fmt = kFmt12x;
-            break;
-        case OP_GOTO_16:
-            fmt = kFmt20t;
-            break;
-        case OP_GOTO_32:
-            fmt = kFmt30t;
-            break;
-        case OP_CONST_STRING:
-        case OP_CONST_CLASS:
-        case OP_CHECK_CAST:
-        case OP_NEW_INSTANCE:
-        case OP_SGET:
-        case OP_SGET_WIDE:
-        case OP_SGET_OBJECT:
-        case OP_SGET_BOOLEAN:
-        case OP_SGET_BYTE:
-        case OP_SGET_CHAR:
-        case OP_SGET_SHORT:
-        case OP_SPUT:
-        case OP_SPUT_WIDE:
-        case OP_SPUT_OBJECT:
-        case OP_SPUT_BOOLEAN:
-        case OP_SPUT_BYTE:
-        case OP_SPUT_CHAR:
-        case OP_SPUT_SHORT:
-            fmt = kFmt21c;
-            break;
-        case OP_CONST_16:
-        case OP_CONST_WIDE_16:
-            fmt = kFmt21s;
-            break;
-        case OP_IF_EQZ:
-        case OP_IF_NEZ:
-        case OP_IF_LTZ:
-        case OP_IF_GEZ:
-        case OP_IF_GTZ:
-        case OP_IF_LEZ:
-            fmt = kFmt21t;
-            break;
-        case OP_FILL_ARRAY_DATA:
-        case OP_PACKED_SWITCH:
-        case OP_SPARSE_SWITCH:
-            fmt = kFmt31t;
-            break;
-        case OP_ADD_INT_LIT8:
-        case OP_RSUB_INT_LIT8:
-        case OP_MUL_INT_LIT8:
-        case OP_DIV_INT_LIT8:
-        case OP_REM_INT_LIT8:
-        case OP_AND_INT_LIT8:
-        case OP_OR_INT_LIT8:
-        case OP_XOR_INT_LIT8:
-        case OP_SHL_INT_LIT8:
-        case OP_SHR_INT_LIT8:
-        case OP_USHR_INT_LIT8:
-            fmt = kFmt22b;
-            break;
-        case OP_INSTANCE_OF:
-        case OP_NEW_ARRAY:
-        case OP_IGET:
-        case OP_IGET_WIDE:
-        case OP_IGET_OBJECT:
-        case OP_IGET_BOOLEAN:
-        case OP_IGET_BYTE:
-        case OP_IGET_CHAR:
-        case OP_IGET_SHORT:
-        case OP_IPUT:
-        case OP_IPUT_WIDE:
-        case OP_IPUT_OBJECT:
-        case OP_IPUT_BOOLEAN:
-        case OP_IPUT_BYTE:
-        case OP_IPUT_CHAR:
-        case OP_IPUT_SHORT:
-            fmt = kFmt22c;
-            break;
-        case OP_ADD_INT_LIT16:
-        case OP_RSUB_INT:
-        case OP_MUL_INT_LIT16:
-        case OP_DIV_INT_LIT16:
-        case OP_REM_INT_LIT16:
-        case OP_AND_INT_LIT16:
-        case OP_OR_INT_LIT16:
-        case OP_XOR_INT_LIT16:
-            fmt = kFmt22s;
-            break;
-        case OP_IF_EQ:
-        case OP_IF_NE:
-        case OP_IF_LT:
-        case OP_IF_GE:
-        case OP_IF_GT:
-        case OP_IF_LE:
-            fmt = kFmt22t;
-            break;
-        case OP_MOVE_FROM16:
-        case OP_MOVE_WIDE_FROM16:
-        case OP_MOVE_OBJECT_FROM16:
-            fmt = kFmt22x;
-            break;
-        case OP_CMPL_FLOAT:
-        case OP_CMPG_FLOAT:
-        case OP_CMPL_DOUBLE:
-        case OP_CMPG_DOUBLE:
-        case OP_CMP_LONG:
-        case OP_AGET:
-        case OP_AGET_WIDE:
-        case OP_AGET_OBJECT:
-        case OP_AGET_BOOLEAN:
-        case OP_AGET_BYTE:
-        case OP_AGET_CHAR:
-        case OP_AGET_SHORT:
-        case OP_APUT:
-        case OP_APUT_WIDE:
-        case OP_APUT_OBJECT:
-        case OP_APUT_BOOLEAN:
-        case OP_APUT_BYTE:
-        case OP_APUT_CHAR:
-        case OP_APUT_SHORT:
-        case OP_ADD_INT:
-        case OP_SUB_INT:
-        case OP_MUL_INT:
-        case OP_DIV_INT:
-        case OP_REM_INT:
-        case OP_AND_INT:
-        case OP_OR_INT:
-        case OP_XOR_INT:
-        case OP_SHL_INT:
-        case OP_SHR_INT:
-        case OP_USHR_INT:
-        case OP_ADD_LONG:
-        case OP_SUB_LONG:
-        case OP_MUL_LONG:
-        case OP_DIV_LONG:
-        case OP_REM_LONG:
-        case OP_AND_LONG:
-        case OP_OR_LONG:
-        case OP_XOR_LONG:
-        case OP_SHL_LONG:
-        case OP_SHR_LONG:
-        case OP_USHR_LONG:
-        case OP_ADD_FLOAT:
-        case OP_SUB_FLOAT:
-        case OP_MUL_FLOAT:
-        case OP_DIV_FLOAT:
-        case OP_REM_FLOAT:
-        case OP_ADD_DOUBLE:
-        case OP_SUB_DOUBLE:
-        case OP_MUL_DOUBLE:
-        case OP_DIV_DOUBLE:
-        case OP_REM_DOUBLE:
-            fmt = kFmt23x;
-            break;
-        case OP_CONST:
-        case OP_CONST_WIDE_32:
-            fmt = kFmt31i;
-            break;
-        case OP_CONST_STRING_JUMBO:
-            fmt = kFmt31c;
-            break;
-        case OP_MOVE_16:
-        case OP_MOVE_WIDE_16:
-        case OP_MOVE_OBJECT_16:
-            fmt = kFmt32x;
-            break;
-        case OP_FILLED_NEW_ARRAY:
-        case OP_INVOKE_VIRTUAL:
-        case OP_INVOKE_SUPER:
-        case OP_INVOKE_DIRECT:
-        case OP_INVOKE_STATIC:
-        case OP_INVOKE_INTERFACE:
-            fmt = kFmt35c;
-            break;
-        case OP_FILLED_NEW_ARRAY_RANGE:
-        case OP_INVOKE_VIRTUAL_RANGE:
-        case OP_INVOKE_SUPER_RANGE:
-        case OP_INVOKE_DIRECT_RANGE:
-        case OP_INVOKE_STATIC_RANGE:
-        case OP_INVOKE_INTERFACE_RANGE:
-            fmt = kFmt3rc;
-            break;
-        case OP_CONST_WIDE:
-            fmt = kFmt51l;
-            break;
-
-        /*
-         * Optimized instructions.
-         */
-        case OP_THROW_VERIFICATION_ERROR:
-            fmt = kFmt20bc;
-            break;
-        case OP_IGET_QUICK:
-        case OP_IGET_WIDE_QUICK:
-        case OP_IGET_OBJECT_QUICK:
-        case OP_IPUT_QUICK:
-        case OP_IPUT_WIDE_QUICK:
-        case OP_IPUT_OBJECT_QUICK:
-            fmt = kFmt22cs;
-            break;
-        case OP_INVOKE_VIRTUAL_QUICK:
-        case OP_INVOKE_SUPER_QUICK:
-            fmt = kFmt35ms;
-            break;
-        case OP_INVOKE_VIRTUAL_QUICK_RANGE:
-        case OP_INVOKE_SUPER_QUICK_RANGE:
-            fmt = kFmt3rms;
-            break;
-        case OP_EXECUTE_INLINE:
-            fmt = kFmt3inline;
-            break;
-        case OP_EXECUTE_INLINE_RANGE:
-            fmt = kFmt3rinline;
-            break;
-        case OP_INVOKE_DIRECT_EMPTY:
-            fmt = kFmt35c;
-            break;
-
-        /* these should never appear when scanning code */
-        case OP_UNUSED_3E:
-        case OP_UNUSED_3F:
-        case OP_UNUSED_40:
-        case OP_UNUSED_41:
-        case OP_UNUSED_42:
-        case OP_UNUSED_43:
-        case OP_UNUSED_73:
-        case OP_UNUSED_79:
-        case OP_UNUSED_7A:
-        case OP_UNUSED_E3:
-        case OP_UNUSED_E4:
-        case OP_UNUSED_E5:
-        case OP_UNUSED_E6:
-        case OP_UNUSED_E7:
-        case OP_UNUSED_E8:
-        case OP_UNUSED_E9:
-        case OP_UNUSED_EA:
-        case OP_UNUSED_EB:
-        case OP_BREAKPOINT:
-        case OP_UNUSED_F1:
-        case OP_UNUSED_FC:
-        case OP_UNUSED_FD:
-        case OP_UNUSED_FE:
-        case OP_UNUSED_FF:
-            fmt = kFmtUnknown;
-            break;
-
-        /*
-         * DO NOT add a "default" clause here.  Without it the compiler will
-         * complain if an instruction is missing (which is desirable).
-         */
-        }
-
-        instFmt[opc] = fmt;
-    }
-
-    return instFmt;
+    return gInstrFormatTable;
 }
 
 /*
- * Copied from InterpCore.h.  Used for instruction decoding.
+ * Copied from InterpCore.h.  Used for instruction decoding; the operand
+ * fields are pulled out by the per-format decoders in InstrUtils.h.
  */
-#define FETCH(_offset)      (insns[(_offset)])
 #define INST_INST(_inst)    ((_inst) & 0xff)
-#define INST_A(_inst)       (((u2)(_inst) >> 8) & 0x0f)
-#define INST_B(_inst)       ((u2)(_inst) >> 12)
-#define INST_AA(_inst)      ((_inst) >> 8)
 
 /*
- * Decode the instruction pointed to by "insns".
+ * Decode the instruction pointed to by "insns", which has format "fmt".
  *
  * Fills out the pieces of "pDec" that are affected by the current
  * instruction.  Does not touch anything else.
  */
-void dexDecodeInstruction(const InstructionFormat* fmts, const u2* insns,
+static inline void decodeInstruction(InstructionFormat fmt, const u2* insns,
     DecodedInstruction* pDec)
 {
     u2 inst = *insns;
 
     pDec->opCode = (OpCode) INST_INST(inst);
 
-    switch (dexGetInstrFormat(fmts, pDec->opCode)) {
+    switch (fmt) {
     case kFmt10x:       // op
-        /* nothing to do; copy the AA bits out for the verifier */
-        pDec->vA = INST_AA(inst);
+    case kFmt11x:       // op vAA
+        dexDecode11x(insns, pDec);
         break;
     case kFmt12x:       // op vA, vB
-        pDec->vA = INST_A(inst);
-        pDec->vB = INST_B(inst);
+        dexDecode12x(insns, pDec);
         break;
     case kFmt11n:       // op vA, #+B
-        pDec->vA = INST_A(inst); 
-        pDec->vB = (s4) (INST_B(inst) << 28) >> 28; // sign extend 4-bit value
-        break;
-    case kFmt11x:       // op vAA
-        pDec->vA = INST_AA(inst);
+        dexDecode11n(insns, pDec);
         break;
     case kFmt10t:       // op +AA
-        pDec->vA = (s1) INST_AA(inst);              // sign-extend 8-bit value
+        dexDecode10t(insns, pDec);
         break;
     case kFmt20t:       // op +AAAA
-        pDec->vA = (s2) FETCH(1);                   // sign-extend 16-bit value
+        dexDecode20t(insns, pDec);
         break;
     case kFmt20bc:      // op AA, thing@BBBB
     case kFmt21c:       // op vAA, thing@BBBB
     case kFmt22x:       // op vAA, vBBBB
-        pDec->vA = INST_AA(inst);
-        pDec->vB = FETCH(1);
+    case kFmt21h:       // op vAA, #+BBBB0000[00000000]
+        dexDecode21c(insns, pDec);
         break;
     case kFmt21s:       // op vAA, #+BBBB
     case kFmt21t:       // op vAA, +BBBB
-        pDec->vA = INST_AA(inst);
-        pDec->vB = (s2) FETCH(1);                   // sign-extend 16-bit value
-        break;
-    case kFmt21h:       // op vAA, #+BBBB0000[00000000]
-        pDec->vA = INST_AA(inst);
-        /*
-         * The value should be treated as right-zero-extended, but we don't
-         * actually do that here. Among other things, we don't know if it's
-         * the top bits of a 32- or 64-bit value.
-         */
-        pDec->vB = FETCH(1);
+        dexDecode21s(insns, pDec);
         break;
     case kFmt23x:       // op vAA, vBB, vCC
-        pDec->vA = INST_AA(inst);
-        pDec->vB = FETCH(1) & 0xff;
-        pDec->vC = FETCH(1) >> 8;
+        dexDecode23x(insns, pDec);
         break;
     case kFmt22b:       // op vAA, vBB, #+CC
-        pDec->vA = INST_AA(inst);
-        pDec->vB = FETCH(1) & 0xff;
-        pDec->vC = (s1) (FETCH(1) >> 8);            // sign-extend 8-bit value
+        dexDecode22b(insns, pDec);
         break;
     case kFmt22s:       // op vA, vB, #+CCCC
     case kFmt22t:       // op vA, vB, +CCCC
-        pDec->vA = INST_A(inst);
-        pDec->vB = INST_B(inst);
-        pDec->vC = (s2) FETCH(1);                   // sign-extend 16-bit value
+        dexDecode22s(insns, pDec);
         break;
     case kFmt22c:       // op vA, vB, thing@CCCC
     case kFmt22cs:      // [opt] op vA, vB, field offset CCCC
-        pDec->vA = INST_A(inst);
-        pDec->vB = INST_B(inst);
-        pDec->vC = FETCH(1);
+        dexDecode22c(insns, pDec);
         break;
-    case kFmt30t:        // op +AAAAAAAA
-        pDec->vA = FETCH(1) | ((u4) FETCH(2) << 16); // signed 32-bit value
+    case kFmt30t:       // op +AAAAAAAA
+        dexDecode30t(insns, pDec);
         break;
     case kFmt31t:       // op vAA, +BBBBBBBB
     case kFmt31c:       // op vAA, thing@BBBBBBBB
-        pDec->vA = INST_AA(inst);
-        pDec->vB = FETCH(1) | ((u4) FETCH(2) << 16); // 32-bit value
+    case kFmt31i:       // op vAA, #+BBBBBBBB
+        dexDecode31i(insns, pDec);
         break;
     case kFmt32x:       // op vAAAA, vBBBB
-        pDec->vA = FETCH(1);
-        pDec->vB = FETCH(2);
-        break;
-    case kFmt31i:       // op vAA, #+BBBBBBBB
-        pDec->vA = INST_AA(inst);
-        pDec->vB = FETCH(1) | ((u4) FETCH(2) << 16);
+        dexDecode32x(insns, pDec);
         break;
     case kFmt35c:       // op vB, {vD..vG,vA}, thing@CCCC
     case kFmt35ms:      // [opt] invoke-virtual+super
-        {
-            /*
-             * The lettering changes that came about when we went from 4 args
-             * to 5 made the "range" versions of the calls different from
-             * the non-range versions.  We have the choice between decoding
-             * them the way the spec shows and having lots of conditionals
-             * in the verifier, or mapping the values onto their original
-             * registers and leaving the verifier intact.
-             *
-             * Current plan is to leave the verifier alone.  We can fix it
-             * later if it's architecturally unbearable.
-             *
-             * Bottom line: method constant is always in vB.
-             */
-            u2 regList;
-            int i, count;
-
-            pDec->vA = INST_B(inst);
-            pDec->vB = FETCH(1);
-            regList = FETCH(2);
-
-            if (pDec->vA > 5) {
-                LOGW("Invalid arg count in 35c/35ms (%d)\n", pDec->vA);
-                goto bail;
-            }
-            count = pDec->vA;
-            if (count == 5) {
-                /* 5th arg comes from A field in instruction */
-                pDec->arg[4] = INST_A(inst);
-                count--;
-            }
-            for (i = 0; i < count; i++) {
-                pDec->arg[i] = regList & 0x0f;
-                regList >>= 4;
-            }
-            /* copy arg[0] to vC; we don't have vD/vE/vF, so ignore those */
-            if (pDec->vA > 0)
-                pDec->vC = pDec->arg[0];
-        }
+        dexDecode35c(insns, pDec);
         break;
     case kFmt3inline:   // [opt] inline invoke
-        {
-            u2 regList;
-            int i;
-
-            pDec->vA = INST_B(inst);
-            pDec->vB = FETCH(1);
-            regList = FETCH(2);
-
-            if (pDec->vA > 4) {
-                LOGW("Invalid arg count in 3inline (%d)\n", pDec->vA);
-                goto bail;
-            }
-            for (i = 0; i < (int) pDec->vA; i++) {
-                pDec->arg[i] = regList & 0x0f;
-                regList >>= 4;
-            }
-            /* copy arg[0] to vC; we don't have vD/vE/vF, so ignore those */
-            if (pDec->vA > 0)
-                pDec->vC = pDec->arg[0];
-        }
+        dexDecode3inline(insns, pDec);
         break;
     case kFmt35fs:      // [opt] invoke-interface
         assert(false);  // TODO
@@ -1204,29 +702,39 @@ void dexDecodeInstruction(const InstructionFormat* fmts, const u2* insns,
     case kFmt3rc:       // op {vCCCC .. v(CCCC+AA-1)}, meth@BBBB
     case kFmt3rms:      // [opt] invoke-virtual+super/range
     case kFmt3rinline:  // [opt] execute-inline/range
-        pDec->vA = INST_AA(inst);
-        pDec->vB = FETCH(1);
-        pDec->vC = FETCH(2);
+        dexDecode3rc(insns, pDec);
         break;
     case kFmt3rfs:      // [opt] invoke-interface/range
         assert(false);  // TODO
         break;
     case kFmt51l:       // op vAA, #+BBBBBBBBBBBBBBBB
-        pDec->vA = INST_AA(inst);
-        pDec->vB_wide = FETCH(1);
-        pDec->vB_wide |= (u8)FETCH(2) << 16;
-        pDec->vB_wide |= (u8)FETCH(3) << 32;
-        pDec->vB_wide |= (u8)FETCH(4) << 48;
+        dexDecode51l(insns, pDec);
         break;
     default:
         LOGW("Can't decode unexpected format %d (op=%d)\n",
-            dexGetInstrFormat(fmts, pDec->opCode), pDec->opCode);
+            fmt, pDec->opCode);
         assert(false);
         break;
     }
+}
+
+/*
+ * Decode the instruction pointed to by "insns".
+ */
+void dexDecodeInstruction(const InstructionFormat* fmts, const u2* insns,
+    DecodedInstruction* pDec)
+{
+    decodeInstruction(dexGetInstrFormat(fmts, INST_INST(*insns)), insns, pDec);
+}
 
-bail:
-    ;
+/*
+ * Decode the instruction pointed to by "insns", whose descriptor the
+ * caller has already looked up.
+ */
+void dexDecodeInstructionWithInfo(const InstructionInfo* pInfo,
+    const u2* insns, DecodedInstruction* pDec)
+{
+    decodeInstruction(pInfo->format, insns, pDec);
 }
 
 /*
@@ -32,8 +32,10 @@
  * 
  * If you add or delete a format, you have to change some or all of:
  *  - this enum
- *  - the switch inside dexDecodeInstruction() in InstrUtils.c
+ *  - the per-format decoders below, and the switch inside
+ *    dexDecodeInstruction() in InstrUtils.c
  *  - the switch inside dumpInstruction() in DexDump.c
+ *  - the instruction info list in InstrUtils.c
  */
 typedef unsigned char InstructionFormat;
 enum InstructionFormat {
@@ -106,10 +108,62 @@ enum InstructionFlags {
 
 
 /*
- * Allocate and populate a 256-element array with instruction widths.  A
- * width of zero means the entry does not exist.
+ * What the index in an instruction refers to, if it has one.
  */
-InstructionWidth* dexCreateInstrWidthTable(void);
+typedef unsigned char InstructionIndexType;
+enum InstructionIndexType {
+    kIndexUnknown = 0,
+    kIndexNone,             // has no index
+    kIndexVaries,           // depends on the instruction (verification error)
+    kIndexTypeRef,          // type reference index
+    kIndexStringRef,        // string reference index
+    kIndexMethodRef,        // method reference index
+    kIndexFieldRef,         // field reference index
+    kIndexInlineMethod,     // [opt] inline method index
+    kIndexVtableOffset,     // [opt] vtable offset
+    kIndexFieldOffset,      // [opt] field offset
+};
+
+/*
+ * Everything about an opcode in one place, so that a disassembler can get
+ * at it with a single lookup per instruction.
+ */
+typedef struct InstructionInfo {
+    const char*             name;
+    InstructionWidth        width;
+    InstructionFormat       format;
+    InstructionFlags        flags;
+    InstructionIndexType    indexType;
+} InstructionInfo;
+
+extern const InstructionInfo gDexInstrInfoTable[kNumDalvikInstructions];
+
+/*
+ * Return the descriptor for the specified opcode.
+ */
+DEX_INLINE const InstructionInfo* dexGetInstrInfo(OpCode opCode)
+{
+    return &gDexInstrInfoTable[opCode];
+}
+
+/*
+ * Return the name of an opcode, e.g. "move-wide/from16".  Optimized
+ * instructions are prefixed with '+', and verifier-generated ones with '^'.
+ */
+DEX_INLINE const char* dexGetOpcodeName(OpCode opCode)
+{
+    return gDexInstrInfoTable[opCode].name;
+}
+
+
+/*
+ * Return the 256-element array of instruction widths.  A width of zero
+ * means the entry does not exist.
+ *
+ * The tables returned by the dexCreateInstr*Table() functions are static
+ * and read-only.  They must not be modified or freed.
+ */
+const InstructionWidth* dexCreateInstrWidthTable(void);
 
 /*
  * Returns the width of the specified instruction, or 0 if not defined.
@@ -144,9 +198,9 @@ int dexGetInstrOrTableWidthAbs(const InstructionWidth* widths, const u2* insns);
 
 
 /*
- * Allocate and populate a 256-element array with instruction flags.
+ * Return the 256-element array of instruction flags.
  */
-InstructionFlags* dexCreateInstrFlagsTable(void);
+const InstructionFlags* dexCreateInstrFlagsTable(void);
 
 /*
  * Returns the flags for the specified opcode.
@@ -159,9 +213,9 @@ DEX_INLINE int dexGetInstrFlags(const InstructionFlags* flags, OpCode opCode)
 
 
 /*
- * Allocate and populate a 256-element array with instruction formats.
+ * Return the 256-element array of instruction formats.
  */
-InstructionFormat* dexCreateInstrFormatTable(void);
+const InstructionFormat* dexCreateInstrFormatTable(void);
 
 /*
  * Return the instruction format for the specified opcode.
@@ -173,10 +227,209 @@ DEX_INLINE InstructionFormat dexGetInstrFormat(const InstructionFormat* fmts,
     return fmts[opCode];
 }
 
+/*
+ * Per-format decoders.  Each fills out the pieces of "pDec" that its
+ * formats use, as dexDecodeInstruction() does, except for the opcode.  A
+ * caller that switches on the format anyway (a disassembler, say) can
+ * decode with these in the same switch rather than have
+ * dexDecodeInstruction() switch on it again.
+ */
+#define DEX_INSN_A(_inst)   (((u2)(_inst) >> 8) & 0x0f)
+#define DEX_INSN_B(_inst)   ((u2)(_inst) >> 12)
+#define DEX_INSN_AA(_inst)  ((_inst) >> 8)
+
+/* kFmt10x, kFmt11x: op vAA (AA is copied out for the verifier in 10x) */
+DEX_INLINE void dexDecode11x(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = DEX_INSN_AA(insns[0]);
+}
+
+/* kFmt12x: op vA, vB */
+DEX_INLINE void dexDecode12x(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = DEX_INSN_A(insns[0]);
+    pDec->vB = DEX_INSN_B(insns[0]);
+}
+
+/* kFmt11n: op vA, #+B */
+DEX_INLINE void dexDecode11n(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = DEX_INSN_A(insns[0]);
+    pDec->vB = (s4) (DEX_INSN_B(insns[0]) << 28) >> 28; // sign extend 4-bit
+}
+
+/* kFmt10t: op +AA */
+DEX_INLINE void dexDecode10t(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = (s1) DEX_INSN_AA(insns[0]);         // sign-extend 8-bit value
+}
+
+/* kFmt20t: op +AAAA */
+DEX_INLINE void dexDecode20t(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = (s2) insns[1];                       // sign-extend 16-bit value
+}
+
+/*
+ * kFmt20bc, kFmt21c, kFmt21h, kFmt22x: op vAA, BBBB.  In 21h the value
+ * should be treated as right-zero-extended, but we don't actually do that
+ * here; we don't know if it's the top bits of a 32- or 64-bit value.
+ */
+DEX_INLINE void dexDecode21c(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = DEX_INSN_AA(insns[0]);
+    pDec->vB = insns[1];
+}
+
+/* kFmt21s, kFmt21t: op vAA, #+BBBB */
+DEX_INLINE void dexDecode21s(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = DEX_INSN_AA(insns[0]);
+    pDec->vB = (s2) insns[1];                       // sign-extend 16-bit value
+}
+
+/* kFmt23x: op vAA, vBB, vCC */
+DEX_INLINE void dexDecode23x(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = DEX_INSN_AA(insns[0]);
+    pDec->vB = insns[1] & 0xff;
+    pDec->vC = insns[1] >> 8;
+}
+
+/* kFmt22b: op vAA, vBB, #+CC */
+DEX_INLINE void dexDecode22b(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = DEX_INSN_AA(insns[0]);
+    pDec->vB = insns[1] & 0xff;
+    pDec->vC = (s1) (insns[1] >> 8);                // sign-extend 8-bit value
+}
+
+/* kFmt22s, kFmt22t: op vA, vB, #+CCCC */
+DEX_INLINE void dexDecode22s(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = DEX_INSN_A(insns[0]);
+    pDec->vB = DEX_INSN_B(insns[0]);
+    pDec->vC = (s2) insns[1];                       // sign-extend 16-bit value
+}
+
+/* kFmt22c, kFmt22cs: op vA, vB, CCCC */
+DEX_INLINE void dexDecode22c(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = DEX_INSN_A(insns[0]);
+    pDec->vB = DEX_INSN_B(insns[0]);
+    pDec->vC = insns[1];
+}
+
+/* kFmt30t: op +AAAAAAAA */
+DEX_INLINE void dexDecode30t(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = insns[1] | ((u4) insns[2] << 16);   // signed 32-bit value
+}
+
+/* kFmt31c, kFmt31i, kFmt31t: op vAA, BBBBBBBB */
+DEX_INLINE void dexDecode31i(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = DEX_INSN_AA(insns[0]);
+    pDec->vB = insns[1] | ((u4) insns[2] << 16);   // 32-bit value
+}
+
+/* kFmt32x: op vAAAA, vBBBB */
+DEX_INLINE void dexDecode32x(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = insns[1];
+    pDec->vB = insns[2];
+}
+
+/*
+ * kFmt35c, kFmt35ms: op vB, {vD..vG,vA}, thing@CCCC.
+ *
+ * The lettering changes that came about when we went from 4 args to 5
+ * made the "range" versions of the calls different from the non-range
+ * versions.  Rather than decode them the way the spec shows and have lots
+ * of conditionals in the verifier, we map the values onto their original
+ * registers: the count goes in vA, the registers in arg[], and the method
+ * constant is always in vB.
+ */
+DEX_INLINE void dexDecode35c(const u2* insns, DecodedInstruction* pDec)
+{
+    u2 regList;
+    int i, count;
+
+    pDec->vA = DEX_INSN_B(insns[0]);
+    pDec->vB = insns[1];
+    regList = insns[2];
+
+    if (pDec->vA > 5) {
+        LOGW("Invalid arg count in 35c/35ms (%d)\n", pDec->vA);
+        return;
+    }
+    count = pDec->vA;
+    if (count == 5) {
+        /* 5th arg comes from A field in instruction */
+        pDec->arg[4] = DEX_INSN_A(insns[0]);
+        count--;
+    }
+    for (i = 0; i < count; i++) {
+        pDec->arg[i] = regList & 0x0f;
+        regList >>= 4;
+    }
+    /* copy arg[0] to vC; we don't have vD/vE/vF, so ignore those */
+    if (pDec->vA > 0)
+        pDec->vC = pDec->arg[0];
+}
+
+/* kFmt3inline: [opt] inline invoke, with up to four registers */
+DEX_INLINE void dexDecode3inline(const u2* insns, DecodedInstruction* pDec)
+{
+    u2 regList;
+    int i;
+
+    pDec->vA = DEX_INSN_B(insns[0]);
+    pDec->vB = insns[1];
+    regList = insns[2];
+
+    if (pDec->vA > 4) {
+        LOGW("Invalid arg count in 3inline (%d)\n", pDec->vA);
+        return;
+    }
+    for (i = 0; i < (int) pDec->vA; i++) {
+        pDec->arg[i] = regList & 0x0f;
+        regList >>= 4;
+    }
+    /* copy arg[0] to vC; we don't have vD/vE/vF, so ignore those */
+    if (pDec->vA > 0)
+        pDec->vC = pDec->arg[0];
+}
+
+/* kFmt3rc, kFmt3rms, kFmt3rinline: op {vCCCC .. v(CCCC+AA-1)}, BBBB */
+DEX_INLINE void dexDecode3rc(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = DEX_INSN_AA(insns[0]);
+    pDec->vB = insns[1];
+    pDec->vC = insns[2];
+}
+
+/* kFmt51l: op vAA, #+BBBBBBBBBBBBBBBB */
+DEX_INLINE void dexDecode51l(const u2* insns, DecodedInstruction* pDec)
+{
+    pDec->vA = DEX_INSN_AA(insns[0]);
+    pDec->vB_wide = insns[1];
+    pDec->vB_wide |= (u8) insns[2] << 16;
+    pDec->vB_wide |= (u8) insns[3] << 32;
+    pDec->vB_wide |= (u8) insns[4] << 48;
+}
+
 /*
  * Decode the instruction pointed to by "insns".
  */
 void dexDecodeInstruction(const InstructionFormat* fmts, const u2* insns,
     DecodedInstruction* pDec);
 
+/*
+ * Like dexDecodeInstruction, but uses the format from "pInfo", which must
+ * be the descriptor for the instruction's opcode.
+ */
+void dexDecodeInstructionWithInfo(const InstructionInfo* pInfo,
+    const u2* insns, DecodedInstruction* pDec);
+
 #endif /*_LIBDEX_INSTRUTILS*/
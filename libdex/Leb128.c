@@ -20,6 +20,14 @@
 
 #include "Leb128.h"
 
+#include <pthread.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+# define LEB128_X86_SIMD
+# include <immintrin.h>
+#endif
+
 /*
  * Reads an unsigned LEB128 value, updating the given pointer to point
  * just past the end of the read value and also indicating whether the
@@ -63,3 +71,253 @@ int readAndVerifySignedLeb128(const u1** pStream, const u1* limit,
 
     return result;
 }
+
+#ifdef LEB128_X86_SIMD
+/*
+ * Bulk decoding with SSE ("masked varint" decoding).
+ *
+ * The high bits of the next 12 bytes, gathered with a byte movemask, say
+ * where every value in them ends.  That 12-bit key picks a precomputed
+ * pattern: how many values to decode, how many bytes they take, and a
+ * byte shuffle that spreads them into lanes, after which dropping the
+ * continuation bits is a couple of masks and shifts.  Two kinds of
+ * pattern cover the common cases:
+ *
+ *   - up to 8 values of 1 or 2 bytes each, in 16-bit lanes;
+ *   - up to 4 values of 1 to 3 bytes each, in 32-bit lanes.
+ *
+ * Anything else (a value of 4 or 5 bytes, or one that doesn't end within
+ * the 12 bytes) is left to the scalar decoder.
+ *
+ * Where the next window starts depends on the pattern for this one, so
+ * the keys are cut from the high bits of a 64-byte block gathered up
+ * front; that keeps the load and movemask out of the chain from one
+ * window to the next, leaving just the table lookup.
+ */
+#define kLeb128KeyBits      12
+#define kLeb128MaxNarrow    8
+#define kLeb128MaxWide      4
+
+/* shuffle slots: narrow patterns by (count, which values are 2 bytes),
+ * then wide ones by (count, base-3 lengths) */
+#define kLeb128NarrowSlots  ((2 << kLeb128MaxNarrow) - 2)
+#define kLeb128WideSlots    (3 + 9 + 27 + 81)
+
+typedef struct Leb128Pattern {
+    u1  consumed;       /* bytes taken by the values */
+    u1  numValues;      /* 0 means "use the scalar decoder" */
+    u1  wide;           /* 32-bit lanes rather than 16-bit */
+    u2  shuffle;        /* index into gLeb128Shuffles */
+} Leb128Pattern;
+
+static pthread_once_t gLeb128Once = PTHREAD_ONCE_INIT;
+static bool gLeb128UseSimd;
+static Leb128Pattern gLeb128Patterns[1 << kLeb128KeyBits];
+static u1 gLeb128Shuffles[kLeb128NarrowSlots + kLeb128WideSlots][16]
+    __attribute__((aligned(16)));
+
+/*
+ * Fill in the pattern for one key.
+ */
+static void buildLeb128Pattern(u4 key)
+{
+    Leb128Pattern* pPattern = &gLeb128Patterns[key];
+    u1 lengths[kLeb128KeyBits];
+    int numLengths = 0;
+    int numNarrow, numWide;
+    int start = 0;
+    int i, j;
+
+    /* split the key into value lengths, as far as values are complete */
+    for (i = 0; i < kLeb128KeyBits; i++) {
+        if ((key & (1 << i)) == 0) {
+            lengths[numLengths++] = i + 1 - start;
+            start = i + 1;
+        }
+    }
+
+    for (numNarrow = 0; numNarrow < numLengths && numNarrow < kLeb128MaxNarrow
+            && lengths[numNarrow] <= 2; numNarrow++)
+        ;
+    for (numWide = 0; numWide < numLengths && numWide < kLeb128MaxWide
+            && lengths[numWide] <= 3; numWide++)
+        ;
+
+    memset(pPattern, 0, sizeof(*pPattern));
+    if (numNarrow == 0 && numWide == 0)
+        return;
+
+    u4 slot = 0;
+    u4 code = 0;
+    u1* shuffle;
+    int offset = 0;
+
+    if (numNarrow >= numWide) {
+        for (i = numNarrow - 1; i >= 0; i--)
+            code = (code << 1) | (lengths[i] - 1);
+        slot = (1 << numNarrow) - 2 + code;
+        pPattern->numValues = numNarrow;
+    } else {
+        u4 base = kLeb128NarrowSlots;
+        for (i = 1; i < numWide; i++)
+            base += (i == 1) ? 3 : (i == 2) ? 9 : 27;
+        for (i = numWide - 1; i >= 0; i--)
+            code = code * 3 + (lengths[i] - 1);
+        slot = base + code;
+        pPattern->numValues = numWide;
+        pPattern->wide = true;
+    }
+
+    /* 0x80 in a shuffle zeroes the byte */
+    shuffle = gLeb128Shuffles[slot];
+    memset(shuffle, 0x80, 16);
+    for (i = 0; i < pPattern->numValues; i++) {
+        int laneSize = pPattern->wide ? 4 : 2;
+
+        for (j = 0; j < lengths[i]; j++)
+            shuffle[i * laneSize + j] = offset + j;
+        offset += lengths[i];
+    }
+    pPattern->consumed = offset;
+    pPattern->shuffle = slot;
+}
+
+/*
+ * Decide whether to use the SIMD decoder, and build its tables.
+ */
+static void initLeb128Simd(void)
+{
+    u4 key;
+
+    if (!__builtin_cpu_supports("ssse3") || !__builtin_cpu_supports("sse4.1"))
+        return;
+    for (key = 0; key < (1 << kLeb128KeyBits); key++)
+        buildLeb128Pattern(key);
+    gLeb128UseSimd = true;
+}
+
+/*
+ * Gather the high bits of the 64 bytes at "ptr".
+ */
+__attribute__((target("ssse3,sse4.1")))
+static inline u8 leb128HighBits(const u1* ptr)
+{
+    u8 bits0 = (u4) _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) ptr));
+    u8 bits1 = (u4) _mm_movemask_epi8(
+            _mm_loadu_si128((const __m128i*) (ptr + 16)));
+    u8 bits2 = (u4) _mm_movemask_epi8(
+            _mm_loadu_si128((const __m128i*) (ptr + 32)));
+    u8 bits3 = (u4) _mm_movemask_epi8(
+            _mm_loadu_si128((const __m128i*) (ptr + 48)));
+
+    return bits0 | (bits1 << 16) | (bits2 << 32) | (bits3 << 48);
+}
+
+/*
+ * Decode values while the patterns cover them, there's room for a whole
+ * pattern's worth of output, and 64 bytes can be loaded without reaching
+ * "limit".  Returns the number of values decoded.
+ */
+__attribute__((target("ssse3,sse4.1")))
+static u4 readUnsignedLeb128Simd(const u1** pStream, const u1* limit,
+        u4* out, u4 count) {
+    const __m128i low7 = _mm_set1_epi32(0x0000007f);
+    const __m128i mid7 = _mm_set1_epi32(0x00007f00);
+    const __m128i high7 = _mm_set1_epi32(0x007f0000);
+    const __m128i low7x16 = _mm_set1_epi16(0x007f);
+    const __m128i mid7x16 = _mm_set1_epi16(0x7f00);
+    const u1* ptr = *pStream;
+    u4 done = 0;
+
+    while (count - done >= kLeb128MaxNarrow && limit - ptr >= 64) {
+        u8 highBits = leb128HighBits(ptr);
+        u4 pos = 0;
+
+        do {
+            u4 key = (u4) (highBits >> pos) & ((1 << kLeb128KeyBits) - 1);
+            const Leb128Pattern* pPattern = &gLeb128Patterns[key];
+            __m128i data, lanes, values;
+
+            if (pPattern->numValues == 0) {
+                *pStream = ptr + pos;
+                return done;
+            }
+
+            data = _mm_loadu_si128((const __m128i*) (ptr + pos));
+            lanes = _mm_shuffle_epi8(data,
+                    _mm_load_si128((const __m128i*)
+                            gLeb128Shuffles[pPattern->shuffle]));
+            if (pPattern->wide) {
+                values = _mm_or_si128(
+                        _mm_or_si128(_mm_and_si128(lanes, low7),
+                                _mm_srli_epi32(_mm_and_si128(lanes, mid7), 1)),
+                        _mm_srli_epi32(_mm_and_si128(lanes, high7), 2));
+                _mm_storeu_si128((__m128i*) (out + done), values);
+            } else {
+                values = _mm_or_si128(_mm_and_si128(lanes, low7x16),
+                        _mm_srli_epi16(_mm_and_si128(lanes, mid7x16), 1));
+                _mm_storeu_si128((__m128i*) (out + done),
+                        _mm_cvtepu16_epi32(values));
+                _mm_storeu_si128((__m128i*) (out + done + 4),
+                        _mm_cvtepu16_epi32(_mm_srli_si128(values, 8)));
+            }
+
+            pos += pPattern->consumed;
+            done += pPattern->numValues;
+        } while (pos <= 64 - 16 && count - done >= kLeb128MaxNarrow);
+
+        ptr += pos;
+    }
+
+    *pStream = ptr;
+    return done;
+}
+#endif /*LEB128_X86_SIMD*/
+
+/*
+ * Reads "count" unsigned LEB128 values into "out", using SIMD for runs of
+ * short values when the CPU has it, and the scalar decoder for the rest.
+ */
+void readUnsignedLeb128ArraySimd(const u1** pStream, const u1* limit,
+        u4* out, u4 count) {
+    const u1* ptr = *pStream;
+
+#ifdef LEB128_X86_SIMD
+    pthread_once(&gLeb128Once, initLeb128Simd);
+#endif
+
+    while (count != 0) {
+#ifdef LEB128_X86_SIMD
+        if (gLeb128UseSimd) {
+            u4 done = readUnsignedLeb128Simd(&ptr, limit, out, count);
+
+            out += done;
+            count -= done;
+            if (count == 0) {
+                break;
+            }
+        }
+#endif
+        *out++ = readUnsignedLeb128(&ptr);
+        count--;
+    }
+
+    *pStream = ptr;
+}
+
+/*
+ * Reads and verifies "count" unsigned LEB128 values into "out".
+ */
+bool readAndVerifyUnsignedLeb128Array(const u1** pStream, const u1* limit,
+        u4* out, u4 count) {
+    const u1* ptr = *pStream;
+    bool okay = true;
+
+    while (okay && count != 0) {
+        *out++ = readAndVerifyUnsignedLeb128(&ptr, limit, &okay);
+        count--;
+    }
+
+    *pStream = ptr;
+    return okay;
+}
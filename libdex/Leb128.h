@@ -124,6 +124,44 @@ int readAndVerifyUnsignedLeb128(const u1** pStream, const u1* limit,
  */
 int readAndVerifySignedLeb128(const u1** pStream, const u1* limit, bool* okay);
 
+/*
+ * Reads "count" unsigned LEB128 values into "out", as that many calls to
+ * readUnsignedLeb128() would, updating the given pointer to point just
+ * past the last of them.
+ */
+DEX_INLINE void readUnsignedLeb128Array(const u1** pStream, u4* out,
+        u4 count) {
+    const u1* ptr = *pStream;
+
+    while (count-- != 0) {
+        *out++ = readUnsignedLeb128(&ptr);
+    }
+
+    *pStream = ptr;
+}
+
+/*
+ * Reads "count" unsigned LEB128 values as readUnsignedLeb128Array() does,
+ * using SIMD where the CPU has it.  "limit" is the end of the readable
+ * data: the decoder reads ahead of the values it decodes, but not as far
+ * as "limit".
+ *
+ * This only pays off on long runs of values whose lengths vary without a
+ * pattern the branch predictor can learn.  On class_data and debug_info,
+ * where the lengths are short and regular, it is slower than the scalar
+ * loop, so nothing here uses it; see bench/Leb128Bench.c.
+ */
+void readUnsignedLeb128ArraySimd(const u1** pStream, const u1* limit,
+        u4* out, u4 count);
+
+/*
+ * Reads and verifies "count" unsigned LEB128 values into "out", as that
+ * many calls to readAndVerifyUnsignedLeb128() would.  Returns false if
+ * any of them is invalid, in which case the contents of "out" and the
+ * stream pointer are undefined.
+ */
+bool readAndVerifyUnsignedLeb128Array(const u1** pStream, const u1* limit,
+        u4* out, u4 count);
 
 /*
  * Writes a 32-bit value in unsigned ULEB128 format.
@@ -31,8 +31,9 @@
  * Opcode definitions and attributes:
  *  - update the OpCode enum below
  *  - update the "goto table" definition macro, DEFINE_GOTO_TABLE(), below
- *  - update the instruction info table generators and (if you changed an
- *    instruction format) instruction decoder in InstrUtils.c
+ *  - update the instruction info list (width, format, flags, name) and
+ *    (if you changed an instruction format) instruction decoder in
+ *    InstrUtils.c
  *  - update the instruction format list in InstrUtils.h, if necessary
  *  - update the parallel definitions in the class dalvik.bytecode.Opcodes
  *
@@ -52,7 +53,6 @@
  *    - verify by running with verifier enabled (it's on by default)
  * 
  * Tools:
- *  - update the OpCodeNames table in dexdump/OpCodeNames.c
  *  - update dexdump/DexDump.c if an instruction format has changed
  *  
  * Note: The Dalvik VM tests (in the tests subdirectory) provide a convenient
@@ -31,6 +31,7 @@
 
 #include <limits.h>
 #include <errno.h>
+#include <pthread.h>
 
 /*
  * Having trouble finding a portable way to get this.  sysconf(_SC_PAGE_SIZE)
@@ -60,8 +61,14 @@ static void* sysCreateAnonShmem(size_t length)
 
     return ptr;
 #else
-    LOGE("sysCreateAnonShmem not implemented.\n");
-    return NULL;
+    /* No mmap; fake it with heap storage, freed by sysReleaseShmem(). */
+    void* ptr = malloc(length);
+    if (ptr == NULL) {
+        LOGW("malloc(%d) failed for anonymous segment\n", (int) length);
+        return NULL;
+    }
+
+    return ptr;
 #endif
 }
 
@@ -400,3 +407,97 @@ void sysCopyMap(MemMapping* dst, const MemMapping* src)
     memcpy(dst, src, sizeof(MemMapping));
 }
 
+/*
+ * Get the number of processors that are currently online.  Always returns
+ * at least 1.
+ */
+int sysGetCpuCount(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count > 0)
+        return (int) count;
+#endif
+    return 1;
+}
+
+/*
+ * Shared state for sysRunParallel().  Threads pull the next unclaimed item
+ * from "next" until all "count" items have been handed out.
+ */
+typedef struct ParallelRun {
+    pthread_mutex_t lock;
+    int             next;
+    int             count;
+    SysWorkFunc     func;
+    void*           arg;
+} ParallelRun;
+
+static void* parallelRunThread(void* arg)
+{
+    ParallelRun* pRun = (ParallelRun*) arg;
+
+    while (true) {
+        int idx;
+
+        pthread_mutex_lock(&pRun->lock);
+        idx = pRun->next;
+        if (idx < pRun->count)
+            pRun->next++;
+        pthread_mutex_unlock(&pRun->lock);
+
+        if (idx >= pRun->count)
+            break;
+        (*pRun->func)(pRun->arg, idx);
+    }
+
+    return NULL;
+}
+
+/*
+ * Call "func(arg, idx)" for every "idx" in [0, count), using up to
+ * "numThreads" threads (the calling thread is one of them).  Items are
+ * claimed in increasing order as threads become free, so early items
+ * finish first.  Returns after every call has completed.
+ *
+ * If threads can't be created, the remaining work is done on the calling
+ * thread.
+ */
+void sysRunParallel(int count, int numThreads, SysWorkFunc func, void* arg)
+{
+    ParallelRun run;
+    pthread_t* threads = NULL;
+    int numStarted = 0;
+    int i;
+
+    if (numThreads > count)
+        numThreads = count;
+    if (numThreads > 1)
+        threads = (pthread_t*) malloc(sizeof(pthread_t) * (numThreads-1));
+
+    pthread_mutex_init(&run.lock, NULL);
+    run.next = 0;
+    run.count = count;
+    run.func = func;
+    run.arg = arg;
+
+    if (threads != NULL) {
+        for (i = 0; i < numThreads-1; i++) {
+            if (pthread_create(&threads[i], NULL, parallelRunThread, &run) != 0)
+            {
+                LOGW("pthread_create failed; running with %d threads\n",
+                    numStarted + 1);
+                break;
+            }
+            numStarted++;
+        }
+    }
+
+    parallelRunThread(&run);
+
+    for (i = 0; i < numStarted; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_destroy(&run.lock);
+    free(threads);
+}
@@ -106,4 +106,21 @@ int sysChangeMapAccess(void* addr, size_t length, int wantReadWrite,
  */
 void sysReleaseShmem(MemMapping* pMap);
 
+/*
+ * Get the number of processors that are currently online (at least 1).
+ */
+int sysGetCpuCount(void);
+
+/*
+ * Work function for sysRunParallel().  "idx" identifies the item to process.
+ */
+typedef void (*SysWorkFunc)(void* arg, int idx);
+
+/*
+ * Call "func(arg, idx)" for each "idx" in [0, count), spread across up to
+ * "numThreads" threads including the caller.  Returns when all items are
+ * done.  The work function is responsible for any locking it needs.
+ */
+void sysRunParallel(int count, int numThreads, SysWorkFunc func, void* arg);
+
 #endif /*_DALVIK_SYSUTIL*/
@@ -501,9 +501,12 @@ bool dexZipGetEntryInfo(const ZipArchive* pArchive, ZipEntry entry,
 
 /*
  * Uncompress "deflate" data from one buffer to an open file descriptor.
+ *
+ * If "pDigest" is non-NULL, each block is added to it before it's written,
+ * and the digest is finished if everything succeeds.
  */
 static bool inflateToFile(int fd, const void* inBuf, long uncompLen,
-    long compLen)
+    long compLen, DexStreamDigest* pDigest)
 {
     bool result = false;
     const int kWriteBufSize = 32768;
@@ -559,7 +562,11 @@ static bool inflateToFile(int fd, const void* inBuf, long uncompLen,
             (zerr == Z_STREAM_END && zstream.avail_out != sizeof(writeBuf)))
         {
             long writeSize = zstream.next_out - writeBuf;
-            int cc = write(fd, writeBuf, writeSize);
+            int cc;
+
+            if (pDigest != NULL)
+                dexStreamDigestUpdate(pDigest, writeBuf, writeSize);
+            cc = write(fd, writeBuf, writeSize);
             if (cc != (int) writeSize) {
                 if (cc < 0) {
                     LOGW("write failed in inflate: %s\n", strerror(errno));
@@ -584,6 +591,94 @@ static bool inflateToFile(int fd, const void* inBuf, long uncompLen,
         goto z_bail;
     }
 
+    if (pDigest != NULL)
+        dexStreamDigestFinish(pDigest);
+    result = true;
+
+z_bail:
+    inflateEnd(&zstream);        /* free up any allocated structures */
+
+bail:
+    return result;
+}
+
+/*
+ * Uncompress "deflate" data from one buffer to another.  "outBuf" must
+ * be able to hold "uncompLen" bytes.
+ *
+ * Since we know the expanded size up front, we can let zlib write straight
+ * into the output buffer and finish in a single pass.  If we're also
+ * computing a digest, zlib is given the buffer a block at a time instead,
+ * so each block can be added to the digest while it's still in cache.
+ */
+static bool inflateToBuffer(void* outBuf, const void* inBuf, long uncompLen,
+    long compLen, DexStreamDigest* pDigest)
+{
+    const long kDigestBlockSize = 65536;
+    bool result = false;
+    z_stream zstream;
+    int zerr;
+
+    /*
+     * Initialize the zlib stream struct.
+     */
+    memset(&zstream, 0, sizeof(zstream));
+    zstream.zalloc = Z_NULL;
+    zstream.zfree = Z_NULL;
+    zstream.opaque = Z_NULL;
+    zstream.next_in = (Bytef*)inBuf;
+    zstream.avail_in = compLen;
+    zstream.next_out = (Bytef*) outBuf;
+    zstream.avail_out = uncompLen;
+    zstream.data_type = Z_UNKNOWN;
+
+    /*
+     * Use the undocumented "negative window bits" feature to tell zlib
+     * that there's no zlib header waiting for it.
+     */
+    zerr = inflateInit2(&zstream, -MAX_WBITS);
+    if (zerr != Z_OK) {
+        if (zerr == Z_VERSION_ERROR) {
+            LOGE("Installed zlib is not compatible with linked version (%s)\n",
+                ZLIB_VERSION);
+        } else {
+            LOGE("Call to inflateInit2 failed (zerr=%d)\n", zerr);
+        }
+        goto bail;
+    }
+
+    if (pDigest == NULL) {
+        zerr = inflate(&zstream, Z_FINISH);
+    } else {
+        do {
+            Bytef* blockStart = zstream.next_out;
+            long room = (Bytef*) outBuf + uncompLen - blockStart;
+
+            zstream.avail_out =
+                (room < kDigestBlockSize) ? room : kDigestBlockSize;
+            zerr = inflate(&zstream, Z_NO_FLUSH);
+            if (zerr != Z_OK && zerr != Z_STREAM_END)
+                break;
+            dexStreamDigestUpdate(pDigest, blockStart,
+                zstream.next_out - blockStart);
+        } while (zerr == Z_OK);
+    }
+    if (zerr != Z_STREAM_END) {
+        LOGW("zlib inflate: zerr=%d (nIn=%p aIn=%u nOut=%p aOut=%u)\n",
+            zerr, zstream.next_in, zstream.avail_in,
+            zstream.next_out, zstream.avail_out);
+        goto z_bail;
+    }
+
+    /* paranoia */
+    if ((long) zstream.total_out != uncompLen) {
+        LOGW("Size mismatch on inflated file (%ld vs %ld)\n",
+            zstream.total_out, uncompLen);
+        goto z_bail;
+    }
+
+    if (pDigest != NULL)
+        dexStreamDigestFinish(pDigest);
     result = true;
 
 z_bail:
@@ -596,11 +691,14 @@ bail:
 /*
  * Uncompress an entry, in its entirety, to an open file descriptor.
  *
+ * If "pDigest" is non-NULL and the entry is compressed, the data is added
+ * to it as it's expanded.  It's left unfinished for a stored entry.
+ *
  * TODO: this doesn't verify the data's CRC, but probably should (especially
  * for uncompressed data).
  */
 bool dexZipExtractEntryToFile(const ZipArchive* pArchive,
-    const ZipEntry entry, int fd)
+    const ZipEntry entry, int fd, DexStreamDigest* pDigest)
 {
     bool result = false;
     int ent = entryToIndex(pArchive, entry);
@@ -633,7 +731,7 @@ bool dexZipExtractEntryToFile(const ZipArchive* pArchive,
             LOGI("+++ successful write\n");
         }
     } else {
-        if (!inflateToFile(fd, basePtr+offset, uncompLen, compLen))
+        if (!inflateToFile(fd, basePtr+offset, uncompLen, compLen, pDigest))
             goto bail;
     }
 
@@ -643,3 +741,105 @@ bail:
     return result;
 }
 
+/*
+ * Uncompress an entry, in its entirety, into a newly-created private
+ * memory segment.  On success, "pMap" describes the expanded data and
+ * must be released with sysReleaseShmem().
+ *
+ * "pDigest" is handled as in dexZipExtractEntryToFile().
+ */
+bool dexZipExtractEntryToMemory(const ZipArchive* pArchive,
+    const ZipEntry entry, MemMapping* pMap, DexStreamDigest* pDigest)
+{
+    bool result = false;
+    bool mapped = false;
+    int ent = entryToIndex(pArchive, entry);
+    if (ent < 0)
+        return false;
+
+    const unsigned char* basePtr = (const unsigned char*)pArchive->mMap.addr;
+    int method;
+    long uncompLen, compLen;
+    off_t offset;
+
+    if (!dexZipGetEntryInfo(pArchive, entry, &method, &uncompLen, &compLen,
+            &offset, NULL, NULL))
+    {
+        goto bail;
+    }
+
+    if (sysCreatePrivateMap(uncompLen, pMap) != 0) {
+        LOGE("Unable to allocate %ld bytes for uncompressed entry\n",
+            uncompLen);
+        goto bail;
+    }
+    mapped = true;
+
+    if (method == kCompressStored) {
+        memcpy(pMap->addr, basePtr + offset, uncompLen);
+    } else {
+        if (!inflateToBuffer(pMap->addr, basePtr+offset, uncompLen, compLen,
+                pDigest))
+        {
+            goto bail;
+        }
+    }
+
+    result = true;
+
+bail:
+    if (!result && mapped)
+        sysReleaseShmem(pMap);
+    return result;
+}
+
+/*
+ * Use an uncompressed entry in place, without copying it.
+ *
+ * "pMap" is pointed at the entry's data inside the archive's own mapping.
+ * It doesn't own any storage, so releasing it does nothing; the data stays
+ * valid until the archive is closed, or for as long as the archive's
+ * mapping lives on after dexZipDetachMap().
+ *
+ * Returns "false" if the entry is compressed or its data isn't 32-bit
+ * aligned within the file.
+ */
+bool dexZipMapStoredEntry(const ZipArchive* pArchive, const ZipEntry entry,
+    MemMapping* pMap)
+{
+    int method;
+    long uncompLen;
+    off_t offset;
+
+    if (!dexZipGetEntryInfo(pArchive, entry, &method, &uncompLen, NULL,
+            &offset, NULL, NULL))
+    {
+        return false;
+    }
+
+    if (method != kCompressStored || (offset & 3) != 0)
+        return false;
+
+    LOGV("+++ mapping stored entry in place (off=%ld len=%ld)\n",
+        (long) offset, uncompLen);
+
+    pMap->addr = (u1*) pArchive->mMap.addr + offset;
+    pMap->length = uncompLen;
+    pMap->baseAddr = NULL;
+    pMap->baseLength = 0;
+    return true;
+}
+
+/*
+ * Hand the archive's mapping over to "pMap", which should describe data
+ * inside it (see dexZipMapStoredEntry).  Releasing "pMap" then releases
+ * the entire archive image.  After this, the archive may only be closed.
+ */
+void dexZipDetachMap(ZipArchive* pArchive, MemMapping* pMap)
+{
+    assert(pMap->baseAddr == NULL);
+
+    pMap->baseAddr = pArchive->mMap.baseAddr;
+    pMap->baseLength = pArchive->mMap.baseLength;
+    memset(&pArchive->mMap, 0, sizeof(pArchive->mMap));
+}
@@ -160,9 +160,34 @@ DEX_INLINE long dexGetZipEntryCrc32(const ZipArchive* pArchive,
 
 /*
  * Uncompress and write an entry to a file descriptor.
+ *
+ * If "pDigest" is non-NULL (and set up with dexStreamDigestInit()), a
+ * compressed entry's data is added to it as it's expanded, and the digest
+ * is finished on success.
  */
 bool dexZipExtractEntryToFile(const ZipArchive* pArchive,
-    const ZipEntry entry, int fd);
+    const ZipEntry entry, int fd, DexStreamDigest* pDigest);
+
+/*
+ * Uncompress an entry into a new private memory segment, which the caller
+ * must release with sysReleaseShmem().  "pDigest" is as above.
+ */
+bool dexZipExtractEntryToMemory(const ZipArchive* pArchive,
+    const ZipEntry entry, MemMapping* pMap, DexStreamDigest* pDigest);
+
+/*
+ * Use an uncompressed entry directly from the archive's mapping.  The
+ * result doesn't own any storage and is only valid while the archive's
+ * mapping is.
+ */
+bool dexZipMapStoredEntry(const ZipArchive* pArchive, const ZipEntry entry,
+    MemMapping* pMap);
+
+/*
+ * Transfer ownership of the archive's mapping to "pMap", so that data
+ * obtained with dexZipMapStoredEntry outlives the archive.
+ */
+void dexZipDetachMap(ZipArchive* pArchive, MemMapping* pMap);
 
 /*
  * Utility function to compute a CRC-32.
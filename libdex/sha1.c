@@ -6,6 +6,12 @@
  *    trashing the input.
  *  - Include <endian.h> to get endian info.
  *  - Split a small piece into a header file.
+ *  - Keep the state in 32-bit words, so it works where "long" is 64 bits,
+ *    and read the message as big-endian words directly, so it doesn't
+ *    depend on the endian info.  The work area is on the stack, so
+ *    contexts can be used on different threads.
+ *  - Hash whole blocks with the x86 SHA instructions when the CPU has
+ *    them.
  */
 
 /*
@@ -75,8 +81,6 @@ A million repetitions of "a"
   34AA973C D4C4DAA4 F61EEB2B DBAD2731 6534016F
 */
 
-#define SHA1HANDSOFF    /*Copies data before messing with it.*/
-
 /*#define CMDLINE        * include main() and file processing */
 
 #include "sha1.h"
@@ -88,23 +92,20 @@ A million repetitions of "a"
 #include <dos.h>
 #include <process.h>   /*  prototype for exit() - JHB
                needed for Win32, but chokes Linux - MPJ */
-#define X_LITTLE_ENDIAN /* This should be #define'd if true.*/
 #else
 # include <unistd.h>
 # include <stdlib.h>
-//# include <endian.h>
-
-#include "DexFile.h"    // want common byte ordering def
-
-# if __BYTE_ORDER == __LITTLE_ENDIAN
-#  define X_LITTLE_ENDIAN
-# endif
 #endif
 #include <ctype.h>
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+# define SHA1_X86_SHANI
+# include <immintrin.h>
+#endif
+
 #define LINESIZE 2048
 
-static void SHA1Transform(unsigned long state[5],
+static void SHA1Transform(uint32_t state[5],
     const unsigned char buffer[64]);
 
 #define rol(value,bits) \
@@ -113,14 +114,11 @@ static void SHA1Transform(unsigned long state[5],
 /* blk0() and blk() perform the initial expand. */
 /* I got the idea of expanding during the round function from
    SSLeay */
-#ifdef X_LITTLE_ENDIAN
-#define blk0(i) (block->l[i]=(rol(block->l[i],24)&0xFF00FF00) \
-    |(rol(block->l[i],8)&0x00FF00FF))
-#else
-#define blk0(i) block->l[i]
-#endif
-#define blk(i) (block->l[i&15] = rol(block->l[(i+13)&15]^block->l[(i+8)&15] \
-    ^block->l[(i+2)&15]^block->l[i&15],1))
+#define blk0(i) (block[i] = ((uint32_t)buffer[4*(i)] << 24) \
+    |((uint32_t)buffer[4*(i)+1] << 16)|((uint32_t)buffer[4*(i)+2] << 8) \
+    |buffer[4*(i)+3])
+#define blk(i) (block[i&15] = rol(block[(i+13)&15]^block[(i+8)&15] \
+    ^block[(i+2)&15]^block[i&15],1))
 
 /* (R0+R1), R2, R3, R4 are the different operations used in SHA1 */
 #define R0(v,w,x,y,z,i) z+=((w&(x^y))^y)+blk0(i)+0x5A827999+rol(v,5);w=rol(w,30);
@@ -132,22 +130,11 @@ static void SHA1Transform(unsigned long state[5],
 
 /* Hash a single 512-bit block. This is the core of the algorithm. */
 
-static void SHA1Transform(unsigned long state[5],
+static void SHA1Transform(uint32_t state[5],
     const unsigned char buffer[64])
 {
-unsigned long a, b, c, d, e;
-typedef union {
-    unsigned char c[64];
-    unsigned long l[16];
-} CHAR64LONG16;
-CHAR64LONG16* block;
-#ifdef SHA1HANDSOFF
-static unsigned char workspace[64];
-    block = (CHAR64LONG16*)workspace;
-    memcpy(block, buffer, 64);
-#else
-    block = (CHAR64LONG16*)buffer;
-#endif
+uint32_t a, b, c, d, e;
+uint32_t block[16];
     /* Copy context->state[] to working vars */
     a = state[0];
     b = state[1];
@@ -196,6 +183,111 @@ warning. */
 }
 
 
+#ifdef SHA1_X86_SHANI
+/*
+ * Hash whole blocks with the SHA instructions.  Each sha1rnds4 does four
+ * rounds; the message schedule for later rounds is built alongside with
+ * sha1msg1/sha1msg2, four words at a time, rotating through msg0..msg3.
+ */
+#define SHANI_ROUNDS4(_eIn, _eOut, _msg, _func) \
+    _eIn = _mm_sha1nexte_epu32(_eIn, _msg); \
+    _eOut = abcd; \
+    abcd = _mm_sha1rnds4_epu32(abcd, _eIn, _func);
+
+#define SHANI_ROUNDS4_SCHED(_eIn, _eOut, _msg, _next, _next2, _prev, _func) \
+    SHANI_ROUNDS4(_eIn, _eOut, _msg, _func) \
+    _next = _mm_sha1msg2_epu32(_next, _msg); \
+    _prev = _mm_sha1msg1_epu32(_prev, _msg); \
+    _next2 = _mm_xor_si128(_next2, _msg);
+
+__attribute__((target("sha,sse4.1")))
+static void sha1BlocksShaNi(uint32_t state[5], const unsigned char* data,
+    unsigned long numBlocks)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607ULL,
+        0x08090a0b0c0d0e0fULL);
+    __m128i abcd, abcdSave, e0, e0Save, e1;
+    __m128i msg0, msg1, msg2, msg3;
+
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) state), 0x1b);
+    e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+    while (numBlocks-- > 0) {
+        abcdSave = abcd;
+        e0Save = e0;
+
+        msg0 = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i*) (data + 0)), byteSwap);
+        msg1 = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i*) (data + 16)), byteSwap);
+        msg2 = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i*) (data + 32)), byteSwap);
+        msg3 = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i*) (data + 48)), byteSwap);
+
+        /* rounds 0-15 use the message as-is; start the schedule */
+        e0 = _mm_add_epi32(e0, msg0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        SHANI_ROUNDS4(e1, e0, msg1, 0)
+        msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+        SHANI_ROUNDS4(e0, e1, msg2, 0)
+        msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+        msg0 = _mm_xor_si128(msg0, msg2);
+        SHANI_ROUNDS4_SCHED(e1, e0, msg3, msg0, msg1, msg2, 0)
+
+        /* rounds 16-67 */
+        SHANI_ROUNDS4_SCHED(e0, e1, msg0, msg1, msg2, msg3, 0)
+        SHANI_ROUNDS4_SCHED(e1, e0, msg1, msg2, msg3, msg0, 1)
+        SHANI_ROUNDS4_SCHED(e0, e1, msg2, msg3, msg0, msg1, 1)
+        SHANI_ROUNDS4_SCHED(e1, e0, msg3, msg0, msg1, msg2, 1)
+        SHANI_ROUNDS4_SCHED(e0, e1, msg0, msg1, msg2, msg3, 1)
+        SHANI_ROUNDS4_SCHED(e1, e0, msg1, msg2, msg3, msg0, 1)
+        SHANI_ROUNDS4_SCHED(e0, e1, msg2, msg3, msg0, msg1, 2)
+        SHANI_ROUNDS4_SCHED(e1, e0, msg3, msg0, msg1, msg2, 2)
+        SHANI_ROUNDS4_SCHED(e0, e1, msg0, msg1, msg2, msg3, 2)
+        SHANI_ROUNDS4_SCHED(e1, e0, msg1, msg2, msg3, msg0, 2)
+        SHANI_ROUNDS4_SCHED(e0, e1, msg2, msg3, msg0, msg1, 2)
+        SHANI_ROUNDS4_SCHED(e1, e0, msg3, msg0, msg1, msg2, 3)
+        SHANI_ROUNDS4_SCHED(e0, e1, msg0, msg1, msg2, msg3, 3)
+
+        /* rounds 68-79; the schedule winds down */
+        SHANI_ROUNDS4(e1, e0, msg1, 3)
+        msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+        msg3 = _mm_xor_si128(msg3, msg1);
+        SHANI_ROUNDS4(e0, e1, msg2, 3)
+        msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+        SHANI_ROUNDS4(e1, e0, msg3, 3)
+
+        e0 = _mm_sha1nexte_epu32(e0, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+        data += 64;
+    }
+
+    _mm_storeu_si128((__m128i*) state, _mm_shuffle_epi32(abcd, 0x1b));
+    state[4] = _mm_extract_epi32(e0, 3);
+}
+#endif /*SHA1_X86_SHANI*/
+
+/*
+ * Hash "numBlocks" consecutive 64-byte blocks, the fastest way we can.
+ */
+static void sha1Blocks(uint32_t state[5], const unsigned char* data,
+    unsigned long numBlocks)
+{
+#ifdef SHA1_X86_SHANI
+    if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")) {
+        sha1BlocksShaNi(state, data, numBlocks);
+        return;
+    }
+#endif
+    while (numBlocks-- > 0) {
+        SHA1Transform(state, data);
+        data += 64;
+    }
+}
+
+
 /* SHA1Init - Initialize new context */
 
 void SHA1Init(SHA1_CTX* context)
@@ -216,18 +308,18 @@ void SHA1Update(SHA1_CTX* context, const unsigned char* data,
     unsigned long len)  /* JHB */
 {
     unsigned long i, j; /* JHB */
+    uint32_t bits = (uint32_t) (len << 3);
 
     j = (context->count[0] >> 3) & 63;
-    if ((context->count[0] += len << 3) < (len << 3))
+    if ((context->count[0] += bits) < bits)
         context->count[1]++;
-    context->count[1] += (len >> 29);
+    context->count[1] += (uint32_t) (len >> 29);
     if ((j + len) > 63)
     {
         memcpy(&context->buffer[j], data, (i = 64-j));
-        SHA1Transform(context->state, context->buffer);
-        for ( ; i + 63 < len; i += 64) {
-            SHA1Transform(context->state, &data[i]);
-        }
+        sha1Blocks(context->state, context->buffer, 1);
+        sha1Blocks(context->state, &data[i], (len - i) / 64);
+        i += (len - i) & ~63UL;
         j = 0;
     }
     else
@@ -265,10 +357,6 @@ unsigned char finalcount[8];
     memset(context->state, 0, HASHSIZE);
     memset(context->count, 0, 8);
     memset(&finalcount, 0, 8);
-#ifdef SHA1HANDSOFF
-    /* make SHA1Transform overwrite it's own static vars */
-    SHA1Transform(context->state, context->buffer);
-#endif
 }
 
 